@@ -56,12 +56,55 @@ typedef NS_OPTIONS(NSInteger, LGAutoPkgVerb) {
     kLGAutoPkgVersion = 1 << 30,
 };
 
+/*
+ * LGAutoPkgErrorHandler collects autopkg's stderr. The output is split
+ * into lines, and only the most recent lines are kept in memory. Older
+ * lines are moved to a file in the temporary directory, so a long and
+ * noisy run doesn't keep growing the app.
+ */
 @interface LGAutoPkgErrorHandler : NSObject
 
 @property (nonatomic, readonly) NSPipe *pipe;
+
+/**
+ *  The stderr lines kept in memory, preceded by a note when older lines were moved to the overflowFile.
+ */
 @property (nonatomic, readonly) NSString *errorString;
 
+/**
+ *  Path of the file older lines were moved to, nil if all the lines are still in memory.
+ */
+@property (copy, readonly) NSString *overflowFile;
+
+/**
+ *  Identifier of the recipe autopkg is currently processing.
+ *  @note Lines captured while this is set are attributed to the recipe.
+ */
+@property (copy) NSString *currentRecipe;
+
 - (instancetype)initWithVerb:(LGAutoPkgVerb)verb;
+
+/**
+ *  Initialize an error handler.
+ *
+ *  @param verb     autopkg verb being run.
+ *  @param maxLines number of lines to keep in memory.
+ */
+- (instancetype)initWithVerb:(LGAutoPkgVerb)verb maxLines:(NSUInteger)maxLines;
+
+- (void)appendErrorString:(NSString *)string;
 - (NSError *)errorWithExitCode:(NSInteger)exitCode;
 
+/**
+ *  Identifiers of the recipes that wrote to stderr, in the order they did, for the lines kept in memory.
+ */
+- (NSArray *)recipesWithErrors;
+
+/**
+ *  The stderr lines kept in memory that were written while a recipe was being processed.
+ *
+ *  @param recipe recipe identifier.
+ */
+- (NSString *)errorStringForRecipe:(NSString *)recipe;
+
 @end
@@ -19,7 +19,11 @@
 //
 
 #import "LGAutoPkgErrorHandler.h"
-#import "LGLogger.h"
+#import "LGAutoPkgr.h"
+#import "LGLineFramer.h"
+#import "LGRedactor.h"
+
+#import <string.h>
 
 NSString * LGAutoPkgLocalizedString(NSString *key, NSString *comment)
 {
@@ -69,87 +73,203 @@ static NSString *errorMessageFromAutoPkgVerb(LGAutoPkgVerb verb)
     return message;
 }
 
-NSString *maskPasswordInString(NSString *string)
-{
-    NSError *error;
-    NSMutableString *retractedString = [string mutableCopy];
-
-    NSString *baseAll = @"a-zA-Z0-9~`!#.,$%^&*()-_{}<>?";
-    NSString *pattern = [NSString stringWithFormat:@"([%@]+:[%@]+(?=@))", baseAll, baseAll];
-
-    NSRegularExpression *exp = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:&error];
-
-    NSRange range = NSMakeRange(0, string.length);
-    NSArray *matches = [exp matchesInString:string options:0 range:range];
-    for (NSTextCheckingResult *match in matches) {
-        NSString *ms = [string substringWithRange:match.range];
-        NSArray *array = [ms componentsSeparatedByString:@":"];
-
-        // Make sure to re-range the retracted string each loop, since it gets modified.
-        NSRange r_range = NSMakeRange(0, retractedString.length);
-        [retractedString replaceOccurrencesOfString:[array lastObject]
-                                         withString:@"*******"
-                                            options:NSCaseInsensitiveSearch
-                                              range:r_range];
-    }
+// Number of stderr lines kept in memory.
+static NSUInteger const kLGAutoPkgErrorHandlerMaxLines = 500;
+
+// Longer lines are truncated, so the memory used stays bounded.
+static NSUInteger const kLGAutoPkgErrorHandlerMaxLineLength = 4096;
 
-    return [retractedString copy];
+static BOOL isFailedLine(const char *bytes, NSUInteger length)
+{
+    // The "Failed." summary duplicates the errors above it.
+    return (length >= 7) && (strncasecmp(bytes, "Failed.", 7) == 0);
 }
 
 @implementation LGAutoPkgErrorHandler {
     LGAutoPkgVerb _verb;
-    NSMutableOrderedSet *_errorStrings;
     NSPipe *_pipe;
+    LGLineFramer *_framer;
+
+    // Ring buffer of the most recent lines and the recipe each was attributed to.
+    NSUInteger _maxLines;
+    NSMutableArray *_lines;
+    NSMutableArray *_lineRecipes;
+    NSUInteger _firstLine;
+    NSUInteger _overflowCount;
+    NSFileHandle *_overflowHandle;
 }
 
 - (void)dealloc
 {
     _pipe.fileHandleForReading.readabilityHandler = nil;
     _pipe = nil;
+    [_overflowHandle closeFile];
 }
 
 - (instancetype)initWithVerb:(LGAutoPkgVerb)verb
+{
+    return [self initWithVerb:verb maxLines:kLGAutoPkgErrorHandlerMaxLines];
+}
+
+- (instancetype)initWithVerb:(LGAutoPkgVerb)verb maxLines:(NSUInteger)maxLines
 {
     if (self = [super init]) {
         _verb = verb;
+        _maxLines = MAX(maxLines, 1);
+        _lines = [[NSMutableArray alloc] init];
+        _lineRecipes = [[NSMutableArray alloc] init];
+
+        __weak typeof(self) weakSelf = self;
+        _framer = [[LGLineFramer alloc] initWithLineHandler:^(const char *bytes, NSUInteger length) {
+            if (length && !isFailedLine(bytes, length)) {
+                [weakSelf addLine:LGLineString(bytes, length)];
+            }
+        }];
 
         NSPipe *pipe = [NSPipe pipe];
         _pipe = pipe;
 
+        LGLineFramer *framer = _framer;
         [pipe.fileHandleForReading setReadabilityHandler:^(NSFileHandle *fh) {
             NSData *data = fh.availableData;
-            if (data) {
-                NSString *str = [[NSMutableString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-
-                if (!_errorStrings) {
-                    _errorStrings = [[NSMutableOrderedSet alloc] init];
-                }
-                
-                [_errorStrings addObject:str];
+            if (data.length) {
+                [framer appendData:data];
+            } else {
+                // End of file, keep any last line that wasn't terminated.
+                fh.readabilityHandler = nil;
+                [framer flush];
             }
         }];
     }
     return self;
 }
 
+- (void)appendErrorString:(NSString *)string
+{
+    // For stderr that was collected elsewhere, such as by the persistent worker.
+    if (string.length) {
+        [_framer appendData:[string dataUsingEncoding:NSUTF8StringEncoding]];
+        [_framer flush];
+    }
+}
+
 - (NSPipe *)standardError
 {
     return _pipe;
 }
 
+#pragma mark - Lines
+- (void)addLine:(NSString *)line
+{
+    id recipe = self.currentRecipe ?: [NSNull null];
+
+    // Mask credentials before the line is kept anywhere, including the overflow file.
+    line = LGRedactedString(line);
+
+    if (line.length > kLGAutoPkgErrorHandlerMaxLineLength) {
+        NSRange range = [line rangeOfComposedCharacterSequencesForRange:NSMakeRange(0, kLGAutoPkgErrorHandlerMaxLineLength)];
+        line = [[line substringWithRange:range] stringByAppendingString:@"..."];
+    }
+
+    @synchronized(self)
+    {
+        if (_lines.count < _maxLines) {
+            [_lines addObject:line];
+            [_lineRecipes addObject:recipe];
+            return;
+        }
+
+        // Full, move the oldest line out to the overflow file and reuse its slot.
+        [self writeOverflowLine:_lines[_firstLine]];
+
+        _lines[_firstLine] = line;
+        _lineRecipes[_firstLine] = recipe;
+        _firstLine = (_firstLine + 1) % _maxLines;
+    }
+}
+
+- (void)writeOverflowLine:(NSString *)line
+{
+    if (!_overflowHandle) {
+        NSString *file = [NSTemporaryDirectory() stringByAppendingPathComponent:quick_formatString(@"autopkg-stderr-%@.log", [[NSUUID UUID] UUIDString])];
+        if (![[NSFileManager defaultManager] createFileAtPath:file contents:nil attributes:nil]) {
+            _overflowCount++;
+            return;
+        }
+        _overflowHandle = [NSFileHandle fileHandleForWritingAtPath:file];
+        _overflowFile = file;
+        DLog(@"autopkg stderr overflowed, older lines are in %@", file);
+    }
+
+    _overflowCount++;
+    [_overflowHandle writeData:[[line stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)enumerateLinesUsingBlock:(void (^)(NSString *line, id recipe))block
+{
+    // Only called while synchronized on self.
+    NSUInteger count = _lines.count;
+    for (NSUInteger i = 0; i < count; i++) {
+        NSUInteger idx = (_firstLine + i) % count;
+        block(_lines[idx], _lineRecipes[idx]);
+    }
+}
+
 - (NSString *)errorString
 {
-    NSArray *errors = nil;
-    NSString *errorString = nil;
+    // The process has exited by the time this is asked for,
+    // so a last line without a line break is complete.
+    [_framer flush];
+
+    @synchronized(self)
+    {
+        if (!_lines.count) {
+            return nil;
+        }
+
+        NSMutableArray *lines = [[NSMutableArray alloc] initWithCapacity:_lines.count + 1];
+        if (_overflowCount) {
+            [lines addObject:quick_formatString(@"[%lu earlier lines are in %@]", (unsigned long)_overflowCount, _overflowFile ?: @"(unavailable)")];
+        }
 
-    if ((errors = _errorStrings.array)) {
-        NSArray *filters = @[ @"not (SELF BEGINSWITH[CD] 'Failed.')" ];
+        [self enumerateLinesUsingBlock:^(NSString *line, id recipe) {
+            [lines addObject:line];
+        }];
 
-        NSPredicate *predicate = [NSPredicate predicateWithFormat:[filters componentsJoinedByString:@" AND "]];
+        return [lines componentsJoinedByString:@"\n"];
+    }
+}
 
-        errorString = [[_errorStrings.array filteredArrayUsingPredicate:predicate] componentsJoinedByString:@"\n"];
-    };
-    return errorString;
+- (NSArray *)recipesWithErrors
+{
+    [_framer flush];
+
+    @synchronized(self)
+    {
+        NSMutableOrderedSet *recipes = [[NSMutableOrderedSet alloc] init];
+        [self enumerateLinesUsingBlock:^(NSString *line, id recipe) {
+            if (recipe != [NSNull null]) {
+                [recipes addObject:recipe];
+            }
+        }];
+        return recipes.array;
+    }
+}
+
+- (NSString *)errorStringForRecipe:(NSString *)recipe
+{
+    [_framer flush];
+
+    @synchronized(self)
+    {
+        NSMutableArray *lines = [[NSMutableArray alloc] init];
+        [self enumerateLinesUsingBlock:^(NSString *line, id lineRecipe) {
+            if ([lineRecipe isEqual:recipe]) {
+                [lines addObject:line];
+            }
+        }];
+        return lines.count ? [lines componentsJoinedByString:@"\n"] : nil;
+    }
 }
 
 - (NSError *)errorWithExitCode:(NSInteger)exitCode
@@ -159,7 +279,7 @@ NSString *maskPasswordInString(NSString *string)
     NSString *standardErrString = self.errorString;
     if (standardErrString.length) {
         NSString *errorMsg = errorMessageFromAutoPkgVerb(_verb);
-        NSString *errorDetails = maskPasswordInString(standardErrString);
+        NSString *errorDetails = standardErrString;
 
         // If the error message looks like a Python exception log it, but trim it up for UI.
         NSPredicate *exceptionPredicate = [NSPredicate predicateWithFormat:@"SELF CONTAINS 'Traceback'"];
@@ -0,0 +1,91 @@
+//
+//  LGAutoPkgIncrementalRun.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Report key for the array of recipe identifiers that were deferred during an incremental run.
+ */
+extern NSString *const kLGIncrementalRunDeferredRecipesKey;
+
+/*
+ * LGAutoPkgIncrementalRun decides which recipes of a recipe list need to
+ * run. For every recipe it keeps a fingerprint, made of the commit
+ * checked out in the repo of the recipe and each of its parents, plus a
+ * hash of the override file. It also keeps the outcome of the recipe's
+ * last run, including the download's etag, last modified date and size.
+ *
+ * A recipe is deferred when it has a check phase, its fingerprint is
+ * unchanged, its last run succeeded without a new download or upstream
+ * change, and that run is within the freshness interval. Every other
+ * recipe runs, so a deferred recipe still runs once the interval passes.
+ */
+@interface LGAutoPkgIncrementalRun : NSObject
+
+/**
+ *  Initialize an incremental run using the state file in the AutoPkgr Application Support directory.
+ *
+ *  @param recipeList path to the full recipe list.
+ */
+- (instancetype)initWithRecipeList:(NSString *)recipeList;
+
+/**
+ *  Initialize an incremental run.
+ *
+ *  @param recipeList path to the full recipe list.
+ *  @param stateFile  path of the plist the recipe state is kept in.
+ */
+- (instancetype)initWithRecipeList:(NSString *)recipeList stateFile:(NSString *)stateFile;
+
+@property (copy, nonatomic, readonly) NSString *recipeList;
+@property (copy, nonatomic, readonly) NSString *stateFile;
+
+/**
+ *  Seconds an unchanged recipe can be deferred. Defaults to LGDefaults' incrementalAutoPkgRunFreshnessInterval.
+ */
+@property (assign, nonatomic) NSTimeInterval freshnessInterval;
+
+/**
+ *  Identifiers of recipes that will run, set by -plan.
+ */
+@property (copy, nonatomic, readonly) NSArray *plannedRecipes;
+
+/**
+ *  Identifiers of recipes that were deferred, set by -plan.
+ */
+@property (copy, nonatomic, readonly) NSArray *deferredRecipes;
+
+/**
+ *  Fingerprint the recipes and write the ones that need to run to a new recipe list.
+ *  @note Call this after the repos have been updated.
+ *
+ *  @return path of the recipe list to run, or nil if every recipe was deferred.
+ */
+- (NSString *)plan;
+
+/**
+ *  Record the outcome of running the planned recipe list.
+ *
+ *  @param report report of the run, with the journaled recipe results.
+ *
+ *  @return the report with the deferred recipes added under kLGIncrementalRunDeferredRecipesKey.
+ */
+- (NSDictionary *)recordReport:(NSDictionary *)report;
+
+@end
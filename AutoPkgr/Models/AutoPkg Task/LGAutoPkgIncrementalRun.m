@@ -0,0 +1,340 @@
+//
+//  LGAutoPkgIncrementalRun.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgIncrementalRun.h"
+#import "LGAutoPkgTask.h"
+#import "LGAutoPkgRecipeIndex.h"
+#import "LGAutoPkgRecipeJournal.h"
+#import "LGGitIntegration.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+NSString *const kLGIncrementalRunDeferredRecipesKey = @"deferred_recipes";
+
+static NSString *const kLGIncrementalRunFileName = @"IncrementalRun.plist";
+static NSString *const kLGIncrementalRunVersionKey = @"version";
+static NSString *const kLGIncrementalRunRecipesKey = @"recipes";
+
+// Bump this when the layout of the recipe state changes so old state gets discarded.
+static NSInteger const kLGIncrementalRunVersion = 1;
+
+// Recipe state keys, the upstream check result uses the journal's keys.
+static NSString *const kLGIncrementalRunFingerprintKey = @"fingerprint";
+static NSString *const kLGIncrementalRunCheckedKey = @"checked";
+static NSString *const kLGIncrementalRunDownloadedKey = @"downloaded";
+static NSString *const kLGIncrementalRunUpstreamChangedKey = @"upstream_changed";
+
+static NSString *const kLGMakeCatalogsIdentifier = @"com.github.autopkg.munki.makecatalogs";
+
+#pragma mark - Helpers
+static NSString *SHA1OfFile(NSString *path)
+{
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data) {
+        return nil;
+    }
+
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+
+    NSMutableString *hash = [[NSMutableString alloc] initWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        [hash appendFormat:@"%02x", digest[i]];
+    }
+    return [hash copy];
+}
+
+/* Commit checked out in the repo that contains a recipe file. Directories
+ * are memoized in repoHeads (NSNull when not in a repo), since most recipes
+ * share a handful of repos. */
+static NSString *repoHeadOfFile(NSString *path, NSMutableDictionary *repoHeads)
+{
+    NSMutableArray *visited = [[NSMutableArray alloc] init];
+    NSString *head = nil;
+
+    for (NSString *dir = path.stringByDeletingLastPathComponent; dir.length > 1; dir = dir.stringByDeletingLastPathComponent) {
+        id known = repoHeads[dir];
+        if (known) {
+            head = (known == [NSNull null]) ? nil : known;
+            break;
+        }
+
+        [visited addObject:dir];
+        if ([[NSFileManager defaultManager] fileExistsAtPath:[dir stringByAppendingPathComponent:@".git"]]) {
+            head = [LGGitIntegration localHeadSHA1OfRepoPath:dir];
+            break;
+        }
+    }
+
+    for (NSString *dir in visited) {
+        repoHeads[dir] = head ?: [NSNull null];
+    }
+    return head;
+}
+
+static BOOL upstreamResultChanged(NSDictionary *previous, NSDictionary *current)
+{
+    for (NSString *key in @[ kLGRecipeJournalETagKey, kLGRecipeJournalLastModifiedKey, kLGRecipeJournalDownloadSizeKey ]) {
+        if (previous[key] && current[key] && ![previous[key] isEqual:current[key]]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Incremental Run
+@implementation LGAutoPkgIncrementalRun {
+    NSString *_plannedRecipeList;
+
+    // Identifier -> fingerprint of the planned recipes.
+    NSMutableDictionary *_fingerprints;
+}
+
+- (instancetype)initWithRecipeList:(NSString *)recipeList
+{
+    NSString *stateFile;
+    NSString *autoPkgrSupportDirectory = [LGHostInfo getAppSupportDirectory];
+    if (autoPkgrSupportDirectory.length) {
+        stateFile = [autoPkgrSupportDirectory stringByAppendingPathComponent:kLGIncrementalRunFileName];
+    }
+    return [self initWithRecipeList:recipeList stateFile:stateFile];
+}
+
+- (instancetype)initWithRecipeList:(NSString *)recipeList stateFile:(NSString *)stateFile
+{
+    if (self = [super init]) {
+        _recipeList = recipeList;
+        _stateFile = stateFile;
+        _freshnessInterval = [[LGDefaults standardUserDefaults] incrementalAutoPkgRunFreshnessInterval];
+        _fingerprints = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Planning
+- (NSString *)plan
+{
+    NSString *fileContents = [NSString stringWithContentsOfFile:_recipeList encoding:NSUTF8StringEncoding error:nil];
+    NSArray *recipes = fileContents.split_byLine.filtered_noEmptyStrings;
+
+    // The repos were just updated, so make sure the parent chains are current.
+    [[LGAutoPkgRecipeIndex sharedIndex] refresh];
+
+    NSDictionary *state = [self readStateFile];
+    NSMutableDictionary *repoHeads = [[NSMutableDictionary alloc] init];
+    NSMutableArray *planned = [[NSMutableArray alloc] initWithCapacity:recipes.count];
+    NSMutableArray *deferred = [[NSMutableArray alloc] init];
+
+    for (NSString *identifier in recipes) {
+        BOOL hasCheckPhase = NO;
+        NSString *fingerprint = [self fingerprintOfRecipe:identifier hasCheckPhase:&hasCheckPhase repoHeads:repoHeads];
+
+        if (fingerprint) {
+            _fingerprints[identifier] = fingerprint;
+        }
+
+        if (hasCheckPhase && [self canDeferRecipeState:state[identifier] fingerprint:fingerprint]) {
+            [deferred addObject:identifier];
+        } else {
+            [planned addObject:identifier];
+        }
+    }
+
+    _plannedRecipes = [planned copy];
+    _deferredRecipes = [deferred copy];
+
+    DevLog(@"Incremental run deferred %ld of %ld recipes.", (long)deferred.count, (long)recipes.count);
+
+    // MakeCatalogs alone has nothing new to catalog.
+    [planned removeObject:kLGMakeCatalogsIdentifier];
+    if (!planned.count) {
+        return nil;
+    }
+
+    NSString *listFolder = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:listFolder withIntermediateDirectories:YES attributes:nil error:nil];
+
+    NSError *error;
+    NSString *plannedRecipeList = [[listFolder stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]] stringByAppendingPathExtension:@"txt"];
+    if (![[_plannedRecipes componentsJoinedByString:@"\n"] writeToFile:plannedRecipeList atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+        NSLog(@"Error while writing %@. %@", plannedRecipeList, error);
+        // Fall back to running everything.
+        _plannedRecipes = recipes;
+        _deferredRecipes = @[];
+        return _recipeList;
+    }
+
+    _plannedRecipeList = plannedRecipeList;
+    return _plannedRecipeList;
+}
+
+/* Walk the recipe's parent chain, collecting the repo commit of each
+ * recipe (or the hash of an override). Returns nil when a part of the
+ * chain can't be fingerprinted, such recipes always run. */
+- (NSString *)fingerprintOfRecipe:(NSString *)identifier hasCheckPhase:(BOOL *)hasCheckPhase repoHeads:(NSMutableDictionary *)repoHeads
+{
+    LGAutoPkgRecipeIndex *index = [LGAutoPkgRecipeIndex sharedIndex];
+    NSMutableArray *components = [[NSMutableArray alloc] init];
+    NSMutableSet *visited = [[NSMutableSet alloc] init];
+
+    for (NSDictionary *entry = [index entryForIdentifier:identifier]; entry;) {
+        NSString *entryIdentifier = entry[kLGAutoPkgRecipeIdentifierKey];
+        if ([visited containsObject:entryIdentifier]) {
+            return nil;
+        }
+        [visited addObject:entryIdentifier];
+
+        NSString *component;
+        if ([entry[kLGRecipeIndexIsOverrideKey] boolValue]) {
+            component = SHA1OfFile(entry[kLGAutoPkgRecipePathKey]);
+        } else {
+            component = repoHeadOfFile(entry[kLGAutoPkgRecipePathKey], repoHeads);
+        }
+
+        if (!component) {
+            return nil;
+        }
+        [components addObject:component];
+
+        if ([entry[kLGRecipeIndexProcessorsKey] containsObject:@"EndOfCheckPhase"]) {
+            *hasCheckPhase = YES;
+        }
+
+        NSString *parent = entry[kLGAutoPkgRecipeParentKey];
+        if (!parent) {
+            return [components componentsJoinedByString:@" "];
+        }
+
+        entry = [index entryForIdentifier:parent];
+    }
+
+    // The recipe, or one of its parents, is missing.
+    return nil;
+}
+
+- (BOOL)canDeferRecipeState:(NSDictionary *)recipeState fingerprint:(NSString *)fingerprint
+{
+    if (!recipeState || !fingerprint) {
+        return NO;
+    }
+
+    NSTimeInterval checked = [recipeState[kLGIncrementalRunCheckedKey] doubleValue];
+
+    return ([recipeState[kLGIncrementalRunFingerprintKey] isEqualToString:fingerprint] &&
+            ![recipeState[kLGIncrementalRunDownloadedKey] boolValue] &&
+            ![recipeState[kLGIncrementalRunUpstreamChangedKey] boolValue] &&
+            ([[NSDate date] timeIntervalSince1970] - checked) < _freshnessInterval);
+}
+
+#pragma mark - Recording
+- (NSDictionary *)recordReport:(NSDictionary *)report
+{
+    NSMutableDictionary *state = [[self readStateFile] mutableCopy] ?: [[NSMutableDictionary alloc] init];
+
+    for (NSDictionary *record in report[kLGRecipeJournalReportKey]) {
+        NSString *identifier = record[kLGRecipeJournalRecipeKey];
+        if (![_plannedRecipes containsObject:identifier]) {
+            continue;
+        }
+
+        NSString *fingerprint = _fingerprints[identifier];
+
+        // Anything that didn't cleanly succeed has to run next time.
+        if (!fingerprint || ![record[kLGRecipeJournalStatusKey] isEqualToString:kLGRecipeJournalStatusSucceeded]) {
+            [state removeObjectForKey:identifier];
+            continue;
+        }
+
+        NSMutableDictionary *recipeState = [[NSMutableDictionary alloc] init];
+        recipeState[kLGIncrementalRunFingerprintKey] = fingerprint;
+        recipeState[kLGIncrementalRunCheckedKey] = record[kLGRecipeJournalFinishedKey] ?: @([[NSDate date] timeIntervalSince1970]);
+        recipeState[kLGIncrementalRunDownloadedKey] = @(record[kLGRecipeJournalDownloadPathKey] != nil);
+
+        for (NSString *key in @[ kLGRecipeJournalETagKey, kLGRecipeJournalLastModifiedKey, kLGRecipeJournalDownloadSizeKey ]) {
+            if (record[key]) {
+                recipeState[key] = record[key];
+            }
+        }
+        recipeState[kLGIncrementalRunUpstreamChangedKey] = @(upstreamResultChanged(state[identifier], recipeState));
+
+        state[identifier] = [recipeState copy];
+    }
+
+    // Forget recipes that are no longer in the list.
+    NSSet *listed = [NSSet setWithArray:[_plannedRecipes arrayByAddingObjectsFromArray:_deferredRecipes]];
+    for (NSString *identifier in state.allKeys) {
+        if (![listed containsObject:identifier]) {
+            [state removeObjectForKey:identifier];
+        }
+    }
+
+    [self writeStateFile:state];
+
+    if (_plannedRecipeList && ![[LGDefaults standardUserDefaults] debug]) {
+        [[NSFileManager defaultManager] removeItemAtPath:_plannedRecipeList error:nil];
+    }
+
+    NSMutableDictionary *incrementalReport = [report mutableCopy] ?: [[NSMutableDictionary alloc] init];
+    incrementalReport[kLGIncrementalRunDeferredRecipesKey] = _deferredRecipes ?: @[];
+    return [incrementalReport copy];
+}
+
+#pragma mark - Persistence
+- (NSDictionary *)readStateFile
+{
+    if (!_stateFile) {
+        return nil;
+    }
+
+    NSData *data = [NSData dataWithContentsOfFile:_stateFile];
+    if (!data) {
+        return nil;
+    }
+
+    NSDictionary *state = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil];
+
+    if (![state isKindOfClass:[NSDictionary class]] ||
+        [state[kLGIncrementalRunVersionKey] integerValue] != kLGIncrementalRunVersion ||
+        ![state[kLGIncrementalRunRecipesKey] isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+
+    return state[kLGIncrementalRunRecipesKey];
+}
+
+- (BOOL)writeStateFile:(NSDictionary *)recipes
+{
+    if (!_stateFile) {
+        return NO;
+    }
+
+    NSError *error;
+    NSDictionary *state = @{ kLGIncrementalRunVersionKey : @(kLGIncrementalRunVersion),
+                             kLGIncrementalRunRecipesKey : recipes };
+
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:state format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+
+    if (!data || ![data writeToFile:_stateFile options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"Error while writing %@. %@", _stateFile, error);
+        return NO;
+    }
+    return YES;
+}
+
+@end
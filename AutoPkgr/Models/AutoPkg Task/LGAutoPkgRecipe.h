@@ -71,6 +71,11 @@
  */
 @property (nonatomic, assign, readonly) BOOL recipeConfigError;
 
+/**
+ *  Seconds the recipe took the last time it ran, nil if it hasn't run yet.
+ */
+@property (copy, nonatomic, readonly) NSNumber *lastRunDuration;
+
 /**
  *  Get a list of all recipes and overrides.
  *  @note this will filter out parent recipes of overrides with the same name.
@@ -92,9 +97,21 @@
  *  Set of recipes
  *
  *  @return Set of recipes to run.
+ *  @note This is the in memory LGAutoPkgRecipeList, recipe_list.txt isn't read again unless it's changed.
  */
 + (NSSet *)activeRecipes;
 
+/**
+ *  Enable and disable any number of recipes at once.
+ *
+ *  @param enable  identifiers of the recipes to enable.
+ *  @param disable identifiers of the recipes to disable.
+ *  @note recipe_list.txt is written once, and kLGNotificationRecipeListChanged is posted once.
+ *
+ *  @return NO if the recipe list could not be written.
+ */
++ (BOOL)enableRecipes:(NSArray *)enable disableRecipes:(NSArray *)disable;
+
 /**
  *  Migrate a recipe_list.txt file from recipe shortnames to recipe identifiers.
  *
@@ -19,26 +19,213 @@
 
 #import "LGAutoPkgRecipe.h"
 #import "LGAutoPkgTask.h"
-
-#import <glob.h>
+#import "LGAutoPkgRecipeIndex.h"
+#import "LGAutoPkgRecipeList.h"
+#import "LGAutoPkgRecipeTimings.h"
+#import "LGAutoPkgRecipeJournal.h"
 
 // MakeCatalogs recipe identifier string
 static NSString *const kLGMakeCatalogsIdentifier = @"com.github.autopkg.munki.makecatalogs";
 
-// Dispatch queue for enabling / disabling recipe
-static dispatch_queue_t autopkgr_recipe_write_queue()
+#pragma mark - Recipe Graph
+//////////////////////////////////////////////////////////////////////////
+// Recipe Graph                                                        ///
+//////////////////////////////////////////////////////////////////////////
+
+/* Identifier to index entry graph used to resolve parent chains.
+ * A chain, its flattened processors and its inherited values are
+ * resolved the first time they're requested and memoized after that.
+ * A new graph is built whenever the recipe index is refreshed. A graph
+ * made with an index instead looks each identifier up as the chain is
+ * walked, and drops what it memoized whenever the index's entries change. */
+@interface LGAutoPkgRecipeGraph : NSObject
+- (instancetype)initWithEntries:(NSArray *)entries;
+- (instancetype)initWithIndex:(LGAutoPkgRecipeIndex *)index;
+
+// The index entries array the graph was built from.
+@property (strong, nonatomic, readonly) NSArray *entries;
+
+- (NSDictionary *)entryForIdentifier:(NSString *)identifier;
+- (NSArray *)chainFromIdentifier:(NSString *)identifier;
+- (NSSet *)processorsOfChainFromIdentifier:(NSString *)identifier;
+- (id)inheritedValueForKey:(NSString *)key ofChainFromIdentifier:(NSString *)identifier;
+@end
+
+@implementation LGAutoPkgRecipeGraph {
+    LGAutoPkgRecipeIndex *_index;
+    NSUInteger _generation;
+    NSDictionary *_entriesByIdentifier;
+    NSMutableDictionary *_chains;
+    NSMutableDictionary *_processors;
+    NSMutableDictionary *_inheritedValues;
+}
+
+- (instancetype)initWithEntries:(NSArray *)entries
+{
+    if (self = [super init]) {
+        _entries = entries;
+
+        NSMutableDictionary *entriesByIdentifier = [[NSMutableDictionary alloc] initWithCapacity:entries.count];
+        for (NSDictionary *entry in entries) {
+            entriesByIdentifier[entry[kLGAutoPkgRecipeIdentifierKey]] = entry;
+        }
+
+        _entriesByIdentifier = [entriesByIdentifier copy];
+        _chains = [[NSMutableDictionary alloc] init];
+        _processors = [[NSMutableDictionary alloc] init];
+        _inheritedValues = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (instancetype)initWithIndex:(LGAutoPkgRecipeIndex *)index
+{
+    if (self = [super init]) {
+        _index = index;
+        _generation = index.generation;
+        _chains = [[NSMutableDictionary alloc] init];
+        _processors = [[NSMutableDictionary alloc] init];
+        _inheritedValues = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dropMemosIfIndexChanged
+{
+    // Only called while synchronized on self.
+    NSUInteger generation = _index.generation;
+    if (_index && (generation != _generation)) {
+        [_chains removeAllObjects];
+        [_processors removeAllObjects];
+        [_inheritedValues removeAllObjects];
+        _generation = generation;
+    }
+}
+
+- (NSDictionary *)entryForIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return nil;
+    }
+    return _index ? [_index entryForIdentifier:identifier] : _entriesByIdentifier[identifier];
+}
+
+- (NSArray *)chainFromIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        [self dropMemosIfIndexChanged];
+
+        NSArray *chain = _chains[identifier];
+        if (!chain) {
+            /* The chain ends with the first identifier that isn't in the graph
+             * (a missing parent), or just before an identifier repeats. */
+            NSMutableOrderedSet *visited = [NSMutableOrderedSet orderedSetWithObject:identifier];
+            NSString *next = [self entryForIdentifier:identifier][kLGAutoPkgRecipeParentKey];
+
+            while (next) {
+                if ([visited containsObject:next]) {
+                    NSLog(@"The parent recipes of %@ form a loop at %@.", identifier, next);
+                    break;
+                }
+                [visited addObject:next];
+                next = [self entryForIdentifier:next][kLGAutoPkgRecipeParentKey];
+            }
+
+            chain = visited.array;
+            _chains[identifier] = chain;
+        }
+        return chain;
+    }
+}
+
+- (NSSet *)processorsOfChainFromIdentifier:(NSString *)identifier
 {
-    static dispatch_queue_t autopkgr_recipe_write_queue;
+    if (!identifier) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        [self dropMemosIfIndexChanged];
+
+        NSSet *processors = _processors[identifier];
+        if (!processors) {
+            NSMutableSet *flattened = [[NSMutableSet alloc] init];
+            for (NSString *chainIdentifier in [self chainFromIdentifier:identifier]) {
+                NSArray *entryProcessors = [self entryForIdentifier:chainIdentifier][kLGRecipeIndexProcessorsKey];
+                if (entryProcessors.count) {
+                    [flattened addObjectsFromArray:entryProcessors];
+                }
+            }
+
+            processors = [flattened copy];
+            _processors[identifier] = processors;
+        }
+        return processors;
+    }
+}
+
+- (id)inheritedValueForKey:(NSString *)key ofChainFromIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        [self dropMemosIfIndexChanged];
+
+        NSString *memoKey = [identifier stringByAppendingFormat:@"/%@", key];
+        id value = _inheritedValues[memoKey];
+
+        if (!value) {
+            for (NSString *chainIdentifier in [self chainFromIdentifier:identifier]) {
+                if ((value = [self entryForIdentifier:chainIdentifier][key])) {
+                    break;
+                }
+            }
+            // Use NSNull so a value missing from the whole chain is memoized too.
+            _inheritedValues[memoKey] = value ?: [NSNull null];
+        }
+
+        return (value == [NSNull null]) ? nil : value;
+    }
+}
+
+@end
+
+static LGAutoPkgRecipeGraph *_recipeGraph = nil;
+
+// Graph for the current index entries, rebuilt only when the index has been refreshed.
+static LGAutoPkgRecipeGraph *currentRecipeGraph()
+{
+    NSArray *entries = [[LGAutoPkgRecipeIndex sharedIndex] entries];
+
+    @synchronized([LGAutoPkgRecipeGraph class])
+    {
+        if (!_recipeGraph || (_recipeGraph.entries != entries)) {
+            _recipeGraph = [[LGAutoPkgRecipeGraph alloc] initWithEntries:entries];
+        }
+        return _recipeGraph;
+    }
+}
+
+// Graph backed by the shared index, for recipes that weren't made from the index's entries.
+static LGAutoPkgRecipeGraph *sharedIndexRecipeGraph()
+{
+    static LGAutoPkgRecipeGraph *indexRecipeGraph;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        autopkgr_recipe_write_queue = dispatch_queue_create("com.lindegroup.autopkgr.recipe.write.queue", DISPATCH_QUEUE_SERIAL );
+        indexRecipeGraph = [[LGAutoPkgRecipeGraph alloc] initWithIndex:[LGAutoPkgRecipeIndex sharedIndex]];
     });
-
-    return autopkgr_recipe_write_queue;
+    return indexRecipeGraph;
 }
 
-static NSMutableDictionary *_identifierURLStore = nil;
-
 #pragma mark - Recipes
 //////////////////////////////////////////////////////////////////////////
 // Recipes                                                             ///
@@ -46,15 +233,17 @@ static NSMutableDictionary *_identifierURLStore = nil;
 
 @implementation LGAutoPkgRecipe {
 @private
-    /* This is the actual iVar used for the `enabled` property
-     * which when initialize is -1. We then check for that value
-     * during the -enabled getter and know if we need to do a more
-     * expensive check that initializes an array */
-    OSStatus _enabledInitialized;
     NSURL *_recipeFileURL;
+
+    /* When initialized from the recipe index the plist is only
+     * read from disk if a value not in the index is requested */
+    NSDictionary *_indexEntry;
+
+    // Graph used to resolve values inherited from parent recipes.
+    LGAutoPkgRecipeGraph *_graph;
 }
 
-@synthesize Description = _Description, MinimumVersion = _MinimumVersion;
+@synthesize Description = _Description, MinimumVersion = _MinimumVersion, recipePlist = _recipePlist;
 
 - (NSString *)description
 {
@@ -76,58 +265,77 @@ static NSMutableDictionary *_identifierURLStore = nil;
 
         _FilePath = recipeFile.path;
         _isOverride = isOverride;
-        _enabledInitialized = -1;
+    }
+    return self;
+}
 
-        [_identifierURLStore setObject:_recipeFileURL forKey:_Identifier];
+- (instancetype)initWithIndexEntry:(NSDictionary *)indexEntry graph:(LGAutoPkgRecipeGraph *)graph
+{
+    NSString *identifier = indexEntry[kLGAutoPkgRecipeIdentifierKey];
+
+    if (identifier && (self = [super init])) {
+        _indexEntry = indexEntry;
+        _Identifier = identifier;
+
+        _FilePath = indexEntry[kLGAutoPkgRecipePathKey];
+        _recipeFileURL = [NSURL fileURLWithPath:_FilePath isDirectory:NO];
+        _Name = indexEntry[kLGAutoPkgRecipeNameKey];
+
+        _isOverride = [indexEntry[kLGRecipeIndexIsOverrideKey] boolValue];
+
+        _graph = graph;
     }
     return self;
 }
 
+- (LGAutoPkgRecipeGraph *)graph
+{
+    /* Recipes made from a single file, such as a new override,
+     * resolve their parents through a graph that looks them up
+     * in the shared index one at a time. */
+    return _graph ?: sharedIndexRecipeGraph();
+}
+
+- (NSDictionary *)recipePlist
+{
+    if (!_recipePlist && _recipeFileURL) {
+        _recipePlist = [NSDictionary dictionaryWithContentsOfURL:_recipeFileURL];
+    }
+    return _recipePlist;
+}
+
+- (id)indexedValueForKey:(NSString *)key
+{
+    return _indexEntry ? _indexEntry[key] : _recipePlist[key];
+}
+
 - (NSString *)Description
 {
-    return _recipePlist[NSStringFromSelector(_cmd)] ?: [self objectForKey:NSStringFromSelector(_cmd) ofIdentifier:self.ParentRecipe];
+    return [self indexedValueForKey:NSStringFromSelector(_cmd)] ?: [self.graph inheritedValueForKey:NSStringFromSelector(_cmd) ofChainFromIdentifier:self.ParentRecipe];
 }
 
 - (NSString *)MinimumVersion
 {
-    return _recipePlist[NSStringFromSelector(_cmd)] ?: [self objectForKey:NSStringFromSelector(_cmd) ofIdentifier:self.ParentRecipe];
+    return [self indexedValueForKey:NSStringFromSelector(_cmd)] ?: [self.graph inheritedValueForKey:NSStringFromSelector(_cmd) ofChainFromIdentifier:self.ParentRecipe];
 }
 
 - (NSString *)ParentRecipe
 {
-    return _recipePlist[kLGAutoPkgRecipeParentKey];
+    return [self indexedValueForKey:kLGAutoPkgRecipeParentKey];
 }
 
 - (NSArray *)ParentRecipes
 {
-    NSMutableArray *parents;
-    NSString *parentRecipeID = self.ParentRecipe;
-
-    if (parentRecipeID) {
-        // Don't back this up with an iVar since when new recipe repos are
-        // added this could actually trace the origin further back.
-        parents = [NSMutableArray arrayWithObject:parentRecipeID];
-
-        while (true) {
-            NSURL *parentRecipeURL = [_identifierURLStore objectForKey:parentRecipeID];
-            if (parentRecipeURL) {
-                NSDictionary *recipePlist = [NSDictionary dictionaryWithContentsOfURL:parentRecipeURL];
-                parentRecipeID = recipePlist[kLGAutoPkgRecipeParentKey];
-                if (parentRecipeID) {
-                    [parents addObject:parentRecipeID];
-                }
-            } else {
-                break;
-            }
-        }
-    }
-    return [parents copy];
+    // Don't back this up with an iVar since when new recipe repos are
+    // added this could actually trace the origin further back, the
+    // graph is rebuilt when that happens.
+    return [self.graph chainFromIdentifier:self.ParentRecipe];
 }
 
 - (BOOL)isMissingParent
 {
     if (self.ParentRecipe) {
-        return ([_identifierURLStore objectForKey:self.ParentRecipe] == nil);
+        return ([self.graph entryForIdentifier:self.ParentRecipe] == nil);
     }
     return NO;
 }
@@ -137,14 +345,20 @@ static NSMutableDictionary *_identifierURLStore = nil;
     return self.isMissingParent;
 }
 
+- (NSNumber *)lastRunDuration
+{
+    // Recipes are listed by identifier in the recipe list, so that's how they're timed.
+    return [LGAutoPkgRecipeTimings lastTimings][self.Identifier][kLGRecipeJournalDurationKey];
+}
+
 - (NSDictionary *)Input
 {
-    return _recipePlist[NSStringFromSelector(_cmd)];
+    return self.recipePlist[NSStringFromSelector(_cmd)];
 }
 
 - (NSArray *)Process
 {
-    return _recipePlist[NSStringFromSelector(_cmd)];
+    return self.recipePlist[NSStringFromSelector(_cmd)];
 }
 
 #pragma mark - Enabled
@@ -153,18 +367,14 @@ static NSMutableDictionary *_identifierURLStore = nil;
     if ([sender isKindOfClass:[NSButton class]]) {
         self.enabled = sender.state;
         // Double check that enabling of the recipe was successful.
-        dispatch_async(autopkgr_recipe_write_queue(), ^{
-            sender.state = [[[self class] activeRecipes] containsObject:self.Identifier];
-        });
+        sender.state = self.isEnabled;
     }
 }
 
 - (BOOL)isEnabled
 {
-    if (_enabledInitialized == -1) {
-        _enabledInitialized = [[[self class] activeRecipes] containsObject:self.Identifier];
-    }
-    return _enabledInitialized;
+    // The recipe list is kept in memory, so this is just a lookup.
+    return [[LGAutoPkgRecipeList sharedList] containsRecipe:self.Identifier];
 }
 
 - (void)setEnabled:(BOOL)enabled
@@ -175,81 +385,28 @@ static NSMutableDictionary *_identifierURLStore = nil;
         return;
     }
 
-    /* This is all dispatched to a serial queue so a race condition doesn't arise
-     * when multiple recipes are added or removed in rapid succession */
-    dispatch_async(autopkgr_recipe_write_queue(), ^{
-        NSError *error;
-
-        __block NSMutableArray *currentList = [[NSMutableArray alloc] init];
-
-        NSString *recipeListFile = [[self class] defaultRecipeList];
-        NSString *fileContents = [NSString stringWithContentsOfFile:recipeListFile encoding:NSUTF8StringEncoding error:nil];
-
-        /* Get the recipe list and split it by lines and turn it into an array */
-        NSArray *existingList;
-        if ((existingList = fileContents.split_byLine.filtered_noEmptyStrings)) {
-            [currentList addObjectsFromArray:existingList];
-        }
-
-        /* Start by removing any instance of makecatalogs from the list, it's added back in later */
-        [currentList enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
-            if ([obj isEqualToString:kLGMakeCatalogsIdentifier]) {
-                [currentList removeObject:obj];
-            }
-        }];
-
-        if (enabled) {
-            if (![currentList containsObject:self.Identifier]) {
-                [currentList insertObject:self.Identifier atIndex:0];
-            }
-        } else {
-            [currentList removeObject:self.Identifier];
-        }
-
-        /* Enumerate over the list to see if there are any .munki recipes
-         * now listed. If so re-add the makecatalogs recipe. */
-        [currentList enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
-            if ([obj rangeOfString:@"munki"].location != NSNotFound ) {
-                [currentList addObject:kLGMakeCatalogsIdentifier];
-                *stop = YES;
-            }
-        }];
-
-        NSString *recipe_list = [currentList componentsJoinedByString:@"\n"];
-        if (![recipe_list writeToFile:recipeListFile atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
-            NSLog(@"Error while writing %@. %@", recipeListFile, error);
-            return;
-        }
-
-        currentList = nil;
-        _enabledInitialized = enabled;
-    });
+    /* The list is changed in memory right away, and written to
+     * recipe_list.txt once a burst of changes is over. */
+    [[LGAutoPkgRecipeList sharedList] setRecipe:self.Identifier enabled:enabled];
 }
 
 #pragma mark - Checks
 - (BOOL)hasStepProcessor:(NSString *)step
 {
-    NSMutableArray *considered = [NSMutableArray arrayWithObject:_recipePlist];
-
-    for (NSString *identifier in self.ParentRecipes) {
-        NSDictionary *plist = [self recipePlistForIdentifier:identifier];
-        if (plist) {
-            [considered addObject:plist];
+    if (_indexEntry) {
+        if ([_indexEntry[kLGRecipeIndexProcessorsKey] containsObject:step]) {
+            return YES;
         }
-    }
-
-    for (NSDictionary *plist in considered) {
-        NSArray *processes = plist[kLGAutoPkgRecipeProcessKey];
-        if (processes) {
-            if ([processes indexOfObjectPassingTest:^BOOL(NSDictionary *obj, NSUInteger idx, BOOL *stop) {
-                return [obj[@"Processor"] isEqualToString:step];
-                }] != NSNotFound) {
-                return YES;
-            }
+    } else {
+        NSArray *processes = _recipePlist[kLGAutoPkgRecipeProcessKey];
+        if ([processes indexOfObjectPassingTest:^BOOL(NSDictionary *obj, NSUInteger idx, BOOL *stop) {
+            return [obj[@"Processor"] isEqualToString:step];
+            }] != NSNotFound) {
+            return YES;
         }
-    };
+    }
 
-    return NO;
+    return [[self.graph processorsOfChainFromIdentifier:self.ParentRecipe] containsObject:step];
 }
 
 - (BOOL)hasCheckPhase
@@ -262,21 +419,6 @@ static NSMutableDictionary *_identifierURLStore = nil;
     return [self hasStepProcessor:@"PkgCreator"];
 }
 
-#pragma mark - Value retrieval
-- (NSDictionary *)recipePlistForIdentifier:(NSString *)identifier
-{
-    NSURL *recipeURL = [_identifierURLStore objectForKey:identifier];
-    if (recipeURL) {
-        return [NSDictionary dictionaryWithContentsOfURL:recipeURL];
-    }
-    return nil;
-}
-
-- (id)objectForKey:(NSString *)key ofIdentifier:(NSString *)identifier
-{
-    return [self recipePlistForIdentifier:identifier][key];
-}
-
 #pragma mark - Class Methods;
 + (NSArray *)allRecipes
 {
@@ -285,25 +427,23 @@ static NSMutableDictionary *_identifierURLStore = nil;
 
 + (NSArray *)allRecipesFilteringOverlaps:(BOOL)filterOverlaps
 {
-    _identifierURLStore = [[NSMutableDictionary alloc] init];
-    LGDefaults *defaults = [LGDefaults standardUserDefaults];
+    LGAutoPkgRecipeGraph *graph = currentRecipeGraph();
 
     NSMutableArray *allRecipes = [[NSMutableArray alloc] init];
-    NSSet *activeRecipes = [self activeRecipes];
-
-    NSArray *searchDirs = defaults.autoPkgRecipeSearchDirs;
-    for (NSString *searchDir in searchDirs) {
-        if (![searchDir isEqualToString:@"."]) {
-            NSArray *recipeArray = [self findRecipesRecursivelyAtPath:searchDir.stringByExpandingTildeInPath isOverride:NO activeRecipes:activeRecipes];
-            if (recipeArray.count) {
-                [allRecipes addObjectsFromArray:recipeArray];
+    NSMutableArray *overrideArray = [[NSMutableArray alloc] init];
+
+    // The index only reparses recipe files that changed since it was last refreshed.
+    for (NSDictionary *entry in graph.entries) {
+        LGAutoPkgRecipe *recipe = [[LGAutoPkgRecipe alloc] initWithIndexEntry:entry graph:graph];
+        if (recipe) {
+            if (recipe.isOverride) {
+                [overrideArray addObject:recipe];
+            } else {
+                [allRecipes addObject:recipe];
             }
         }
     }
 
-    NSString *recipeOverridePath = defaults.autoPkgRecipeOverridesDir ?: @"~/Library/AutoPkg/RecipeOverrides".stringByExpandingTildeInPath;
-
-    NSArray *overrideArray = [self findRecipesRecursivelyAtPath:recipeOverridePath isOverride:YES activeRecipes:activeRecipes];
     NSMutableArray *validOverrides = [[NSMutableArray alloc] init];
 
     for (LGAutoPkgRecipe *override in overrideArray) {
@@ -343,59 +483,18 @@ static NSMutableDictionary *_identifierURLStore = nil;
     return allRecipes.count ? [allRecipes copy] : nil;
 }
 
-+ (NSArray *)findRecipesRecursivelyAtPath:(NSString *)path isOverride:(BOOL)isOverride activeRecipes:(NSSet *)activeRecipes
++ (NSOrderedSet *)activeRecipes
 {
-    NSMutableArray *recipes = [[NSMutableArray alloc] init];
-
-    if (path && (access(path.UTF8String, F_OK) == 0)) {
-        NSString *matches = [NSString stringWithFormat:@"{%@/{*.recipe,*/*.recipe}}", path];
-
-        glob_t results;
-        glob(matches.UTF8String, GLOB_BRACE | GLOB_NOSORT, NULL, &results);
-        for (int i = 0; i < results.gl_matchc; i++) {
-            NSString *globPath = [NSString stringWithUTF8String:results.gl_pathv[i]];
-            NSURL *fileURL = [NSURL fileURLWithPath:globPath isDirectory:NO];
-
-            if (fileURL) {
-                LGAutoPkgRecipe *recipe = [[LGAutoPkgRecipe alloc] initWithRecipeFile:fileURL isOverride:isOverride];
-                if (recipe) {
-                    [recipes addObject:recipe];
-                    // If it's in the active recipe list, mark it as enabled.
-                    if (activeRecipes) {
-                        if ([activeRecipes containsObject:recipe.Identifier]) {
-                            recipe->_enabledInitialized = YES;
-                        } else {
-                            recipe->_enabledInitialized = NO;
-                        }
-                    }
-                }
-            }
-        }
-        globfree(&results);
-    }
-
-    return [recipes copy];
+    return [[LGAutoPkgRecipeList sharedList] recipes];
 }
 
-+ (NSOrderedSet *)activeRecipes
++ (BOOL)enableRecipes:(NSArray *)enable disableRecipes:(NSArray *)disable
 {
-    NSError *error;
-    NSMutableOrderedSet *activeRecipes = [[NSMutableOrderedSet alloc] init];
+    // The makecatalogs recipe is handled by the recipe list itself.
+    NSPredicate *notMakeCatalogs = [NSPredicate predicateWithFormat:@"SELF != %@", kLGMakeCatalogsIdentifier];
 
-    NSString *recipeList = [self defaultRecipeList];
-    if (recipeList) {
-        NSString *autoPkgrRecipeList = [NSString stringWithContentsOfFile:recipeList encoding:NSUTF8StringEncoding error:&error];
-        if (error) {
-            NSLog(@"Error reading %@.", autoPkgrRecipeList);
-        } else {
-            NSArray *recipes = autoPkgrRecipeList.split_byLine;
-            if (recipes.count) {
-                [activeRecipes addObjectsFromArray:recipes];
-            }
-        }
-    }
-
-    return [activeRecipes copy];
+    return [[LGAutoPkgRecipeList sharedList] updateByAddingRecipes:[enable filteredArrayUsingPredicate:notMakeCatalogs]
+                                                   removingRecipes:[disable filteredArrayUsingPredicate:notMakeCatalogs]];
 }
 
 #pragma mark - Util
@@ -410,16 +509,9 @@ static NSMutableDictionary *_identifierURLStore = nil;
 
 + (BOOL)removeRecipeFromRecipeList:(NSString *)recipe
 {
-    NSError *error;
-    NSMutableOrderedSet *recipes = [[LGAutoPkgRecipe activeRecipes] mutableCopy];
-    [recipes removeObject:recipe];
-
-    NSString *recipe_list = [recipes.array componentsJoinedByString:@"\n"];
-    if (![recipe_list writeToFile:[self defaultRecipeList] atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
-        NSLog(@"%@", error);
-        return NO;
-    }
-    return YES;
+    LGAutoPkgRecipeList *recipeList = [LGAutoPkgRecipeList sharedList];
+    [recipeList setRecipe:recipe enabled:NO];
+    return [recipeList synchronize];
 }
 
 + (BOOL)migrateToIdentifiers:(NSError *__autoreleasing *)error
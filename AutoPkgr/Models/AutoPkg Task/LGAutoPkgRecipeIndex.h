@@ -0,0 +1,125 @@
+//
+//  LGAutoPkgRecipeIndex.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/* Index entries are dictionaries. Recipe values use the same keys as
+ * the recipe plist (kLGAutoPkgRecipeIdentifierKey, kLGAutoPkgRecipeNameKey,
+ * kLGAutoPkgRecipePathKey, kLGAutoPkgRecipeParentKey,
+ * kLGAutoPkgRecipeDescriptionKey, kLGAutoPkgRecipeMinimumVersionKey),
+ * the remaining keys are specific to the index. */
+
+/**
+ *  Array of processor names used in the recipe's Process array.
+ */
+extern NSString *const kLGRecipeIndexProcessorsKey;
+
+/**
+ *  Array of the keys in the recipe's Input dictionary.
+ */
+extern NSString *const kLGRecipeIndexInputKeysKey;
+
+/**
+ *  NSNumber (BOOL) indicating the entry was found in the RecipeOverrides dir.
+ */
+extern NSString *const kLGRecipeIndexIsOverrideKey;
+
+/**
+ *  NSNumber (double) modification time of the recipe file when it was parsed.
+ */
+extern NSString *const kLGRecipeIndexModificationDateKey;
+
+/**
+ *  NSNumber (unsigned long long) inode of the recipe file when it was parsed.
+ */
+extern NSString *const kLGRecipeIndexInodeKey;
+
+/*
+ * LGAutoPkgRecipeIndex keeps the values needed to list recipes in a plist
+ * in the AutoPkgr Application Support directory. When refreshed, only
+ * recipe files whose mtime or inode changed since the last refresh get
+ * parsed again. Queries are answered from memory without touching the
+ * filesystem. When the repos are modified the index is refreshed in the
+ * background, and kLGNotificationRecipeIndexRefreshed is posted on the main
+ * thread once the refreshed entries are in place.
+ */
+@interface LGAutoPkgRecipeIndex : NSObject
+
+/**
+ *  Shared index stored in the AutoPkgr Application Support directory.
+ */
++ (instancetype)sharedIndex;
+
+/**
+ *  Initialize an index backed by a specific file.
+ *
+ *  @param indexFile path to the plist file used to persist the index.
+ */
+- (instancetype)initWithIndexFile:(NSString *)indexFile;
+
+@property (copy, nonatomic, readonly) NSString *indexFile;
+
+/**
+ *  Whether the entries haven't been checked against the recipe dirs since the index was last invalidated.
+ */
+@property (assign, readonly, getter=isStale) BOOL stale;
+
+/**
+ *  Incremented whenever the entries change, so values derived from them know when to start over.
+ */
+@property (assign, readonly) NSUInteger generation;
+
+/**
+ *  Mark the index as stale and refresh it in the background.
+ *  @note This is called whenever kLGNotificationReposModified is posted.
+ */
+- (void)invalidate;
+
+/**
+ *  Revalidate the index against the recipe search dirs and overrides dir now.
+ *  @note This blocks until the recipe dirs have been walked, don't call it on the main thread.
+ *
+ *  @return the number of recipe files that needed to be (re)parsed.
+ */
+- (NSInteger)refresh;
+
+/**
+ *  All index entries, as of the last refresh.
+ */
+- (NSArray *)entries;
+
+/**
+ *  Entry for a recipe identifier.
+ *
+ *  @param identifier recipe identifier.
+ *
+ *  @return the index entry or nil if no recipe with that identifier exists.
+ */
+- (NSDictionary *)entryForIdentifier:(NSString *)identifier;
+
+/**
+ *  Entries whose Name or Identifier contain a string.
+ *
+ *  @param searchString string to match, case and diacritic insensitive.
+ *
+ *  @return array of matching index entries.
+ */
+- (NSArray *)entriesMatchingString:(NSString *)searchString;
+
+@end
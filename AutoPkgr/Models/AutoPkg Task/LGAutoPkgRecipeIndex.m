@@ -0,0 +1,392 @@
+//
+//  LGAutoPkgRecipeIndex.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRecipeIndex.h"
+#import "LGAutoPkgTask.h"
+
+#import <glob.h>
+#import <sys/stat.h>
+
+NSString *const kLGRecipeIndexProcessorsKey = @"processors";
+NSString *const kLGRecipeIndexInputKeysKey = @"inputKeys";
+NSString *const kLGRecipeIndexIsOverrideKey = @"isOverride";
+NSString *const kLGRecipeIndexModificationDateKey = @"mtime";
+NSString *const kLGRecipeIndexInodeKey = @"inode";
+
+static NSString *const kLGRecipeIndexFileName = @"RecipeIndex.plist";
+static NSString *const kLGRecipeIndexVersionKey = @"version";
+static NSString *const kLGRecipeIndexEntriesKey = @"entries";
+
+// Bump this when the layout of an entry changes so old indexes get discarded.
+static NSInteger const kLGRecipeIndexVersion = 2;
+
+#pragma mark - Helpers
+static NSArray *recipeFilesAtPath(NSString *path)
+{
+    NSMutableArray *recipeFiles = [[NSMutableArray alloc] init];
+
+    if (path && (access(path.UTF8String, F_OK) == 0)) {
+        NSString *matches = [NSString stringWithFormat:@"{%@/{*.recipe,*/*.recipe}}", path];
+
+        glob_t results;
+        glob(matches.UTF8String, GLOB_BRACE | GLOB_NOSORT, NULL, &results);
+        for (int i = 0; i < results.gl_matchc; i++) {
+            [recipeFiles addObject:[NSString stringWithUTF8String:results.gl_pathv[i]]];
+        }
+        globfree(&results);
+    }
+
+    return [recipeFiles copy];
+}
+
+static double modificationTimeOfStat(const struct stat *st)
+{
+    return st->st_mtimespec.tv_sec + (st->st_mtimespec.tv_nsec / 1e9);
+}
+
+static BOOL entryMatchesStat(NSDictionary *entry, const struct stat *st, BOOL isOverride)
+{
+    return ([entry[kLGRecipeIndexModificationDateKey] doubleValue] == modificationTimeOfStat(st) &&
+            [entry[kLGRecipeIndexInodeKey] unsignedLongLongValue] == st->st_ino &&
+            [entry[kLGRecipeIndexIsOverrideKey] boolValue] == isOverride);
+}
+
+/* Parse a recipe file into an index entry. Files that can't be parsed, or
+ * that have no identifier still get an entry (without an Identifier) so
+ * they aren't parsed again until they change. */
+static NSDictionary *indexEntryForRecipeFile(NSString *path, const struct stat *st, BOOL isOverride)
+{
+    NSMutableDictionary *entry = [[NSMutableDictionary alloc] init];
+    entry[kLGAutoPkgRecipePathKey] = path;
+    entry[kLGRecipeIndexModificationDateKey] = @(modificationTimeOfStat(st));
+    entry[kLGRecipeIndexInodeKey] = @((unsigned long long)st->st_ino);
+    entry[kLGRecipeIndexIsOverrideKey] = @(isOverride);
+
+    NSDictionary *recipePlist = [NSDictionary dictionaryWithContentsOfFile:path];
+    id identifier = recipePlist[kLGAutoPkgRecipeIdentifierKey] ?: recipePlist[kLGAutoPkgRecipeInputKey][@"IDENTIFIER"];
+
+    if ([identifier isKindOfClass:[NSString class]]) {
+        entry[kLGAutoPkgRecipeIdentifierKey] = identifier;
+        entry[kLGAutoPkgRecipeNameKey] = [[path lastPathComponent] stringByDeletingPathExtension];
+
+        for (NSString *key in @[ kLGAutoPkgRecipeParentKey, kLGAutoPkgRecipeDescriptionKey, kLGAutoPkgRecipeMinimumVersionKey ]) {
+            id value = recipePlist[key];
+            if ([value isKindOfClass:[NSString class]]) {
+                entry[key] = value;
+            }
+        }
+
+        NSMutableArray *processors = [[NSMutableArray alloc] init];
+        id process = recipePlist[kLGAutoPkgRecipeProcessKey];
+        if ([process isKindOfClass:[NSArray class]]) {
+            for (id step in process) {
+                if ([step isKindOfClass:[NSDictionary class]] && [step[@"Processor"] isKindOfClass:[NSString class]]) {
+                    [processors addObject:step[@"Processor"]];
+                }
+            }
+        }
+        entry[kLGRecipeIndexProcessorsKey] = [processors copy];
+
+        id input = recipePlist[kLGAutoPkgRecipeInputKey];
+        entry[kLGRecipeIndexInputKeysKey] = [input isKindOfClass:[NSDictionary class]] ? [input allKeys] : @[];
+    }
+
+    return [entry copy];
+}
+
+#pragma mark - Recipe Index
+@implementation LGAutoPkgRecipeIndex {
+    NSMutableDictionary *_entriesByPath;
+    NSArray *_entries;
+    NSDictionary *_entriesByIdentifier;
+
+    // Refreshes run one at a time on this queue.
+    dispatch_queue_t _refreshQueue;
+    BOOL _refreshScheduled;
+}
+
+@synthesize stale = _stale, generation = _generation;
+
++ (instancetype)sharedIndex
+{
+    static LGAutoPkgRecipeIndex *sharedIndex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *indexFile;
+        NSString *autoPkgrSupportDirectory = [LGHostInfo getAppSupportDirectory];
+        if (autoPkgrSupportDirectory.length) {
+            indexFile = [autoPkgrSupportDirectory stringByAppendingPathComponent:kLGRecipeIndexFileName];
+        }
+        sharedIndex = [[self alloc] initWithIndexFile:indexFile];
+
+        // Queries are answered from the index file until the first refresh is done.
+        [sharedIndex invalidate];
+    });
+    return sharedIndex;
+}
+
+- (instancetype)init
+{
+    return [self initWithIndexFile:nil];
+}
+
+- (instancetype)initWithIndexFile:(NSString *)indexFile
+{
+    if (self = [super init]) {
+        _indexFile = indexFile;
+        _entriesByPath = [self readIndexFile] ?: [[NSMutableDictionary alloc] init];
+        _refreshQueue = dispatch_queue_create("com.lindegroup.autopkgr.recipe.index", DISPATCH_QUEUE_SERIAL);
+
+        // Search dir recipes before overrides, the same order a refresh uses.
+        NSSortDescriptor *overridesLast = [NSSortDescriptor sortDescriptorWithKey:kLGRecipeIndexIsOverrideKey ascending:YES];
+        NSSortDescriptor *byPath = [NSSortDescriptor sortDescriptorWithKey:kLGAutoPkgRecipePathKey ascending:YES];
+        NSPredicate *hasIdentifier = [NSPredicate predicateWithFormat:@"%K != nil", kLGAutoPkgRecipeIdentifierKey];
+
+        [self setEntries:[[_entriesByPath.allValues filteredArrayUsingPredicate:hasIdentifier] sortedArrayUsingDescriptors:@[ overridesLast, byPath ]]];
+
+        // Nothing has been checked against the recipe dirs yet.
+        _stale = YES;
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(invalidate)
+                                                     name:kLGNotificationReposModified
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void)setEntries:(NSArray *)entries
+{
+    // Only called while synchronized on self (or from init).
+    NSMutableDictionary *entriesByIdentifier = [[NSMutableDictionary alloc] initWithCapacity:entries.count];
+    for (NSDictionary *entry in entries) {
+        entriesByIdentifier[entry[kLGAutoPkgRecipeIdentifierKey]] = entry;
+    }
+
+    _entries = [entries copy];
+    _entriesByIdentifier = [entriesByIdentifier copy];
+    _generation++;
+}
+
+#pragma mark - Validation
+- (BOOL)isStale
+{
+    @synchronized(self)
+    {
+        return _stale;
+    }
+}
+
+- (NSUInteger)generation
+{
+    @synchronized(self)
+    {
+        return _generation;
+    }
+}
+
+- (void)invalidate
+{
+    @synchronized(self)
+    {
+        _stale = YES;
+        if (_refreshScheduled) {
+            return;
+        }
+        _refreshScheduled = YES;
+    }
+
+    // Repos are usually modified a few times in a row, so refresh once they settle.
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), _refreshQueue, ^{
+        @synchronized(self)
+        {
+            _refreshScheduled = NO;
+        }
+        [self refreshEntries];
+    });
+}
+
+- (NSInteger)refresh
+{
+    __block NSInteger parsed = 0;
+    dispatch_sync(_refreshQueue, ^{
+        parsed = [self refreshEntries];
+    });
+    return parsed;
+}
+
+/* Walk the recipe dirs without holding the lock, so queries
+ * are still answered from memory while the index refreshes.
+ * Only called on the refresh queue. */
+- (NSInteger)refreshEntries
+{
+    LGDefaults *defaults = [LGDefaults standardUserDefaults];
+    NSInteger parsed = 0;
+
+    NSDictionary *previousEntriesByPath;
+    @synchronized(self)
+    {
+        previousEntriesByPath = [_entriesByPath copy];
+
+        // Anything invalidated from here on needs another refresh.
+        _stale = NO;
+    }
+
+    // Search dirs first and overrides last, this mirrors the order autopkg uses.
+    NSMutableArray *directories = [[NSMutableArray alloc] init];
+    for (NSString *searchDir in defaults.autoPkgRecipeSearchDirs) {
+        if (![searchDir isEqualToString:@"."]) {
+            [directories addObject:@[ searchDir.stringByExpandingTildeInPath, @NO ]];
+        }
+    }
+
+    NSString *recipeOverridePath = defaults.autoPkgRecipeOverridesDir ?: @"~/Library/AutoPkg/RecipeOverrides".stringByExpandingTildeInPath;
+    [directories addObject:@[ recipeOverridePath, @YES ]];
+
+    NSMutableDictionary *entriesByPath = [[NSMutableDictionary alloc] initWithCapacity:previousEntriesByPath.count];
+    NSMutableArray *entries = [[NSMutableArray alloc] initWithCapacity:previousEntriesByPath.count];
+
+    for (NSArray *directory in directories) {
+        BOOL isOverride = [directory.lastObject boolValue];
+
+        for (NSString *recipeFile in recipeFilesAtPath(directory.firstObject)) {
+            struct stat st;
+            if (stat(recipeFile.fileSystemRepresentation, &st) != 0) {
+                continue;
+            }
+
+            NSDictionary *entry = previousEntriesByPath[recipeFile];
+            if (!entry || !entryMatchesStat(entry, &st, isOverride)) {
+                entry = indexEntryForRecipeFile(recipeFile, &st, isOverride);
+                parsed++;
+            }
+
+            entriesByPath[recipeFile] = entry;
+            if (entry[kLGAutoPkgRecipeIdentifierKey]) {
+                [entries addObject:entry];
+            }
+        }
+    }
+
+    BOOL changed = (parsed || ![[NSSet setWithArray:entriesByPath.allKeys] isEqualToSet:[NSSet setWithArray:previousEntriesByPath.allKeys]]);
+
+    @synchronized(self)
+    {
+        _entriesByPath = entriesByPath;
+
+        // Keep the same entries array when nothing changed, so the
+        // recipe graph built from it doesn't need to be rebuilt.
+        if (changed) {
+            [self setEntries:entries];
+        }
+    }
+
+    if (changed) {
+        [self writeIndexFileWithEntries:entriesByPath];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:kLGNotificationRecipeIndexRefreshed object:self];
+        });
+    }
+
+    DevLog(@"Recipe index refreshed, %ld of %ld recipe files parsed.", (long)parsed, (long)entriesByPath.count);
+    return parsed;
+}
+
+#pragma mark - Query
+- (NSArray *)entries
+{
+    @synchronized(self)
+    {
+        return _entries;
+    }
+}
+
+- (NSDictionary *)entryForIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return nil;
+    }
+
+    @synchronized(self)
+    {
+        return _entriesByIdentifier[identifier];
+    }
+}
+
+- (NSArray *)entriesMatchingString:(NSString *)searchString
+{
+    NSArray *entries = [self entries];
+    if (!searchString.length) {
+        return entries;
+    }
+
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"%K CONTAINS[cd] %@ OR %K CONTAINS[cd] %@", kLGAutoPkgRecipeNameKey, searchString, kLGAutoPkgRecipeIdentifierKey, searchString];
+
+    return [entries filteredArrayUsingPredicate:predicate];
+}
+
+#pragma mark - Persistence
+- (NSMutableDictionary *)readIndexFile
+{
+    if (!_indexFile) {
+        return nil;
+    }
+
+    NSData *data = [NSData dataWithContentsOfFile:_indexFile];
+    if (!data) {
+        return nil;
+    }
+
+    NSDictionary *index = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil];
+
+    if (![index isKindOfClass:[NSDictionary class]] ||
+        [index[kLGRecipeIndexVersionKey] integerValue] != kLGRecipeIndexVersion ||
+        ![index[kLGRecipeIndexEntriesKey] isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+
+    return [index[kLGRecipeIndexEntriesKey] mutableCopy];
+}
+
+- (BOOL)writeIndexFileWithEntries:(NSDictionary *)entriesByPath
+{
+    if (!_indexFile) {
+        return NO;
+    }
+
+    NSError *error;
+    NSDictionary *index = @{ kLGRecipeIndexVersionKey : @(kLGRecipeIndexVersion),
+                             kLGRecipeIndexEntriesKey : entriesByPath };
+
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:index format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+
+    if (!data || ![data writeToFile:_indexFile options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"Error while writing %@. %@", _indexFile, error);
+        return NO;
+    }
+    return YES;
+}
+
+@end
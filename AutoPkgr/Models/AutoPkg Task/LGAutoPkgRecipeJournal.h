@@ -0,0 +1,142 @@
+//
+//  LGAutoPkgRecipeJournal.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LGAutoPkgRecipeIndex;
+
+// Recipe record keys.
+extern NSString *const kLGRecipeJournalRecipeKey;
+extern NSString *const kLGRecipeJournalStatusKey;
+extern NSString *const kLGRecipeJournalMessageKey;
+extern NSString *const kLGRecipeJournalProcessorsKey;
+extern NSString *const kLGRecipeJournalDownloadPathKey;
+extern NSString *const kLGRecipeJournalReceiptPathKey;
+extern NSString *const kLGRecipeJournalStartedKey;
+extern NSString *const kLGRecipeJournalFinishedKey;
+extern NSString *const kLGRecipeJournalDurationKey;
+extern NSString *const kLGRecipeJournalBytesDownloadedKey;
+
+/**
+ *  Key for the processor steps of a recipe record, in the order they ran.
+ *  Each step is a dictionary with the processor, started and duration keys.
+ */
+extern NSString *const kLGRecipeJournalStepsKey;
+extern NSString *const kLGRecipeJournalProcessorKey;
+
+// Upstream check result keys, from the URLDownloader step of the receipt.
+extern NSString *const kLGRecipeJournalETagKey;
+extern NSString *const kLGRecipeJournalLastModifiedKey;
+extern NSString *const kLGRecipeJournalDownloadSizeKey;
+
+// Version the recipe found, and whether it imported anything into Munki or the JSS, from the receipt.
+extern NSString *const kLGRecipeJournalVersionKey;
+extern NSString *const kLGRecipeJournalImportedKey;
+
+// Values for kLGRecipeJournalStatusKey.
+extern NSString *const kLGRecipeJournalStatusSucceeded;
+extern NSString *const kLGRecipeJournalStatusFailed;
+extern NSString *const kLGRecipeJournalStatusIncomplete;
+
+/**
+ *  Report key for the array of recipe records in reports assembled from a journal.
+ */
+extern NSString *const kLGRecipeJournalReportKey;
+
+/*
+ * LGAutoPkgRecipeJournal follows the `autopkg run -v` output stream and
+ * turns each recipe's outcome into a record as soon as the recipe's receipt
+ * is written. Every record is immediately appended (as a line of JSON) to
+ * the journal file, so results survive a crash or a canceled run. The
+ * task manager recovers the journals of interrupted runs on the next launch.
+ *
+ * Records are timed from the recipe's "Processing" line to its receipt,
+ * and each processor step from the line naming it to the next step. Only
+ * the processors the recipe index lists for the recipe and its parents
+ * start a step, and steps the receipt doesn't list are discarded.
+ */
+@interface LGAutoPkgRecipeJournal : NSObject
+
+/**
+ *  Initialize a journal.
+ *
+ *  @param journalFile path of the file records are appended to, or nil to only keep them in memory.
+ */
+- (instancetype)initWithJournalFile:(NSString *)journalFile;
+
+/**
+ *  Initialize a journal.
+ *
+ *  @param journalFile path of the file records are appended to, or nil to only keep them in memory.
+ *  @param recipeIndex index used to look up the processors of each recipe, the shared index by default.
+ */
+- (instancetype)initWithJournalFile:(NSString *)journalFile recipeIndex:(LGAutoPkgRecipeIndex *)recipeIndex;
+
+@property (copy, nonatomic, readonly) NSString *journalFile;
+@property (strong, nonatomic, readonly) LGAutoPkgRecipeIndex *recipeIndex;
+
+/**
+ *  Array of recipe record dictionaries completed so far.
+ */
+@property (copy, readonly) NSArray *records;
+
+/**
+ *  Follow output from an autopkg run.
+ *
+ *  @param string stdout of autopkg run -v, the string doesn't need to end on a line break.
+ */
+- (void)parseString:(NSString *)string;
+
+/**
+ *  Follow a single complete line of output from an autopkg run.
+ *
+ *  @param line line of stdout of autopkg run -v, without the line break.
+ */
+- (void)parseLine:(NSString *)line;
+
+/**
+ *  Record the recipe still being processed, if any, as incomplete.
+ *  @note call this once the autopkg process has exited.
+ */
+- (void)finish;
+
+/**
+ *  Report dictionary in the --report-plist format assembled from the records so far.
+ *  @discussion failed recipes are listed under "failures", new downloads under
+ *  the url_downloader summary result, and all records under kLGRecipeJournalReportKey.
+ */
+- (NSDictionary *)report;
+
+/**
+ *  Read the records of an existing journal file, such as one left behind by a crash.
+ *
+ *  @param journalFile path to the journal file.
+ *
+ *  @return Array of recipe record dictionaries.
+ */
++ (NSArray *)recordsFromJournalFile:(NSString *)journalFile;
+
+/**
+ *  Report dictionary in the --report-plist format assembled from records.
+ *
+ *  @param records Array of recipe record dictionaries.
+ */
++ (NSDictionary *)reportWithRecords:(NSArray *)records;
+
+@end
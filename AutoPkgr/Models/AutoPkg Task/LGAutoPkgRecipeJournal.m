@@ -0,0 +1,480 @@
+//
+//  LGAutoPkgRecipeJournal.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRecipeJournal.h"
+#import "LGAutoPkgRecipeIndex.h"
+#import "LGAutoPkgRecipeTimings.h"
+#import "LGAutoPkgTask.h"
+#import "LGAutoPkgr.h"
+
+NSString *const kLGRecipeJournalRecipeKey = @"recipe";
+NSString *const kLGRecipeJournalStatusKey = @"status";
+NSString *const kLGRecipeJournalMessageKey = @"message";
+NSString *const kLGRecipeJournalProcessorsKey = @"processors";
+NSString *const kLGRecipeJournalDownloadPathKey = @"download_path";
+NSString *const kLGRecipeJournalReceiptPathKey = @"receipt_path";
+NSString *const kLGRecipeJournalStartedKey = @"started";
+NSString *const kLGRecipeJournalFinishedKey = @"finished";
+NSString *const kLGRecipeJournalDurationKey = @"duration";
+NSString *const kLGRecipeJournalBytesDownloadedKey = @"bytes_downloaded";
+NSString *const kLGRecipeJournalStepsKey = @"steps";
+NSString *const kLGRecipeJournalProcessorKey = @"processor";
+
+NSString *const kLGRecipeJournalETagKey = @"etag";
+NSString *const kLGRecipeJournalLastModifiedKey = @"last_modified";
+NSString *const kLGRecipeJournalDownloadSizeKey = @"download_size";
+
+NSString *const kLGRecipeJournalVersionKey = @"version";
+NSString *const kLGRecipeJournalImportedKey = @"imported";
+
+NSString *const kLGRecipeJournalStatusSucceeded = @"succeeded";
+NSString *const kLGRecipeJournalStatusFailed = @"failed";
+NSString *const kLGRecipeJournalStatusIncomplete = @"incomplete";
+
+NSString *const kLGRecipeJournalReportKey = @"recipe_results";
+
+// Line prefixes / suffixes of autopkg run -v output.
+static NSString *const kLGProcessingPrefix = @"Processing ";
+static NSString *const kLGProcessingSuffix = @"...";
+static NSString *const kLGReceiptPrefix = @"Receipt written to ";
+static NSString *const kLGDownloadedPrefix = @"URLDownloader: Downloaded ";
+
+// Whether the output of a receipt step says something was imported, e.g. a
+// munki_importer_summary_result or jss_importer_summary_result with data rows.
+static BOOL isImportOutput(NSDictionary *output)
+{
+    if ([output[@"munki_repo_changed"] boolValue]) {
+        return YES;
+    }
+
+    for (NSString *key in output) {
+        if ([key hasSuffix:@"importer_summary_result"] && [output[key] isKindOfClass:[NSDictionary class]]) {
+            id dataRows = output[key][@"data_rows"];
+            if ([dataRows isKindOfClass:[NSArray class]] && [dataRows count]) {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+/* Processor names used by a recipe and its parents, from the recipe index.
+ * Returns nil when the recipe, or one of its parents, isn't in the index. */
+static NSSet *processorsOfRecipe(NSString *recipe, LGAutoPkgRecipeIndex *index)
+{
+    NSMutableSet *processors = [[NSMutableSet alloc] init];
+    NSMutableSet *visited = [[NSMutableSet alloc] init];
+
+    NSString *identifier = recipe;
+    while (identifier && ![visited containsObject:identifier]) {
+        NSDictionary *entry = [index entryForIdentifier:identifier];
+        if (!entry) {
+            return nil;
+        }
+        [visited addObject:identifier];
+        [processors addObjectsFromArray:entry[kLGRecipeIndexProcessorsKey]];
+        identifier = entry[kLGAutoPkgRecipeParentKey];
+    }
+    return [processors copy];
+}
+
+/* In verbose mode autopkg prints each step's Processor value on a line of its own
+ * before running it, e.g. "URLDownloader" or "com.github.homebysix.VersionSplitter/VersionSplitter".
+ * When the recipe's processors are known only those match, otherwise the line must
+ * be a processor class name, optionally prefixed by the identifier of its recipe. */
+static BOOL isProcessorLine(NSString *line, NSSet *knownProcessors)
+{
+    if (knownProcessors) {
+        return [knownProcessors containsObject:line];
+    }
+
+    static NSRegularExpression *processorHeader;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        processorHeader = [NSRegularExpression regularExpressionWithPattern:@"^(?:[A-Za-z0-9_.-]+/)?[A-Za-z_][A-Za-z0-9_]*$" options:0 error:nil];
+    });
+
+    return line.length && [processorHeader numberOfMatchesInString:line options:0 range:NSMakeRange(0, line.length)];
+}
+
+static NSNumber *timestamp()
+{
+    return @([[NSDate date] timeIntervalSince1970]);
+}
+
+@implementation LGAutoPkgRecipeJournal {
+    NSMutableArray *_records;
+    NSMutableDictionary *_currentRecord;
+    NSMutableArray *_currentSteps;
+    NSSet *_currentProcessors;
+    NSMutableDictionary *_processorsByRecipe;
+    NSMutableString *_pendingLine;
+    NSFileHandle *_fileHandle;
+}
+
+- (instancetype)init
+{
+    return [self initWithJournalFile:nil];
+}
+
+- (instancetype)initWithJournalFile:(NSString *)journalFile
+{
+    return [self initWithJournalFile:journalFile recipeIndex:[LGAutoPkgRecipeIndex sharedIndex]];
+}
+
+- (instancetype)initWithJournalFile:(NSString *)journalFile recipeIndex:(LGAutoPkgRecipeIndex *)recipeIndex
+{
+    if (self = [super init]) {
+        _journalFile = journalFile;
+        _recipeIndex = recipeIndex;
+        _records = [[NSMutableArray alloc] init];
+        _processorsByRecipe = [[NSMutableDictionary alloc] init];
+        _pendingLine = [[NSMutableString alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_fileHandle closeFile];
+}
+
+#pragma mark - Parsing
+- (void)parseString:(NSString *)string
+{
+    if (!string.length) {
+        return;
+    }
+
+    @synchronized(self)
+    {
+        // Output arrives in arbitrary chunks, so only act on complete lines.
+        [_pendingLine appendString:string];
+
+        NSArray *lines = [_pendingLine componentsSeparatedByString:@"\n"];
+        [_pendingLine setString:lines.lastObject];
+
+        for (NSUInteger i = 0; i < lines.count - 1; i++) {
+            [self evaluateLine:lines[i]];
+        }
+    }
+}
+
+- (void)parseLine:(NSString *)line
+{
+    @synchronized(self)
+    {
+        [self evaluateLine:line];
+    }
+}
+
+- (void)evaluateLine:(NSString *)line
+{
+    line = [line stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+
+    if ([line hasPrefix:kLGProcessingPrefix] && [line hasSuffix:kLGProcessingSuffix]) {
+        // Without a receipt the previous recipe's outcome is all that was seen on stdout.
+        if (_currentRecord) {
+            [self completeCurrentRecordWithStatus:kLGRecipeJournalStatusSucceeded];
+        }
+
+        NSRange range = NSMakeRange(kLGProcessingPrefix.length, line.length - kLGProcessingPrefix.length - kLGProcessingSuffix.length);
+        NSString *recipe = [line substringWithRange:range];
+
+        _currentRecord = [@{ kLGRecipeJournalRecipeKey : recipe,
+                             kLGRecipeJournalStartedKey : timestamp() } mutableCopy];
+        _currentSteps = [[NSMutableArray alloc] init];
+        _currentProcessors = [self processorsOfRecipe:recipe];
+
+    } else if (_currentRecord && isProcessorLine(line, _currentProcessors)) {
+        [self finishCurrentStep];
+        [_currentSteps addObject:[@{ kLGRecipeJournalProcessorKey : line,
+                                     kLGRecipeJournalStartedKey : timestamp() } mutableCopy]];
+
+    } else if (_currentRecord && [line hasPrefix:kLGDownloadedPrefix]) {
+        _currentRecord[kLGRecipeJournalDownloadPathKey] = [line substringFromIndex:kLGDownloadedPrefix.length];
+
+    } else if (_currentRecord && [line hasPrefix:kLGReceiptPrefix]) {
+        NSString *receiptPath = [line substringFromIndex:kLGReceiptPrefix.length];
+        _currentRecord[kLGRecipeJournalReceiptPathKey] = receiptPath;
+
+        [self completeCurrentRecordWithStatus:[self evaluateReceipt:receiptPath]];
+    }
+}
+
+/* Resolved once per recipe, so the index isn't walked again when
+ * a recipe list names the same recipe more than once. */
+- (NSSet *)processorsOfRecipe:(NSString *)recipe
+{
+    id processors = _processorsByRecipe[recipe];
+    if (!processors) {
+        processors = processorsOfRecipe(recipe, _recipeIndex) ?: [NSNull null];
+        _processorsByRecipe[recipe] = processors;
+    }
+    return (processors == [NSNull null]) ? nil : processors;
+}
+
+/* The receipt is an array with one dictionary per processor step and, when
+ * the recipe failed, a dictionary with a RecipeError key. The download's
+ * etag, last modified date and size are kept even when nothing new was
+ * downloaded, they tell whether the upstream file changed. The last version
+ * any step output is the recipe's version. Returns the status. */
+- (NSString *)evaluateReceipt:(NSString *)receiptPath
+{
+    NSString *status = kLGRecipeJournalStatusSucceeded;
+    NSArray *receipt = [NSArray arrayWithContentsOfFile:receiptPath];
+    NSMutableArray *processors = [[NSMutableArray alloc] init];
+
+    for (NSDictionary *step in receipt) {
+        if (![step isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+
+        if (step[@"RecipeError"]) {
+            status = kLGRecipeJournalStatusFailed;
+            _currentRecord[kLGRecipeJournalMessageKey] = [step[@"RecipeError"] description];
+        }
+
+        if ([step[@"Processor"] isKindOfClass:[NSString class]]) {
+            [processors addObject:step[@"Processor"]];
+        }
+
+        NSDictionary *output = step[@"Output"];
+        if (![output isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+
+        for (NSString *key in @[ kLGRecipeJournalETagKey, kLGRecipeJournalLastModifiedKey ]) {
+            if ([output[key] isKindOfClass:[NSString class]] && [output[key] length]) {
+                _currentRecord[key] = output[key];
+            }
+        }
+
+        if ([output[@"version"] isKindOfClass:[NSString class]] && [output[@"version"] length]) {
+            _currentRecord[kLGRecipeJournalVersionKey] = output[@"version"];
+        }
+
+        if (isImportOutput(output)) {
+            _currentRecord[kLGRecipeJournalImportedKey] = @YES;
+        }
+
+        if ([output[@"pathname"] isKindOfClass:[NSString class]]) {
+            NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:output[@"pathname"] error:nil];
+            if (attributes) {
+                _currentRecord[kLGRecipeJournalDownloadSizeKey] = @(attributes.fileSize);
+            }
+
+            if ([output[@"download_changed"] boolValue]) {
+                _currentRecord[kLGRecipeJournalDownloadPathKey] = output[@"pathname"];
+                if (attributes) {
+                    _currentRecord[kLGRecipeJournalBytesDownloadedKey] = @(attributes.fileSize);
+                }
+            }
+        }
+    }
+
+    if (processors.count) {
+        _currentRecord[kLGRecipeJournalProcessorsKey] = [processors copy];
+        [self discardStepsNotInProcessors:processors];
+    }
+    return status;
+}
+
+/* A processor's own output can still look like a processor name when the
+ * recipe wasn't in the index. The receipt lists the steps that really ran,
+ * the time of a discarded step goes to the step that was running before it. */
+- (void)discardStepsNotInProcessors:(NSArray *)processors
+{
+    [self finishCurrentStep];
+
+    NSMutableArray *steps = [[NSMutableArray alloc] initWithCapacity:_currentSteps.count];
+    for (NSMutableDictionary *step in _currentSteps) {
+        if ([processors containsObject:step[kLGRecipeJournalProcessorKey]]) {
+            [steps addObject:step];
+            continue;
+        }
+
+        NSMutableDictionary *previousStep = steps.lastObject;
+        if (previousStep) {
+            double finished = [step[kLGRecipeJournalStartedKey] doubleValue] + [step[kLGRecipeJournalDurationKey] doubleValue];
+            previousStep[kLGRecipeJournalDurationKey] = @(finished - [previousStep[kLGRecipeJournalStartedKey] doubleValue]);
+        }
+    }
+    _currentSteps = steps;
+}
+
+- (void)finishCurrentStep
+{
+    NSMutableDictionary *step = _currentSteps.lastObject;
+    if (step && !step[kLGRecipeJournalDurationKey]) {
+        step[kLGRecipeJournalDurationKey] = @([timestamp() doubleValue] - [step[kLGRecipeJournalStartedKey] doubleValue]);
+    }
+}
+
+- (void)completeCurrentRecordWithStatus:(NSString *)status
+{
+    NSNumber *finished = timestamp();
+    [self finishCurrentStep];
+
+    _currentRecord[kLGRecipeJournalStatusKey] = status;
+    _currentRecord[kLGRecipeJournalFinishedKey] = finished;
+    _currentRecord[kLGRecipeJournalDurationKey] = @(finished.doubleValue - [_currentRecord[kLGRecipeJournalStartedKey] doubleValue]);
+
+    if (_currentSteps.count) {
+        NSMutableArray *steps = [[NSMutableArray alloc] initWithCapacity:_currentSteps.count];
+        for (NSDictionary *step in _currentSteps) {
+            [steps addObject:[step copy]];
+        }
+        _currentRecord[kLGRecipeJournalStepsKey] = [steps copy];
+    }
+
+    // Without a receipt, a download seen on stdout is all there is to go by.
+    NSString *downloadPath = _currentRecord[kLGRecipeJournalDownloadPathKey];
+    if (downloadPath && !_currentRecord[kLGRecipeJournalBytesDownloadedKey]) {
+        NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:downloadPath error:nil];
+        if (attributes) {
+            _currentRecord[kLGRecipeJournalBytesDownloadedKey] = @(attributes.fileSize);
+        }
+    }
+
+    NSDictionary *record = [_currentRecord copy];
+    _currentRecord = nil;
+    _currentSteps = nil;
+    _currentProcessors = nil;
+
+    [_records addObject:record];
+    [self appendRecordToJournalFile:record];
+}
+
+- (void)finish
+{
+    @synchronized(self)
+    {
+        if (_pendingLine.length) {
+            [self evaluateLine:_pendingLine];
+            [_pendingLine setString:@""];
+        }
+
+        if (_currentRecord) {
+            [self completeCurrentRecordWithStatus:kLGRecipeJournalStatusIncomplete];
+        }
+
+        [_fileHandle closeFile];
+        _fileHandle = nil;
+    }
+}
+
+#pragma mark - Journal File
+- (void)appendRecordToJournalFile:(NSDictionary *)record
+{
+    if (!_journalFile) {
+        return;
+    }
+
+    NSError *error;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:record options:0 error:&error];
+    if (!data) {
+        NSLog(@"Error serializing recipe record for %@. %@", record[kLGRecipeJournalRecipeKey], error);
+        return;
+    }
+
+    if (!_fileHandle) {
+        NSFileManager *manager = [NSFileManager defaultManager];
+        if (![manager fileExistsAtPath:_journalFile]) {
+            [manager createFileAtPath:_journalFile contents:nil attributes:nil];
+        }
+        _fileHandle = [NSFileHandle fileHandleForWritingAtPath:_journalFile];
+        [_fileHandle seekToEndOfFile];
+    }
+
+    NSMutableData *line = [data mutableCopy];
+    [line appendBytes:"\n" length:1];
+
+    @try {
+        [_fileHandle writeData:line];
+        [_fileHandle synchronizeFile];
+    }
+    @catch (NSException *exception)
+    {
+        NSLog(@"Error writing to %@. %@", _journalFile, exception.reason);
+    }
+}
+
++ (NSArray *)recordsFromJournalFile:(NSString *)journalFile
+{
+    NSMutableArray *records = [[NSMutableArray alloc] init];
+    NSString *contents = [NSString stringWithContentsOfFile:journalFile encoding:NSUTF8StringEncoding error:nil];
+
+    for (NSString *line in contents.split_byLine) {
+        NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
+        // A crash can leave the last line half written, just skip it.
+        id record = data.length ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+        if ([record isKindOfClass:[NSDictionary class]]) {
+            [records addObject:record];
+        }
+    }
+    return [records copy];
+}
+
+#pragma mark - Report
+- (NSArray *)records
+{
+    @synchronized(self)
+    {
+        return [_records copy];
+    }
+}
+
+- (NSDictionary *)report
+{
+    return [[self class] reportWithRecords:self.records];
+}
+
++ (NSDictionary *)reportWithRecords:(NSArray *)records
+{
+    NSMutableArray *failures = [[NSMutableArray alloc] init];
+    NSMutableArray *downloads = [[NSMutableArray alloc] init];
+
+    for (NSDictionary *record in records) {
+        if ([record[kLGRecipeJournalStatusKey] isEqualToString:kLGRecipeJournalStatusFailed]) {
+            [failures addObject:@{ @"recipe" : record[kLGRecipeJournalRecipeKey] ?: @"",
+                                   @"message" : record[kLGRecipeJournalMessageKey] ?: @"",
+                                   @"traceback" : @"" }];
+        }
+
+        if (record[kLGRecipeJournalDownloadPathKey]) {
+            [downloads addObject:@{ @"download_path" : record[kLGRecipeJournalDownloadPathKey] }];
+        }
+    }
+
+    NSMutableDictionary *report = [[NSMutableDictionary alloc] init];
+    report[@"failures"] = [failures copy];
+    report[kLGRecipeJournalReportKey] = records ?: @[];
+    report[kLGRecipeTimingsReportKey] = [LGAutoPkgRecipeTimings timingsWithRecords:records];
+
+    if (downloads.count) {
+        report[@"summary_results"] = @{ @"url_downloader_summary_result" : @{ @"header" : @[ @"download_path" ],
+                                                                              @"data_rows" : [downloads copy],
+                                                                              @"summary_text" : @"The following new items were downloaded:" } };
+    }
+
+    return [report copy];
+}
+
+@end
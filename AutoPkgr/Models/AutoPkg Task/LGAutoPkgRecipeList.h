@@ -0,0 +1,92 @@
+//
+//  LGAutoPkgRecipeList.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/*
+ * LGAutoPkgRecipeList holds the identifiers listed in a recipe_list.txt
+ * file. The file is read once, after that it's only read again when it's
+ * changed by something other than AutoPkgr, and kLGNotificationRecipeListChanged
+ * is posted.
+ *
+ * Changes are made in memory right away, and written out together a
+ * moment later, so enabling any number of recipes in a row costs a
+ * single write.
+ */
+@interface LGAutoPkgRecipeList : NSObject
+
+/**
+ *  List backed by the default recipe_list.txt file.
+ */
++ (instancetype)sharedList;
+
+/**
+ *  Initialize a recipe list.
+ *
+ *  @param file path of the recipe_list.txt file, it doesn't need to exist yet.
+ */
+- (instancetype)initWithFile:(NSString *)file;
+
+@property (copy, nonatomic, readonly) NSString *file;
+
+/**
+ *  How long to wait for more changes before writing the file, defaults to 0.25 seconds.
+ */
+@property (assign, nonatomic) NSTimeInterval writeDelay;
+
+/**
+ *  Identifiers of the recipes in the list, in the order they'll run.
+ */
+@property (copy, nonatomic, readonly) NSOrderedSet *recipes;
+
+/**
+ *  Check whether a recipe is in the list.
+ *
+ *  @param identifier recipe identifier.
+ */
+- (BOOL)containsRecipe:(NSString *)identifier;
+
+/**
+ *  Add a recipe to, or remove it from, the list.
+ *
+ *  @param identifier recipe identifier.
+ *  @param enabled    YES to add the recipe, NO to remove it.
+ *  @note The MakeCatalogs recipe is kept last in the list, and only while there are munki recipes in it.
+ */
+- (void)setRecipe:(NSString *)identifier enabled:(BOOL)enabled;
+
+/**
+ *  Add and remove any number of recipes in a single change.
+ *
+ *  @param added   identifiers of the recipes to add, they're put at the top of the list in this order.
+ *  @param removed identifiers of the recipes to remove.
+ *  @note Unlike setRecipe:enabled: the file is written right away, and kLGNotificationRecipeListChanged is posted once.
+ *
+ *  @return NO if the file could not be written.
+ */
+- (BOOL)updateByAddingRecipes:(NSArray *)added removingRecipes:(NSArray *)removed;
+
+/**
+ *  Write any pending changes to the file right away.
+ *
+ *  @return NO if the file could not be written.
+ */
+- (BOOL)synchronize;
+
+@end
@@ -0,0 +1,306 @@
+//
+//  LGAutoPkgRecipeList.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRecipeList.h"
+#import "LGAutoPkgRecipe.h"
+#import "LGAutoPkgr.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+
+// MakeCatalogs recipe identifier string
+static NSString *const kLGMakeCatalogsIdentifier = @"com.github.autopkg.munki.makecatalogs";
+
+static NSMutableOrderedSet *recipesFromContents(NSString *contents)
+{
+    NSMutableOrderedSet *recipes = [[NSMutableOrderedSet alloc] init];
+    NSArray *lines = contents.split_byLine.filtered_noEmptyStrings;
+    if (lines.count) {
+        [recipes addObjectsFromArray:lines];
+    }
+    return recipes;
+}
+
+static void applyChanges(NSMutableOrderedSet *recipes, NSArray *added, NSArray *removed)
+{
+    /* Start by removing makecatalogs from the list, it's added back in later */
+    [recipes removeObject:kLGMakeCatalogsIdentifier];
+
+    /* Newly added recipes go at the top, in the order given. */
+    NSMutableOrderedSet *newRecipes = [NSMutableOrderedSet orderedSetWithArray:added ?: @[]];
+    [newRecipes minusOrderedSet:recipes];
+    if (newRecipes.count) {
+        [recipes insertObjects:newRecipes.array atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, newRecipes.count)]];
+    }
+
+    if (removed.count) {
+        [recipes removeObjectsInArray:removed];
+    }
+
+    /* If there are any .munki recipes now listed re-add the makecatalogs recipe. */
+    NSUInteger munkiIndex = [recipes indexOfObjectPassingTest:^BOOL(NSString *obj, NSUInteger idx, BOOL *stop) {
+        return [obj rangeOfString:@"munki"].location != NSNotFound;
+    }];
+
+    if (munkiIndex != NSNotFound) {
+        [recipes addObject:kLGMakeCatalogsIdentifier];
+    }
+}
+
+@implementation LGAutoPkgRecipeList {
+    dispatch_queue_t _queue;
+    dispatch_source_t _source;
+
+    // nil until the file is first read.
+    NSMutableOrderedSet *_recipes;
+
+    // Changes not written yet, as [added, removed] pairs of arrays.
+    NSMutableArray *_pendingChanges;
+    BOOL _writeScheduled;
+
+    // What the file contained when it was last read or written,
+    // so our own writes aren't mistaken for outside edits.
+    NSString *_fileContents;
+}
+
++ (instancetype)sharedList
+{
+    static LGAutoPkgRecipeList *sharedList;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedList = [[self alloc] initWithFile:[LGAutoPkgRecipe defaultRecipeList]];
+    });
+    return sharedList;
+}
+
+- (void)dealloc
+{
+    if (_source) {
+        dispatch_source_cancel(_source);
+    }
+}
+
+- (instancetype)init
+{
+    return [self initWithFile:[LGAutoPkgRecipe defaultRecipeList]];
+}
+
+- (instancetype)initWithFile:(NSString *)file
+{
+    if (self = [super init]) {
+        _file = [file copy];
+        _writeDelay = 0.25;
+        _queue = dispatch_queue_create("com.lindegroup.autopkgr.recipe.list.queue", DISPATCH_QUEUE_SERIAL);
+        _pendingChanges = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Recipes
+- (NSOrderedSet *)recipes
+{
+    @synchronized(self)
+    {
+        return [[self loadedRecipes] copy];
+    }
+}
+
+- (BOOL)containsRecipe:(NSString *)identifier
+{
+    @synchronized(self)
+    {
+        return identifier && [[self loadedRecipes] containsObject:identifier];
+    }
+}
+
+- (void)setRecipe:(NSString *)identifier enabled:(BOOL)enabled
+{
+    if (!identifier) {
+        return;
+    }
+
+    BOOL scheduleWrite = NO;
+    @synchronized(self)
+    {
+        [self stageAddedRecipes:enabled ? @[ identifier ] : nil
+                 removedRecipes:enabled ? nil : @[ identifier ]];
+
+        if (!_writeScheduled) {
+            _writeScheduled = scheduleWrite = YES;
+        }
+    }
+
+    if (scheduleWrite) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_writeDelay * NSEC_PER_SEC)), _queue, ^{
+            [self writePendingChanges];
+        });
+    }
+}
+
+- (BOOL)updateByAddingRecipes:(NSArray *)added removingRecipes:(NSArray *)removed
+{
+    if (!added.count && !removed.count) {
+        return YES;
+    }
+
+    @synchronized(self)
+    {
+        [self stageAddedRecipes:added removedRecipes:removed];
+    }
+
+    /* Write this, along with anything already pending, right away. */
+    BOOL success = [self synchronize];
+    [self postChangeNotification];
+    return success;
+}
+
+- (void)stageAddedRecipes:(NSArray *)added removedRecipes:(NSArray *)removed
+{
+    // Only called while synchronized on self.
+    added = added ?: @[];
+    removed = removed ?: @[];
+
+    applyChanges([self loadedRecipes], added, removed);
+    [_pendingChanges addObject:@[ added, removed ]];
+}
+
+- (NSMutableOrderedSet *)loadedRecipes
+{
+    // Only called while synchronized on self.
+    if (!_recipes) {
+        _fileContents = _file ? [NSString stringWithContentsOfFile:_file encoding:NSUTF8StringEncoding error:nil] : nil;
+        _recipes = recipesFromContents(_fileContents);
+
+        dispatch_async(_queue, ^{
+            [self watchFile];
+        });
+    }
+    return _recipes;
+}
+
+#pragma mark - Writing
+- (BOOL)synchronize
+{
+    __block BOOL success = YES;
+    dispatch_sync(_queue, ^{
+        success = [self writePendingChanges];
+    });
+    return success;
+}
+
+- (BOOL)writePendingChanges
+{
+    // Only called on _queue.
+    NSString *contents = nil;
+    @synchronized(self)
+    {
+        _writeScheduled = NO;
+        if (!_pendingChanges.count) {
+            return YES;
+        }
+
+        contents = [_recipes.array componentsJoinedByString:@"\n"];
+        [_pendingChanges removeAllObjects];
+        _fileContents = contents;
+    }
+
+    NSError *error;
+    if (!_file || ![contents writeToFile:_file atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+        NSLog(@"Error while writing %@. %@", _file, error);
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Watching
+- (void)watchFile
+{
+    // Only called on _queue.
+    if (_source) {
+        dispatch_source_cancel(_source);
+        _source = nil;
+    }
+
+    if (!_file) {
+        return;
+    }
+
+    /* Until the file exists, watch the folder it will be created in. */
+    int fd = open(_file.fileSystemRepresentation, O_EVTONLY);
+    if (fd < 0) {
+        fd = open(_file.stringByDeletingLastPathComponent.fileSystemRepresentation, O_EVTONLY);
+    }
+
+    if (fd < 0) {
+        DLog(@"Could not watch %@ for changes.", _file);
+        return;
+    }
+
+    _source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd,
+                                     DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME,
+                                     _queue);
+
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(_source, ^{
+        [weakSelf fileDidChange];
+    });
+
+    dispatch_source_set_cancel_handler(_source, ^{
+        close(fd);
+    });
+
+    dispatch_resume(_source);
+}
+
+- (void)fileDidChange
+{
+    // Only called on _queue.
+    /* Atomic writes replace the file, so follow the new one. */
+    [self watchFile];
+
+    NSString *contents = [NSString stringWithContentsOfFile:_file encoding:NSUTF8StringEncoding error:nil];
+
+    @synchronized(self)
+    {
+        if ([contents ?: @"" isEqualToString:_fileContents ?: @""]) {
+            return;
+        }
+
+        DLog(@"%@ was changed outside of AutoPkgr, reloading.", _file);
+        _fileContents = contents;
+
+        /* Changes that haven't been written yet still apply on top of the edit. */
+        NSMutableOrderedSet *recipes = recipesFromContents(contents);
+        for (NSArray *change in _pendingChanges) {
+            applyChanges(recipes, change[0], change[1]);
+        }
+        _recipes = recipes;
+    }
+
+    [self postChangeNotification];
+}
+
+- (void)postChangeNotification
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:kLGNotificationRecipeListChanged object:self];
+    });
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  LGAutoPkgRecipeSearchIndex.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LGAutoPkgRecipeIndex;
+
+/*
+ * LGAutoPkgRecipeSearchIndex answers recipe searches from the repos that
+ * are already cloned, without going to GitHub. Each recipe's name,
+ * identifier, description, processors and input keys are broken into
+ * trigrams, so any substring of three or more characters is looked up
+ * in an inverted index rather than by scanning every recipe.
+ *
+ * The index follows LGAutoPkgRecipeIndex, when that's refreshed only the
+ * recipes whose entries changed are indexed again.
+ *
+ * Results use the same keys as `autopkg search` results
+ * (kLGAutoPkgRecipeNameKey, kLGAutoPkgRepoNameKey and
+ * kLGAutoPkgRecipePathKey, the path being relative to the repo), along
+ * with kLGAutoPkgRecipeIdentifierKey and kLGAutoPkgRecipeDescriptionKey.
+ */
+@interface LGAutoPkgRecipeSearchIndex : NSObject
+
+/**
+ *  Search index built from the shared LGAutoPkgRecipeIndex.
+ */
++ (instancetype)sharedIndex;
+
+/**
+ *  Initialize a search index.
+ *
+ *  @param recipeIndex recipe index to follow, or nil to only index entries passed to -indexEntries:.
+ */
+- (instancetype)initWithRecipeIndex:(LGAutoPkgRecipeIndex *)recipeIndex;
+
+/**
+ *  Number of recipes in the index.
+ */
+@property (assign, readonly) NSInteger count;
+
+/**
+ *  Replace the indexed recipes, only entries that differ from the ones already indexed are processed.
+ *
+ *  @param entries LGAutoPkgRecipeIndex entries.
+ */
+- (void)indexEntries:(NSArray *)entries;
+
+/**
+ *  Search the local repos.
+ *
+ *  @param query words to look for, each one must be found. Case and diacritic insensitive.
+ *
+ *  @return matching recipes, best matches (on the recipe name) first.
+ */
+- (NSArray *)search:(NSString *)query;
+
+/**
+ *  Search the local repos, and only if nothing was found there, use `autopkg search`.
+ *  @note Remote results for repos that are already cloned are left out, those recipes would have been found locally.
+ *
+ *  @param query words to look for.
+ *  @param reply block called on the main queue with the results.
+ */
+- (void)search:(NSString *)query reply:(void (^)(NSArray *results, NSError *error))reply;
+
+@end
@@ -0,0 +1,374 @@
+//
+//  LGAutoPkgRecipeSearchIndex.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRecipeSearchIndex.h"
+#import "LGAutoPkgRecipeIndex.h"
+#import "LGAutoPkgTask.h"
+
+#pragma mark - Helpers
+static NSString *normalizedString(NSString *string)
+{
+    return [string stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch locale:nil];
+}
+
+/* A trigram is three UTF-16 units packed into an integer. */
+static void enumerateTrigrams(NSString *text, void (^block)(NSNumber *trigram))
+{
+    NSUInteger length = text.length;
+    if (length < 3) {
+        return;
+    }
+
+    unichar *characters = malloc(length * sizeof(unichar));
+    [text getCharacters:characters range:NSMakeRange(0, length)];
+
+    for (NSUInteger i = 0; i + 2 < length; i++) {
+        uint64_t trigram = ((uint64_t)characters[i] << 32) | ((uint64_t)characters[i + 1] << 16) | characters[i + 2];
+        block(@(trigram));
+    }
+
+    free(characters);
+}
+
+/* Path of each repo mapped to the repo name used by `autopkg search`,
+ * the last component of its URL without the .git extension. */
+static NSDictionary *repoNamesByPath()
+{
+    NSMutableDictionary *repoNames = [[NSMutableDictionary alloc] init];
+
+    NSDictionary *repos = [[LGDefaults standardUserDefaults] autoPkgRecipeRepos];
+    [repos enumerateKeysAndObjectsUsingBlock:^(NSString *path, NSDictionary *repo, BOOL *stop) {
+        if ([path isKindOfClass:[NSString class]] && [repo isKindOfClass:[NSDictionary class]]) {
+            NSString *url = repo[@"URL"];
+            if ([url isKindOfClass:[NSString class]]) {
+                repoNames[path.stringByExpandingTildeInPath.stringByStandardizingPath] = url.lastPathComponent.stringByDeletingPathExtension;
+            }
+        }
+    }];
+
+    return [repoNames copy];
+}
+
+#pragma mark - Document
+@interface LGAutoPkgRecipeSearchDocument : NSObject
+@property (copy, nonatomic) NSDictionary *entry;
+@property (copy, nonatomic) NSDictionary *result;
+@property (copy, nonatomic) NSString *name;
+@property (copy, nonatomic) NSString *identifier;
+@property (copy, nonatomic) NSString *text;
+@end
+
+@implementation LGAutoPkgRecipeSearchDocument
+
+- (instancetype)initWithEntry:(NSDictionary *)entry repoNames:(NSDictionary *)repoNames
+{
+    if (self = [super init]) {
+        _entry = [entry copy];
+
+        NSString *path = entry[kLGAutoPkgRecipePathKey];
+        NSString *name = entry[kLGAutoPkgRecipeNameKey] ?: @"";
+        NSString *identifier = entry[kLGAutoPkgRecipeIdentifierKey] ?: @"";
+        NSString *description = entry[kLGAutoPkgRecipeDescriptionKey];
+
+        // Recipes outside of a repo are listed under their directory.
+        NSString *repoName = path.stringByDeletingLastPathComponent.lastPathComponent;
+        NSString *relativePath = path.lastPathComponent;
+        for (NSString *repoPath in repoNames) {
+            if ([path hasPrefix:[repoPath stringByAppendingString:@"/"]]) {
+                repoName = repoNames[repoPath];
+                relativePath = [path substringFromIndex:repoPath.length + 1];
+                break;
+            }
+        }
+
+        NSMutableDictionary *result = [@{ kLGAutoPkgRecipeNameKey : name,
+                                          kLGAutoPkgRecipeIdentifierKey : identifier,
+                                          kLGAutoPkgRepoNameKey : repoName ?: @"",
+                                          kLGAutoPkgRecipePathKey : relativePath ?: @"" } mutableCopy];
+        if (description) {
+            result[kLGAutoPkgRecipeDescriptionKey] = description;
+        }
+        _result = [result copy];
+
+        NSMutableArray *fields = [@[ name, identifier, description ?: @"" ] mutableCopy];
+        [fields addObjectsFromArray:entry[kLGRecipeIndexProcessorsKey] ?: @[]];
+        [fields addObjectsFromArray:entry[kLGRecipeIndexInputKeysKey] ?: @[]];
+
+        _name = normalizedString(name);
+        _identifier = normalizedString(identifier);
+        _text = normalizedString([fields componentsJoinedByString:@"\n"]);
+    }
+    return self;
+}
+
+/* Lower is better, name matches come before matches anywhere else. */
+- (NSInteger)rankForQuery:(NSString *)query
+{
+    if ([_name isEqualToString:query]) {
+        return 0;
+    } else if ([_name hasPrefix:query]) {
+        return 1;
+    } else if ([_name rangeOfString:query].location != NSNotFound) {
+        return 2;
+    } else if ([_identifier rangeOfString:query].location != NSNotFound) {
+        return 3;
+    }
+    return 4;
+}
+
+@end
+
+#pragma mark - Search Index
+@implementation LGAutoPkgRecipeSearchIndex {
+    LGAutoPkgRecipeIndex *_recipeIndex;
+
+    // Slots are reused, a removed document leaves an NSNull until then.
+    NSMutableArray *_documents;
+    NSMutableIndexSet *_freeDocumentIDs;
+    NSMutableDictionary *_documentIDsByPath;
+
+    // Trigram -> NSMutableIndexSet of document IDs.
+    NSMutableDictionary *_postings;
+
+    // The recipe index's entries as of the last update.
+    NSArray *_indexedEntries;
+}
+
++ (instancetype)sharedIndex
+{
+    static LGAutoPkgRecipeSearchIndex *sharedIndex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedIndex = [[self alloc] initWithRecipeIndex:[LGAutoPkgRecipeIndex sharedIndex]];
+    });
+    return sharedIndex;
+}
+
+- (instancetype)init
+{
+    return [self initWithRecipeIndex:nil];
+}
+
+- (instancetype)initWithRecipeIndex:(LGAutoPkgRecipeIndex *)recipeIndex
+{
+    if (self = [super init]) {
+        _recipeIndex = recipeIndex;
+        _documents = [[NSMutableArray alloc] init];
+        _freeDocumentIDs = [[NSMutableIndexSet alloc] init];
+        _documentIDsByPath = [[NSMutableDictionary alloc] init];
+        _postings = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (NSInteger)count
+{
+    @synchronized(self)
+    {
+        return _documentIDsByPath.count;
+    }
+}
+
+#pragma mark - Indexing
+- (void)indexEntries:(NSArray *)entries
+{
+    @synchronized(self)
+    {
+        NSDictionary *repoNames = repoNamesByPath();
+        NSMutableSet *paths = [[NSMutableSet alloc] initWithCapacity:entries.count];
+        NSInteger indexed = 0;
+
+        for (NSDictionary *entry in entries) {
+            NSString *path = entry[kLGAutoPkgRecipePathKey];
+            if (!path || !entry[kLGAutoPkgRecipeIdentifierKey] || [entry[kLGRecipeIndexIsOverrideKey] boolValue]) {
+                continue;
+            }
+            [paths addObject:path];
+
+            NSNumber *documentID = _documentIDsByPath[path];
+            if (documentID) {
+                LGAutoPkgRecipeSearchDocument *document = _documents[documentID.unsignedIntegerValue];
+                if ([document.entry isEqualToDictionary:entry]) {
+                    continue;
+                }
+                [self removeDocumentWithID:documentID.unsignedIntegerValue];
+            }
+
+            [self addDocument:[[LGAutoPkgRecipeSearchDocument alloc] initWithEntry:entry repoNames:repoNames]];
+            indexed++;
+        }
+
+        for (NSString *path in _documentIDsByPath.allKeys) {
+            if (![paths containsObject:path]) {
+                [self removeDocumentWithID:[_documentIDsByPath[path] unsignedIntegerValue]];
+            }
+        }
+
+        DevLog(@"Recipe search index updated, %ld of %ld recipes indexed.", (long)indexed, (long)_documentIDsByPath.count);
+    }
+}
+
+- (void)addDocument:(LGAutoPkgRecipeSearchDocument *)document
+{
+    NSUInteger documentID = _freeDocumentIDs.firstIndex;
+    if (documentID == NSNotFound) {
+        documentID = _documents.count;
+        [_documents addObject:document];
+    } else {
+        [_freeDocumentIDs removeIndex:documentID];
+        _documents[documentID] = document;
+    }
+
+    _documentIDsByPath[document.entry[kLGAutoPkgRecipePathKey]] = @(documentID);
+
+    enumerateTrigrams(document.text, ^(NSNumber *trigram) {
+        NSMutableIndexSet *postings = _postings[trigram];
+        if (!postings) {
+            postings = [[NSMutableIndexSet alloc] init];
+            _postings[trigram] = postings;
+        }
+        [postings addIndex:documentID];
+    });
+}
+
+- (void)removeDocumentWithID:(NSUInteger)documentID
+{
+    LGAutoPkgRecipeSearchDocument *document = _documents[documentID];
+
+    enumerateTrigrams(document.text, ^(NSNumber *trigram) {
+        NSMutableIndexSet *postings = _postings[trigram];
+        [postings removeIndex:documentID];
+        if (postings && !postings.count) {
+            [_postings removeObjectForKey:trigram];
+        }
+    });
+
+    [_documentIDsByPath removeObjectForKey:document.entry[kLGAutoPkgRecipePathKey]];
+    _documents[documentID] = [NSNull null];
+    [_freeDocumentIDs addIndex:documentID];
+}
+
+/* Catch up with the recipe index, it refreshes itself if the repos changed. */
+- (void)update
+{
+    if (!_recipeIndex) {
+        return;
+    }
+
+    NSArray *entries = [_recipeIndex entries];
+    @synchronized(self)
+    {
+        if (entries != _indexedEntries) {
+            [self indexEntries:entries];
+            _indexedEntries = entries;
+        }
+    }
+}
+
+#pragma mark - Search
+- (NSArray *)search:(NSString *)query
+{
+    NSString *normalizedQuery = [normalizedString(query) stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    NSArray *words = [normalizedQuery.split_bySpace filtered_noEmptyStrings];
+    if (!words.count) {
+        return @[];
+    }
+
+    [self update];
+
+    @synchronized(self)
+    {
+        // Narrow down with the trigrams of each word...
+        NSMutableIndexSet *candidates = nil;
+        for (NSString *word in words) {
+            __block NSMutableIndexSet *wordCandidates = nil;
+            enumerateTrigrams(word, ^(NSNumber *trigram) {
+                NSIndexSet *postings = _postings[trigram] ?: [NSIndexSet indexSet];
+                if (!wordCandidates) {
+                    wordCandidates = [postings mutableCopy];
+                } else {
+                    [wordCandidates removeIndexesPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+                        return ![postings containsIndex:idx];
+                    }];
+                }
+            });
+
+            if (!wordCandidates) {
+                // Shorter than a trigram, checked below.
+                continue;
+            } else if (!candidates) {
+                candidates = wordCandidates;
+            } else {
+                [candidates removeIndexesPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+                    return ![wordCandidates containsIndex:idx];
+                }];
+            }
+        }
+
+        if (!candidates) {
+            candidates = [[NSMutableIndexSet alloc] initWithIndexesInRange:NSMakeRange(0, _documents.count)];
+            [candidates removeIndexes:_freeDocumentIDs];
+        }
+
+        // ...then make sure each word really is in the text, trigrams can match out of order.
+        NSMutableArray *matches = [[NSMutableArray alloc] init];
+        [candidates enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            LGAutoPkgRecipeSearchDocument *document = _documents[idx];
+            for (NSString *word in words) {
+                if ([document.text rangeOfString:word].location == NSNotFound) {
+                    return;
+                }
+            }
+            [matches addObject:document];
+        }];
+
+        [matches sortUsingComparator:^NSComparisonResult(LGAutoPkgRecipeSearchDocument *doc1, LGAutoPkgRecipeSearchDocument *doc2) {
+            NSInteger rank1 = [doc1 rankForQuery:normalizedQuery];
+            NSInteger rank2 = [doc2 rankForQuery:normalizedQuery];
+            if (rank1 != rank2) {
+                return (rank1 < rank2) ? NSOrderedAscending : NSOrderedDescending;
+            }
+            return [doc1.name compare:doc2.name];
+        }];
+
+        return [matches valueForKey:NSStringFromSelector(@selector(result))];
+    }
+}
+
+- (void)search:(NSString *)query reply:(void (^)(NSArray *results, NSError *error))reply
+{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        NSArray *results = [self search:query];
+        if (results.count) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                reply(results, nil);
+            });
+            return;
+        }
+
+        // Nothing in the cloned repos, so look in the ones that aren't.
+        NSSet *localRepoNames = [NSSet setWithArray:repoNamesByPath().allValues];
+        [LGAutoPkgTask search:query reply:^(NSArray *remoteResults, NSError *error) {
+            NSPredicate *predicate = [NSPredicate predicateWithFormat:@"NOT (%K IN %@)", kLGAutoPkgRepoNameKey, localRepoNames];
+            reply([remoteResults filteredArrayUsingPredicate:predicate], error);
+        }];
+    });
+}
+
+@end
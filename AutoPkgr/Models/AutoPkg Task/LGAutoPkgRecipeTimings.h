@@ -0,0 +1,87 @@
+//
+//  LGAutoPkgRecipeTimings.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Report key for the array of recipe timings.
+ */
+extern NSString *const kLGRecipeTimingsReportKey;
+
+// Timing keys, besides the recipe, started, duration and steps keys of the journal.
+extern NSString *const kLGRecipeTimingsOutcomeKey;
+extern NSString *const kLGRecipeTimingsRunKey;
+
+/*
+ * LGAutoPkgRecipeTimings turns the journal's recipe records into the
+ * "timings" section of a run report: how long each recipe and each of
+ * its processor steps took, how much it downloaded, and its outcome.
+ *
+ * Timings of every run are also appended to a JSON lines file, one
+ * recipe per line, for monitoring tools to pick up.
+ */
+@interface LGAutoPkgRecipeTimings : NSObject
+
+/**
+ *  Timings for recipe records, in the order the recipes ran.
+ *
+ *  @param records Array of LGAutoPkgRecipeJournal record dictionaries.
+ *
+ *  @return Array of timing dictionaries.
+ */
++ (NSArray *)timingsWithRecords:(NSArray *)records;
+
+/**
+ *  Timings sorted from the slowest recipe to the fastest.
+ *
+ *  @param timings Array of timing dictionaries.
+ *  @param limit   maximum number of timings to return, 0 for all of them.
+ */
++ (NSArray *)slowestTimings:(NSArray *)timings limit:(NSUInteger)limit;
+
+#pragma mark - Export
+/**
+ *  File the timings of every run are appended to, in Application Support.
+ */
++ (NSString *)exportFile;
+
+/**
+ *  Append the timings of a run to a JSON lines file, one timing per line.
+ *
+ *  @param timings Array of timing dictionaries.
+ *  @param run     when the run started, added to each line so lines can be grouped by run.
+ *  @param file    path of the file, it's created if needed.
+ *  @param error   populated should an error occur.
+ *
+ *  @return YES if the timings were written.
+ */
++ (BOOL)appendTimings:(NSArray *)timings ofRun:(NSDate *)run toFile:(NSString *)file error:(NSError **)error;
+
+/**
+ *  Read the timings from a JSON lines file.
+ */
++ (NSArray *)timingsFromFile:(NSString *)file;
+
+/**
+ *  The most recent timing of each recipe in the export file, keyed by recipe identifier.
+ *  @note Cached until new timings are exported.
+ */
++ (NSDictionary *)lastTimings;
+
+@end
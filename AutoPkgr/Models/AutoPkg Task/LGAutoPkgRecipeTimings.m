@@ -0,0 +1,182 @@
+//
+//  LGAutoPkgRecipeTimings.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRecipeTimings.h"
+#import "LGAutoPkgRecipeJournal.h"
+#import "LGAutoPkgr.h"
+#import "LGHostInfo.h"
+
+NSString *const kLGRecipeTimingsReportKey = @"timings";
+NSString *const kLGRecipeTimingsOutcomeKey = @"outcome";
+NSString *const kLGRecipeTimingsRunKey = @"run";
+
+// Once the export file grows past this it's moved aside and a new one is started.
+static unsigned long long const kLGRecipeTimingsMaxExportFileSize = 2 * 1024 * 1024;
+
+static NSDictionary *_lastTimings;
+
+@implementation LGAutoPkgRecipeTimings
+
++ (NSArray *)timingsWithRecords:(NSArray *)records
+{
+    NSMutableArray *timings = [[NSMutableArray alloc] initWithCapacity:records.count];
+
+    for (NSDictionary *record in records) {
+        NSMutableDictionary *timing = [[NSMutableDictionary alloc] init];
+        timing[kLGRecipeJournalRecipeKey] = record[kLGRecipeJournalRecipeKey] ?: @"";
+        timing[kLGRecipeJournalStartedKey] = record[kLGRecipeJournalStartedKey] ?: @0;
+        timing[kLGRecipeJournalDurationKey] = record[kLGRecipeJournalDurationKey] ?: @0;
+        timing[kLGRecipeTimingsOutcomeKey] = record[kLGRecipeJournalStatusKey] ?: kLGRecipeJournalStatusIncomplete;
+        timing[kLGRecipeJournalBytesDownloadedKey] = record[kLGRecipeJournalBytesDownloadedKey] ?: @0;
+
+        NSMutableArray *steps = [[NSMutableArray alloc] init];
+        for (NSDictionary *step in record[kLGRecipeJournalStepsKey]) {
+            [steps addObject:@{ kLGRecipeJournalProcessorKey : step[kLGRecipeJournalProcessorKey] ?: @"",
+                                kLGRecipeJournalDurationKey : step[kLGRecipeJournalDurationKey] ?: @0 }];
+        }
+        timing[kLGRecipeJournalStepsKey] = [steps copy];
+
+        [timings addObject:[timing copy]];
+    }
+
+    return [timings copy];
+}
+
++ (NSArray *)slowestTimings:(NSArray *)timings limit:(NSUInteger)limit
+{
+    NSSortDescriptor *slowestFirst = [NSSortDescriptor sortDescriptorWithKey:kLGRecipeJournalDurationKey ascending:NO];
+    NSArray *sorted = [timings sortedArrayUsingDescriptors:@[ slowestFirst ]];
+
+    if (limit && sorted.count > limit) {
+        return [sorted subarrayWithRange:NSMakeRange(0, limit)];
+    }
+    return sorted;
+}
+
+#pragma mark - Export
++ (NSString *)exportFile
+{
+    return [[LGHostInfo getAppSupportDirectory] stringByAppendingPathComponent:@"recipe_timings.jsonl"];
+}
+
++ (BOOL)appendTimings:(NSArray *)timings ofRun:(NSDate *)run toFile:(NSString *)file error:(NSError *__autoreleasing *)error
+{
+    if (!timings.count) {
+        return YES;
+    }
+
+    NSNumber *runTimestamp = @(run ? run.timeIntervalSince1970 : [[NSDate date] timeIntervalSince1970]);
+    NSMutableData *lines = [[NSMutableData alloc] init];
+
+    for (NSDictionary *timing in timings) {
+        NSMutableDictionary *line = [timing mutableCopy];
+        line[kLGRecipeTimingsRunKey] = runTimestamp;
+
+        NSData *data = [NSJSONSerialization dataWithJSONObject:line options:0 error:error];
+        if (!data) {
+            return NO;
+        }
+        [lines appendData:data];
+        [lines appendBytes:"\n" length:1];
+    }
+
+    @synchronized(self)
+    {
+        NSFileManager *manager = [NSFileManager defaultManager];
+        if ([[manager attributesOfItemAtPath:file error:nil] fileSize] > kLGRecipeTimingsMaxExportFileSize) {
+            NSString *previousFile = [file stringByAppendingPathExtension:@"1"];
+            [manager removeItemAtPath:previousFile error:nil];
+            [manager moveItemAtPath:file toPath:previousFile error:nil];
+        }
+
+        if (![manager fileExistsAtPath:file] && ![manager createFileAtPath:file contents:nil attributes:nil]) {
+            if (error) {
+                *error = [NSError errorWithDomain:kLGApplicationName
+                                             code:-1
+                                         userInfo:@{ NSLocalizedDescriptionKey : quick_formatString(@"Could not create %@", file) }];
+            }
+            return NO;
+        }
+
+        NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:file];
+        @try {
+            [handle seekToEndOfFile];
+            [handle writeData:lines];
+        }
+        @catch (NSException *exception)
+        {
+            if (error) {
+                *error = [NSError errorWithDomain:kLGApplicationName
+                                             code:-1
+                                         userInfo:@{ NSLocalizedDescriptionKey : exception.reason ?: @"" }];
+            }
+            return NO;
+        }
+        @finally
+        {
+            [handle closeFile];
+        }
+
+        if (_lastTimings && [file isEqualToString:[self exportFile]]) {
+            NSMutableDictionary *lastTimings = [_lastTimings mutableCopy];
+            for (NSDictionary *timing in timings) {
+                lastTimings[timing[kLGRecipeJournalRecipeKey]] = timing;
+            }
+            _lastTimings = [lastTimings copy];
+        }
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:kLGNotificationRecipeTimingsChanged object:nil];
+    });
+    return YES;
+}
+
++ (NSArray *)timingsFromFile:(NSString *)file
+{
+    NSMutableArray *timings = [[NSMutableArray alloc] init];
+    NSString *contents = [NSString stringWithContentsOfFile:file encoding:NSUTF8StringEncoding error:nil];
+
+    for (NSString *line in contents.split_byLine) {
+        NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
+        id timing = data.length ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+        if ([timing isKindOfClass:[NSDictionary class]] && [timing[kLGRecipeJournalRecipeKey] isKindOfClass:[NSString class]]) {
+            [timings addObject:timing];
+        }
+    }
+    return [timings copy];
+}
+
++ (NSDictionary *)lastTimings
+{
+    @synchronized(self)
+    {
+        if (!_lastTimings) {
+            NSMutableDictionary *lastTimings = [[NSMutableDictionary alloc] init];
+            // Later lines are later runs, so they replace earlier ones.
+            for (NSDictionary *timing in [self timingsFromFile:[self exportFile]]) {
+                lastTimings[timing[kLGRecipeJournalRecipeKey]] = timing;
+            }
+            _lastTimings = [lastTimings copy];
+        }
+        return _lastTimings;
+    }
+}
+
+@end
@@ -46,10 +46,15 @@ typedef NS_ENUM(OSStatus, LGAutoPkgRepoStatus) {
 @property (assign, nonatomic, readonly) LGAutoPkgRepoStatus status;
 @property (copy) void (^statusChangeBlock)(LGAutoPkgRepoStatus);
 
+/**
+ *  Whether a status check of the repo is in progress.
+ */
+@property (assign, readonly, getter=isCheckingStatus) BOOL checkingStatus;
+
 /**
  *  Check if there are updates available for the repo.
  *
- *  @param sender Object sending the message. If the sender is set to nil, it will only refresh every 5-10 minuets. You should set this to nil if using in a table view.
+ *  @param sender Object sending the message. If the sender is set to nil, the remote is only queried every 5-15 minutes. You should set this to nil if using in a table view.
  */
 - (IBAction)checkRepoStatus:(id)sender;
 
@@ -77,4 +82,14 @@ typedef NS_ENUM(OSStatus, LGAutoPkgRepoStatus) {
  */
 + (void)commonRepos:(void (^)(NSArray *repos))reply;
 
+/**
+ *  Check the status of several repos in one batch.
+ *  @discussion Local heads are read from disk, and repos sharing a remote are checked with a single git ls-remote. The status of each repo is updated all at once, without executing its statusChangeBlock.
+ *
+ *  @param repos array of LGAutoPkgRepo objects.
+ *  @param force YES to query remotes that were checked within the last few minutes again.
+ *  @param reply block executed on the main queue when all repos have been checked. It takes one parameter, an array of the repos whose status changed.
+ */
++ (void)checkStatusOfRepos:(NSArray *)repos force:(BOOL)force reply:(void (^)(NSArray *changedRepos))reply;
+
 @end
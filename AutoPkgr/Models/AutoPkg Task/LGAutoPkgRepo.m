@@ -28,11 +28,174 @@
 static NSArray *_activeRepos;
 static NSArray *_popularRepos;
 
-// Dispatch queue for enabling / disabling recipe
-@implementation LGAutoPkgRepo {
-    NSDate *_checkStatusTimeStamp;
+// Number of git ls-remote processes running at once, overall and per host.
+static NSInteger const kLGRepoStatusMaxConcurrentChecks = 8;
+static NSInteger const kLGRepoStatusMaxConcurrentChecksPerHost = 4;
+
+#pragma mark - Status Checker
+/* LGAutoPkgRepoStatusChecker compares the local head of installed repos,
+ * read directly from .git, with the head of their remote. Repos sharing
+ * a remote and branch are checked with a single ls-remote, and a remote
+ * head is reused for 5-15 minutes so the table doesn't hit the network
+ * every time it reloads. */
+@interface LGAutoPkgRepoStatusChecker : NSObject
++ (instancetype)sharedChecker;
+- (void)checkRepos:(NSArray *)repos force:(BOOL)force reply:(void (^)(NSMapTable *statuses))reply;
+@end
+
+@implementation LGAutoPkgRepoStatusChecker {
+    dispatch_semaphore_t _workers;
+    NSMutableDictionary *_hostQueues;
+
+    // Remote key -> @[ SHA1, expiration date ].
+    NSMutableDictionary *_remoteHeads;
+
+    // Remote key -> array of blocks waiting on an ls-remote already in flight.
+    NSMutableDictionary *_pendingReplies;
+}
+
++ (instancetype)sharedChecker
+{
+    static LGAutoPkgRepoStatusChecker *sharedChecker;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedChecker = [[self alloc] init];
+    });
+    return sharedChecker;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _workers = dispatch_semaphore_create(kLGRepoStatusMaxConcurrentChecks);
+        _hostQueues = [[NSMutableDictionary alloc] init];
+        _remoteHeads = [[NSMutableDictionary alloc] init];
+        _pendingReplies = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)checkRepos:(NSArray *)repos force:(BOOL)force reply:(void (^)(NSMapTable *))reply
+{
+    // Repo -> status, repos aren't copyable so they can't be dictionary keys.
+    NSMapTable *statuses = [NSMapTable strongToStrongObjectsMapTable];
+    NSMutableDictionary *reposByRemote = [[NSMutableDictionary alloc] init];
+
+    for (LGAutoPkgRepo *repo in repos) {
+        NSString *path = repo.path;
+        if (!path) {
+            [statuses setObject:@(kLGAutoPkgRepoNotInstalled) forKey:repo];
+            continue;
+        }
+
+        NSString *remoteKey = [NSString stringWithFormat:@"%@ %@", repo.cloneURL.absoluteString, repo.defaultBranch];
+        if (!reposByRemote[remoteKey]) {
+            reposByRemote[remoteKey] = [[NSMutableArray alloc] init];
+        }
+        [reposByRemote[remoteKey] addObject:@[ repo, path ]];
+    }
+
+    dispatch_group_t group = dispatch_group_create();
+
+    [reposByRemote enumerateKeysAndObjectsUsingBlock:^(NSString *remoteKey, NSArray *repoPaths, BOOL *stop) {
+        LGAutoPkgRepo *firstRepo = [repoPaths.firstObject firstObject];
+
+        dispatch_group_enter(group);
+        [self remoteSHA1ForRepo:firstRepo key:remoteKey force:force reply:^(NSString *remoteSHA1) {
+            for (NSArray *repoPath in repoPaths) {
+                LGAutoPkgRepo *repo = repoPath.firstObject;
+                NSString *localSHA1 = [LGGitIntegration localSHA1ForBranch:repo.defaultBranch repoPath:repoPath.lastObject];
+
+                // If the remote couldn't be reached leave the status unknown rather than guessing.
+                if (remoteSHA1) {
+                    LGAutoPkgRepoStatus status = [localSHA1 isEqualToString:remoteSHA1] ? kLGAutoPkgRepoUpToDate : kLGAutoPkgRepoUpdateAvailable;
+                    @synchronized(statuses)
+                    {
+                        [statuses setObject:@(status) forKey:repo];
+                    }
+                }
+            }
+            dispatch_group_leave(group);
+        }];
+    }];
+
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        reply(statuses);
+    });
 }
 
+- (void)remoteSHA1ForRepo:(LGAutoPkgRepo *)repo key:(NSString *)remoteKey force:(BOOL)force reply:(void (^)(NSString *remoteSHA1))reply
+{
+    @synchronized(self)
+    {
+        NSArray *remoteHead = _remoteHeads[remoteKey];
+        if (!force && remoteHead && [remoteHead.lastObject timeIntervalSinceNow] > 0) {
+            NSString *remoteSHA1 = remoteHead.firstObject;
+            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                reply(remoteSHA1);
+            });
+            return;
+        }
+
+        // Coalesce with a check of the same remote that's already running.
+        if (_pendingReplies[remoteKey]) {
+            [_pendingReplies[remoteKey] addObject:[reply copy]];
+            return;
+        }
+        _pendingReplies[remoteKey] = [NSMutableArray arrayWithObject:[reply copy]];
+    }
+
+    NSString *remote = repo.cloneURL.absoluteString;
+    NSString *branch = repo.defaultBranch;
+
+    [[self queueForHost:repo.cloneURL.host] addOperationWithBlock:^{
+        dispatch_semaphore_wait(_workers, DISPATCH_TIME_FOREVER);
+        NSString *remoteSHA1 = [LGGitIntegration remoteSHA1ForBranch:branch remote:remote];
+        dispatch_semaphore_signal(_workers);
+
+        NSArray *replies;
+        @synchronized(self)
+        {
+            if (remoteSHA1) {
+                // So we don't constantly hit the network at the exact same time, space out the checks.
+                NSTimeInterval interval = arc4random_uniform(600) + 300;
+                _remoteHeads[remoteKey] = @[ remoteSHA1, [NSDate dateWithTimeIntervalSinceNow:interval] ];
+            } else {
+                NSLog(@"Git Error: could not get the %@ head of %@", branch, remote);
+            }
+
+            replies = _pendingReplies[remoteKey];
+            [_pendingReplies removeObjectForKey:remoteKey];
+        }
+
+        for (void (^pendingReply)(NSString *) in replies) {
+            pendingReply(remoteSHA1);
+        }
+    }];
+}
+
+- (NSOperationQueue *)queueForHost:(NSString *)host
+{
+    host = host.lowercaseString ?: @"";
+
+    @synchronized(self)
+    {
+        NSOperationQueue *queue = _hostQueues[host];
+        if (!queue) {
+            queue = [[NSOperationQueue alloc] init];
+            queue.name = [@"com.lindegroup.autopkgr.repo.status." stringByAppendingString:host];
+            queue.maxConcurrentOperationCount = kLGRepoStatusMaxConcurrentChecksPerHost;
+            _hostQueues[host] = queue;
+        }
+        return queue;
+    }
+}
+
+@end
+
+#pragma mark - Repo
+@implementation LGAutoPkgRepo
+
 @synthesize commitsURL = _commitsURL;
 @synthesize homeURL = _homeURL;
 @synthesize defaultBranch = _defaultBranch;
@@ -162,45 +325,9 @@ static NSArray *_popularRepos;
 
 - (void)checkRepoStatus:(id)sender
 {
-    if (sender || !_checkStatusTimeStamp || [_checkStatusTimeStamp timeIntervalSinceNow] <= 0) {
-
-        // So we don't constantly hit the network at the exact same time, space it out the git calls.
-        NSTimeInterval interval = arc4random_uniform(600) + 300;
-        _checkStatusTimeStamp = [NSDate dateWithTimeIntervalSinceNow:interval];
-        NSString *path = self.path;
-        NSString *defaultBranch = self.defaultBranch;
-        if (path && defaultBranch) {
-            NSArray *locTaskArgs = @[ @"rev-parse", defaultBranch ];
-            NSArray *remTaskArgs = @[ @"ls-remote", @"--heads", @"origin", @"./.", defaultBranch ];
-
-            [LGGitIntegration gitTaskWithArguments:locTaskArgs repoPath:path reply:^(NSString *locStdOut, NSError *error) {
-                if (error) {
-                    NSLog(@"Git Error: %@", error );
-                }
-
-                NSString *localSHA1 = locStdOut.trimmed;
-                [LGGitIntegration gitTaskWithArguments:remTaskArgs repoPath:path reply:^(NSString *remStdOut, NSError *error) {
-                    if (error) {
-                        NSLog(@"Git Error: %@", error );
-                    }
-
-                    NSString *remoteSHA1 = remStdOut.split_bySpace.firstObject;
-                    if (!remoteSHA1) {
-                        _checkStatusTimeStamp = [NSDate dateWithTimeIntervalSinceNow:10];
-                    } else if ([localSHA1 isEqualToString:remoteSHA1]) {
-                        [self statusDidChange:kLGAutoPkgRepoUpToDate];
-                    } else {
-                        [self statusDidChange:kLGAutoPkgRepoUpdateAvailable];
-                    }
-                    [self statusDidChange:_status];
-                }];
-            }];
-        } else {
-            [self statusDidChange:kLGAutoPkgRepoNotInstalled];
-        }
-    } else {
+    [[self class] checkStatusOfRepos:@[ self ] force:(sender != nil) reply:^(NSArray *changedRepos) {
         [self statusDidChange:_status];
-    }
+    }];
 }
 
 - (void)hardResetToOriginMaster
@@ -241,6 +368,29 @@ static NSArray *_popularRepos;
 }
 
 #pragma mark - Class Methods
++ (void)checkStatusOfRepos:(NSArray *)repos force:(BOOL)force reply:(void (^)(NSArray *))reply
+{
+    for (LGAutoPkgRepo *repo in repos) {
+        repo->_checkingStatus = YES;
+    }
+
+    [[LGAutoPkgRepoStatusChecker sharedChecker] checkRepos:repos force:force reply:^(NSMapTable *statuses) {
+        NSMutableArray *changedRepos = [[NSMutableArray alloc] init];
+        for (LGAutoPkgRepo *repo in repos) {
+            NSNumber *status = [statuses objectForKey:repo];
+            if (status && (status.intValue != repo->_status)) {
+                repo->_status = status.intValue;
+                [changedRepos addObject:repo];
+            }
+            repo->_checkingStatus = NO;
+        }
+
+        if (reply) {
+            reply([changedRepos copy]);
+        }
+    }];
+}
+
 + (void)commonRepos:(void (^)(NSArray *))reply
 {
     void (^constructCommonRepos)() = ^() {
@@ -261,10 +411,6 @@ static NSArray *_popularRepos;
             }
         }];
 
-        for (LGAutoPkgRepo *repo in commonRepos) {
-            repo->_checkStatusTimeStamp = nil;
-        }
-
         dispatch_async(dispatch_get_main_queue(), ^{
             reply([commonRepos copy]);
         });
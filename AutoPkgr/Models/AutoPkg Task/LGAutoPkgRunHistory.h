@@ -0,0 +1,118 @@
+//
+//  LGAutoPkgRunHistory.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+// Run keys, besides kLGRecipeTimingsRunKey and kLGRecipeJournalDurationKey.
+extern NSString *const kLGRunHistoryRecipesKey;
+extern NSString *const kLGRunHistoryAutoPkgVersionKey;
+extern NSString *const kLGRunHistoryCompactedKey;
+
+/*
+ * LGAutoPkgRunHistory keeps a row for every recipe of every autopkg run:
+ * its outcome, version, duration, bytes downloaded and failure message.
+ * Runs are appended to a JSON lines file in Application Support, one run
+ * per line, and indexed by recipe and by date in memory when the file is
+ * first read.
+ *
+ * The history is compacted as it's written. Runs older than the retention
+ * period are dropped, and older than the detail period only keep the rows
+ * of recipes that failed or imported something.
+ */
+@interface LGAutoPkgRunHistory : NSObject
+
+/**
+ *  History kept in run_history.jsonl in Application Support.
+ */
++ (instancetype)sharedHistory;
+
+/**
+ *  Initialize a history.
+ *
+ *  @param file path of the history file, it doesn't need to exist yet.
+ */
+- (instancetype)initWithFile:(NSString *)file;
+
+@property (copy, nonatomic, readonly) NSString *file;
+
+/**
+ *  How long runs are kept, defaults to 365 days.
+ */
+@property (assign, nonatomic) NSTimeInterval retentionPeriod;
+
+/**
+ *  How long the rows of recipes that succeeded without importing anything are kept, defaults to 30 days.
+ */
+@property (assign, nonatomic) NSTimeInterval detailPeriod;
+
+/**
+ *  Maximum number of runs kept, defaults to 1000.
+ */
+@property (assign, nonatomic) NSUInteger maximumRuns;
+
+#pragma mark - Recording
+/**
+ *  Record the recipe results of a run.
+ *
+ *  @param report report of the run, with the journal's records under kLGRecipeJournalReportKey.
+ *  @param error  populated should an error occur.
+ *
+ *  @return YES if the run was written, or had no recipe results to write.
+ */
+- (BOOL)recordRunWithReport:(NSDictionary *)report error:(NSError **)error;
+
+/**
+ *  Rewrite the file without the runs and rows that are past their retention.
+ *  @note This happens on its own when enough of the history is past its retention.
+ */
+- (BOOL)compact:(NSError **)error;
+
+#pragma mark - Queries
+/**
+ *  Run dictionaries, from the oldest to the most recent.
+ */
+@property (copy, readonly) NSArray *runs;
+
+/**
+ *  Rows of a recipe, from the oldest run to the most recent, each with the kLGRecipeTimingsRunKey of its run.
+ */
+- (NSArray *)historyOfRecipe:(NSString *)recipe;
+
+/**
+ *  Identifiers of the recipes whose most recent runs all failed.
+ *
+ *  @param count number of runs in a row.
+ */
+- (NSArray *)recipesFailingInARow:(NSUInteger)count;
+
+/**
+ *  Median duration of each recipe's runs in seconds, keyed by recipe identifier.
+ */
+- (NSDictionary *)medianDurations;
+
+/**
+ *  Versions imported into Munki or the JSS since a date.
+ *
+ *  @param date date to start from, e.g. the beginning of the month.
+ *
+ *  @return Rows of the recipes that imported something, from the oldest run to the most recent.
+ */
+- (NSArray *)versionsImportedSince:(NSDate *)date;
+
+@end
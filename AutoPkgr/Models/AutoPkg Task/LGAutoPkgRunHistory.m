@@ -0,0 +1,463 @@
+//
+//  LGAutoPkgRunHistory.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgRunHistory.h"
+#import "LGAutoPkgRecipeJournal.h"
+#import "LGAutoPkgRecipeTimings.h"
+#import "LGAutoPkgr.h"
+#import "LGHostInfo.h"
+
+NSString *const kLGRunHistoryRecipesKey = @"recipes";
+NSString *const kLGRunHistoryAutoPkgVersionKey = @"autopkg_version";
+NSString *const kLGRunHistoryCompactedKey = @"compacted";
+
+// Failure messages can include a whole traceback, only the start is kept.
+static NSUInteger const kLGRunHistoryMaxMessageLength = 1000;
+
+// Compaction waits until a week's worth of runs are past their retention,
+// so the file isn't rewritten after every run.
+static NSTimeInterval const kLGRunHistoryCompactionDelay = 7 * 24 * 60 * 60;
+
+static double runTimestamp(NSDictionary *run)
+{
+    return [run[kLGRecipeTimingsRunKey] doubleValue];
+}
+
+static BOOL isFailedRow(NSDictionary *row)
+{
+    return [row[kLGRecipeTimingsOutcomeKey] isEqualToString:kLGRecipeJournalStatusFailed];
+}
+
+static NSDictionary *runFromReport(NSDictionary *report)
+{
+    NSArray *records = report[kLGRecipeJournalReportKey];
+    if (![records isKindOfClass:[NSArray class]]) {
+        return nil;
+    }
+
+    NSMutableArray *rows = [[NSMutableArray alloc] initWithCapacity:records.count];
+    double started = DBL_MAX;
+    double finished = 0;
+
+    for (NSDictionary *record in records) {
+        if (![record isKindOfClass:[NSDictionary class]] || ![record[kLGRecipeJournalRecipeKey] isKindOfClass:[NSString class]]) {
+            continue;
+        }
+
+        NSMutableDictionary *row = [[NSMutableDictionary alloc] init];
+        row[kLGRecipeJournalRecipeKey] = record[kLGRecipeJournalRecipeKey];
+        row[kLGRecipeTimingsOutcomeKey] = record[kLGRecipeJournalStatusKey] ?: kLGRecipeJournalStatusIncomplete;
+
+        // Only what's there is written, to keep the lines short.
+        for (NSString *key in @[ kLGRecipeJournalDurationKey, kLGRecipeJournalBytesDownloadedKey, kLGRecipeJournalVersionKey, kLGRecipeJournalImportedKey ]) {
+            if (record[key]) {
+                row[key] = record[key];
+            }
+        }
+
+        NSString *message = record[kLGRecipeJournalMessageKey];
+        if ([message isKindOfClass:[NSString class]] && message.length) {
+            row[kLGRecipeJournalMessageKey] = (message.length > kLGRunHistoryMaxMessageLength) ? [message substringToIndex:kLGRunHistoryMaxMessageLength] : message;
+        }
+
+        if (record[kLGRecipeJournalStartedKey]) {
+            started = MIN(started, [record[kLGRecipeJournalStartedKey] doubleValue]);
+        }
+        if (record[kLGRecipeJournalFinishedKey]) {
+            finished = MAX(finished, [record[kLGRecipeJournalFinishedKey] doubleValue]);
+        }
+
+        [rows addObject:row];
+    }
+
+    if (!rows.count) {
+        return nil;
+    }
+
+    NSMutableDictionary *run = [[NSMutableDictionary alloc] init];
+    run[kLGRecipeTimingsRunKey] = @((started < DBL_MAX) ? started : [[NSDate date] timeIntervalSince1970]);
+    if (finished > started) {
+        run[kLGRecipeJournalDurationKey] = @(finished - started);
+    }
+    if ([report[@"report_version"] isKindOfClass:[NSString class]]) {
+        run[kLGRunHistoryAutoPkgVersionKey] = report[@"report_version"];
+    }
+    run[kLGRunHistoryRecipesKey] = [rows copy];
+
+    return [run copy];
+}
+
+@implementation LGAutoPkgRunHistory {
+    // nil until the file is first read, sorted from the oldest run.
+    NSMutableArray *_runs;
+
+    // Rows of each recipe, with the timestamp of their run, from the oldest run.
+    NSMutableDictionary *_rowsByRecipe;
+
+    // Timestamp of the oldest run that hasn't been compacted.
+    double _detailedSince;
+
+    NSDictionary *_medianDurations;
+}
+
++ (instancetype)sharedHistory
+{
+    static LGAutoPkgRunHistory *sharedHistory;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedHistory = [[self alloc] init];
+    });
+    return sharedHistory;
+}
+
+- (instancetype)init
+{
+    return [self initWithFile:[[LGHostInfo getAppSupportDirectory] stringByAppendingPathComponent:@"run_history.jsonl"]];
+}
+
+- (instancetype)initWithFile:(NSString *)file
+{
+    if (self = [super init]) {
+        _file = [file copy];
+        _retentionPeriod = 365 * 24 * 60 * 60;
+        _detailPeriod = 30 * 24 * 60 * 60;
+        _maximumRuns = 1000;
+    }
+    return self;
+}
+
+#pragma mark - Loading
+- (NSMutableArray *)loadedRuns
+{
+    // Only called while synchronized on self.
+    if (!_runs) {
+        NSMutableArray *runs = [[NSMutableArray alloc] init];
+        NSString *contents = [NSString stringWithContentsOfFile:_file encoding:NSUTF8StringEncoding error:nil];
+
+        for (NSString *line in contents.split_byLine) {
+            NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
+            // A crash can leave the last line half written, just skip it.
+            id run = data.length ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+            if ([run isKindOfClass:[NSDictionary class]] && [run[kLGRunHistoryRecipesKey] isKindOfClass:[NSArray class]]) {
+                [runs addObject:run];
+            }
+        }
+
+        [runs sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSDictionary *run1, NSDictionary *run2) {
+            return [@(runTimestamp(run1)) compare:@(runTimestamp(run2))];
+        }];
+
+        _runs = runs;
+        [self rebuildIndex];
+    }
+    return _runs;
+}
+
+- (void)rebuildIndex
+{
+    // Only called while synchronized on self.
+    _rowsByRecipe = [[NSMutableDictionary alloc] init];
+    _detailedSince = DBL_MAX;
+    _medianDurations = nil;
+
+    for (NSDictionary *run in _runs) {
+        [self indexRun:run];
+    }
+}
+
+- (void)indexRun:(NSDictionary *)run
+{
+    // Only called while synchronized on self, runs are indexed from the oldest.
+    if (![run[kLGRunHistoryCompactedKey] boolValue]) {
+        _detailedSince = MIN(_detailedSince, runTimestamp(run));
+    }
+
+    for (NSDictionary *row in run[kLGRunHistoryRecipesKey]) {
+        if (![row isKindOfClass:[NSDictionary class]] || ![row[kLGRecipeJournalRecipeKey] isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        NSString *recipe = row[kLGRecipeJournalRecipeKey];
+
+        NSMutableDictionary *indexedRow = [row mutableCopy];
+        indexedRow[kLGRecipeTimingsRunKey] = run[kLGRecipeTimingsRunKey];
+
+        NSMutableArray *rows = _rowsByRecipe[recipe];
+        if (!rows) {
+            rows = [[NSMutableArray alloc] init];
+            _rowsByRecipe[recipe] = rows;
+        }
+        [rows addObject:[indexedRow copy]];
+    }
+    _medianDurations = nil;
+}
+
+#pragma mark - Recording
+- (BOOL)recordRunWithReport:(NSDictionary *)report error:(NSError *__autoreleasing *)error
+{
+    NSDictionary *run = runFromReport(report);
+    if (!run) {
+        return YES;
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:run options:0 error:error];
+    if (!data) {
+        return NO;
+    }
+
+    NSMutableData *line = [data mutableCopy];
+    [line appendBytes:"\n" length:1];
+
+    @synchronized(self)
+    {
+        NSMutableArray *runs = [self loadedRuns];
+        if (![self appendData:line error:error]) {
+            return NO;
+        }
+
+        if (runs.count && runTimestamp(runs.lastObject) > runTimestamp(run)) {
+            // Runs are normally recorded in order, but the clock can change.
+            [runs addObject:run];
+            [runs sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSDictionary *run1, NSDictionary *run2) {
+                return [@(runTimestamp(run1)) compare:@(runTimestamp(run2))];
+            }];
+            [self rebuildIndex];
+        } else {
+            [runs addObject:run];
+            [self indexRun:run];
+        }
+
+        if ([self needsCompaction]) {
+            NSError *compactError;
+            if (![self compact:&compactError]) {
+                NSLog(@"Error compacting the run history. %@", compactError.localizedDescription);
+            }
+        }
+    }
+    return YES;
+}
+
+- (BOOL)appendData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    // Only called while synchronized on self.
+    NSFileManager *manager = [NSFileManager defaultManager];
+    if (!_file || (![manager fileExistsAtPath:_file] && ![manager createFileAtPath:_file contents:nil attributes:nil])) {
+        if (error) {
+            *error = [NSError errorWithDomain:kLGApplicationName
+                                         code:-1
+                                     userInfo:@{ NSLocalizedDescriptionKey : quick_formatString(@"Could not create %@", _file) }];
+        }
+        return NO;
+    }
+
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:_file];
+    @try {
+        [handle seekToEndOfFile];
+        [handle writeData:data];
+    }
+    @catch (NSException *exception)
+    {
+        if (error) {
+            *error = [NSError errorWithDomain:kLGApplicationName
+                                         code:-1
+                                     userInfo:@{ NSLocalizedDescriptionKey : exception.reason ?: @"" }];
+        }
+        return NO;
+    }
+    @finally
+    {
+        [handle closeFile];
+    }
+    return YES;
+}
+
+#pragma mark - Compaction
+- (BOOL)needsCompaction
+{
+    // Only called while synchronized on self.
+    if (_runs.count > _maximumRuns + _maximumRuns / 10) {
+        return YES;
+    }
+
+    double now = [[NSDate date] timeIntervalSince1970];
+    if (_runs.count && runTimestamp(_runs.firstObject) < now - _retentionPeriod - kLGRunHistoryCompactionDelay) {
+        return YES;
+    }
+    return _detailedSince < now - _detailPeriod - kLGRunHistoryCompactionDelay;
+}
+
+- (BOOL)compact:(NSError *__autoreleasing *)error
+{
+    @synchronized(self)
+    {
+        NSArray *runs = [self loadedRuns];
+        double now = [[NSDate date] timeIntervalSince1970];
+
+        NSMutableArray *keptRuns = [[NSMutableArray alloc] initWithCapacity:MIN(runs.count, _maximumRuns)];
+        NSMutableData *contents = [[NSMutableData alloc] init];
+
+        NSUInteger first = (runs.count > _maximumRuns) ? runs.count - _maximumRuns : 0;
+        for (NSUInteger idx = first; idx < runs.count; idx++) {
+            NSDictionary *run = runs[idx];
+            double timestamp = runTimestamp(run);
+            if (timestamp < now - _retentionPeriod) {
+                continue;
+            }
+
+            // Past the detail period, only failures and imports are kept.
+            if (timestamp < now - _detailPeriod && ![run[kLGRunHistoryCompactedKey] boolValue]) {
+                NSMutableArray *rows = [[NSMutableArray alloc] init];
+                for (NSDictionary *row in run[kLGRunHistoryRecipesKey]) {
+                    if ([row isKindOfClass:[NSDictionary class]] && (isFailedRow(row) || [row[kLGRecipeJournalImportedKey] boolValue])) {
+                        [rows addObject:row];
+                    }
+                }
+
+                NSMutableDictionary *compacted = [run mutableCopy];
+                compacted[kLGRunHistoryRecipesKey] = [rows copy];
+                compacted[kLGRunHistoryCompactedKey] = @YES;
+                run = [compacted copy];
+            }
+
+            NSData *data = [NSJSONSerialization dataWithJSONObject:run options:0 error:error];
+            if (!data) {
+                return NO;
+            }
+            [contents appendData:data];
+            [contents appendBytes:"\n" length:1];
+            [keptRuns addObject:run];
+        }
+
+        if (![contents writeToFile:_file options:NSDataWritingAtomic error:error]) {
+            return NO;
+        }
+
+        _runs = keptRuns;
+        [self rebuildIndex];
+    }
+    return YES;
+}
+
+#pragma mark - Queries
+- (NSArray *)runs
+{
+    @synchronized(self)
+    {
+        return [[self loadedRuns] copy];
+    }
+}
+
+- (NSArray *)historyOfRecipe:(NSString *)recipe
+{
+    @synchronized(self)
+    {
+        [self loadedRuns];
+        return recipe ? [_rowsByRecipe[recipe] copy] ?: @[] : @[];
+    }
+}
+
+- (NSArray *)recipesFailingInARow:(NSUInteger)count
+{
+    if (!count) {
+        return @[];
+    }
+
+    NSMutableArray *recipes = [[NSMutableArray alloc] init];
+    @synchronized(self)
+    {
+        [self loadedRuns];
+        [_rowsByRecipe enumerateKeysAndObjectsUsingBlock:^(NSString *recipe, NSArray *rows, BOOL *stop) {
+            if (rows.count < count) {
+                return;
+            }
+
+            // Compacted runs no longer have the successes in between failures.
+            NSRange recent = NSMakeRange(rows.count - count, count);
+            if ([rows[recent.location][kLGRecipeTimingsRunKey] doubleValue] < _detailedSince) {
+                return;
+            }
+
+            for (NSDictionary *row in [rows subarrayWithRange:recent]) {
+                if (!isFailedRow(row)) {
+                    return;
+                }
+            }
+            [recipes addObject:recipe];
+        }];
+    }
+    return [recipes sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (NSDictionary *)medianDurations
+{
+    @synchronized(self)
+    {
+        [self loadedRuns];
+        if (!_medianDurations) {
+            NSMutableDictionary *medianDurations = [[NSMutableDictionary alloc] initWithCapacity:_rowsByRecipe.count];
+            [_rowsByRecipe enumerateKeysAndObjectsUsingBlock:^(NSString *recipe, NSArray *rows, BOOL *stop) {
+                NSMutableArray *durations = [[NSMutableArray alloc] initWithCapacity:rows.count];
+                for (NSDictionary *row in rows) {
+                    if ([row[kLGRecipeJournalDurationKey] isKindOfClass:[NSNumber class]]) {
+                        [durations addObject:row[kLGRecipeJournalDurationKey]];
+                    }
+                }
+
+                if (durations.count) {
+                    [durations sortUsingSelector:@selector(compare:)];
+                    NSUInteger middle = durations.count / 2;
+                    double median = (durations.count % 2) ? [durations[middle] doubleValue] : ([durations[middle - 1] doubleValue] + [durations[middle] doubleValue]) / 2;
+                    medianDurations[recipe] = @(median);
+                }
+            }];
+            _medianDurations = [medianDurations copy];
+        }
+        return _medianDurations;
+    }
+}
+
+- (NSArray *)versionsImportedSince:(NSDate *)date
+{
+    NSMutableArray *imports = [[NSMutableArray alloc] init];
+    NSDictionary *since = @{ kLGRecipeTimingsRunKey : @(date.timeIntervalSince1970) };
+
+    @synchronized(self)
+    {
+        NSArray *runs = [self loadedRuns];
+        NSUInteger first = [runs indexOfObject:since
+                                 inSortedRange:NSMakeRange(0, runs.count)
+                                       options:NSBinarySearchingFirstEqual | NSBinarySearchingInsertionIndex
+                               usingComparator:^NSComparisonResult(NSDictionary *run1, NSDictionary *run2) {
+                                   return [@(runTimestamp(run1)) compare:@(runTimestamp(run2))];
+                               }];
+
+        for (NSUInteger idx = first; idx < runs.count; idx++) {
+            NSDictionary *run = runs[idx];
+            for (NSDictionary *row in run[kLGRunHistoryRecipesKey]) {
+                if ([row isKindOfClass:[NSDictionary class]] && [row[kLGRecipeJournalImportedKey] boolValue]) {
+                    NSMutableDictionary *indexedRow = [row mutableCopy];
+                    indexedRow[kLGRecipeTimingsRunKey] = run[kLGRecipeTimingsRunKey];
+                    [imports addObject:[indexedRow copy]];
+                }
+            }
+        }
+    }
+    return [imports copy];
+}
+
+@end
@@ -0,0 +1,113 @@
+//
+//  LGAutoPkgScheduler.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LGAutoPkgTask;
+
+typedef NS_ENUM(NSInteger, LGAutoPkgSchedulerLane) {
+    /**
+     *  Short tasks someone is waiting on, such as search, info, list-recipes and repo-list.
+     */
+    kLGAutoPkgSchedulerLaneInteractive = 0,
+    /**
+     *  autopkg run.
+     */
+    kLGAutoPkgSchedulerLaneRun,
+    /**
+     *  Tasks that modify the repos, repo-add, repo-delete and repo-update.
+     */
+    kLGAutoPkgSchedulerLaneMaintenance,
+};
+
+// Keys of the dictionary returned by -statisticsForLane:
+/**
+ *  NSNumber, tasks waiting to start.
+ */
+extern NSString *const kLGSchedulerQueueDepthKey;
+/**
+ *  NSNumber, tasks currently running.
+ */
+extern NSString *const kLGSchedulerRunningKey;
+/**
+ *  NSNumber, tasks scheduled since launch.
+ */
+extern NSString *const kLGSchedulerScheduledKey;
+/**
+ *  NSNumber, tasks that shared the process of an identical task instead of launching their own.
+ */
+extern NSString *const kLGSchedulerDeduplicatedKey;
+/**
+ *  NSNumber, seconds tasks have spent waiting to start, in total.
+ */
+extern NSString *const kLGSchedulerTotalWaitTimeKey;
+/**
+ *  NSNumber, longest number of seconds a task has waited to start.
+ */
+extern NSString *const kLGSchedulerMaxWaitTimeKey;
+
+/*
+ * LGAutoPkgScheduler runs every LGAutoPkgTask in one of three lanes, each
+ * with its own concurrency, so a long autopkg run never holds up the
+ * interactive tasks. Identical read only tasks (such as repo-list) that
+ * are requested while one is already queued or running share its
+ * process and results.
+ */
+@interface LGAutoPkgScheduler : NSObject
+
++ (instancetype)sharedScheduler;
+
+/**
+ *  Schedule a task in the lane for its verb.
+ *
+ *  @param task LGAutoPkgTask with its arguments set.
+ */
+- (void)addTask:(LGAutoPkgTask *)task;
+
+/**
+ *  Schedule a set of tasks that run side by side, such as the shards of a run.
+ *  @discussion The set waits for its turn in the lane and holds it like a
+ *  single task would, while up to count of its own tasks run at once.
+ *  The lane's limit is left alone, so other tasks in the lane stay serialized.
+ *
+ *  @param tasks Array of LGAutoPkgTasks with their arguments set, all in the same lane.
+ *  @param count Number of the set's tasks that can run at once.
+ */
+- (void)addTasks:(NSArray *)tasks maxConcurrentTasks:(NSInteger)count;
+
+/**
+ *  Number of tasks that can run at once in a lane. Interactive defaults to 4, run and maintenance to 1.
+ */
+- (NSInteger)maxConcurrentTasksForLane:(LGAutoPkgSchedulerLane)lane;
+- (void)setMaxConcurrentTasks:(NSInteger)count forLane:(LGAutoPkgSchedulerLane)lane;
+
+/**
+ *  Cancel all the tasks queued or running in a lane.
+ *  @note Queued tasks finish right away without launching autopkg.
+ */
+- (void)cancelTasksInLane:(LGAutoPkgSchedulerLane)lane;
+
+/**
+ *  Snapshot of a lane's counters.
+ *
+ *  @return dictionary with the kLGScheduler... keys.
+ */
+- (NSDictionary *)statisticsForLane:(LGAutoPkgSchedulerLane)lane;
+
+@end
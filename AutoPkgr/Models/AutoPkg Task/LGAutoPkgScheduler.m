@@ -0,0 +1,271 @@
+//
+//  LGAutoPkgScheduler.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgScheduler.h"
+#import "LGAutoPkgTask.h"
+
+NSString *const kLGSchedulerQueueDepthKey = @"queue_depth";
+NSString *const kLGSchedulerRunningKey = @"running";
+NSString *const kLGSchedulerScheduledKey = @"scheduled";
+NSString *const kLGSchedulerDeduplicatedKey = @"deduplicated";
+NSString *const kLGSchedulerTotalWaitTimeKey = @"total_wait_time";
+NSString *const kLGSchedulerMaxWaitTimeKey = @"max_wait_time";
+
+static NSInteger const kLGSchedulerLaneCount = 3;
+
+// Values kept on each task by the scheduler, they're synthesized in LGAutoPkgTask.m
+@interface LGAutoPkgTask (LGAutoPkgScheduler)
+@property (strong, atomic) LGAutoPkgTask *sharedTask;
+@property (strong, atomic) NSDate *scheduledDate;
+@end
+
+/* Verbs that only read, so identical requests can share one process. */
+static BOOL verbCanBeShared(NSString *verb)
+{
+    static NSSet *sharedVerbs;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedVerbs = [NSSet setWithArray:@[ @"list-recipes", @"repo-list", @"list-processors", @"processor-info", @"search", @"info" ]];
+    });
+    return [sharedVerbs containsObject:verb];
+}
+
+#pragma mark - Lane
+@interface LGAutoPkgSchedulerLaneState : NSObject
+@property (strong, nonatomic, readonly) NSOperationQueue *queue;
+// Queues of the task sets waiting or running in the lane.
+@property (strong, nonatomic, readonly) NSMutableSet *setQueues;
+@property (assign, nonatomic) NSInteger queueDepth;
+@property (assign, nonatomic) NSInteger running;
+@property (assign, nonatomic) NSInteger scheduled;
+@property (assign, nonatomic) NSInteger deduplicated;
+@property (assign, nonatomic) NSTimeInterval totalWaitTime;
+@property (assign, nonatomic) NSTimeInterval maxWaitTime;
+@end
+
+@implementation LGAutoPkgSchedulerLaneState
+- (instancetype)initWithName:(NSString *)name maxConcurrentTasks:(NSInteger)count
+{
+    if (self = [super init]) {
+        _queue = [[NSOperationQueue alloc] init];
+        _queue.name = [@"com.lindegroup.autopkgr.scheduler." stringByAppendingString:name];
+        _queue.maxConcurrentOperationCount = count;
+        _setQueues = [[NSMutableSet alloc] init];
+    }
+    return self;
+}
+@end
+
+#pragma mark - Scheduler
+@implementation LGAutoPkgScheduler {
+    NSArray *_lanes;
+
+    // Arguments -> task that's queued or running, for sharing identical requests.
+    NSMutableDictionary *_inFlight;
+}
+
++ (instancetype)sharedScheduler
+{
+    static LGAutoPkgScheduler *sharedScheduler;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedScheduler = [[self alloc] init];
+    });
+    return sharedScheduler;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _lanes = @[ [[LGAutoPkgSchedulerLaneState alloc] initWithName:@"interactive" maxConcurrentTasks:4],
+                    [[LGAutoPkgSchedulerLaneState alloc] initWithName:@"run" maxConcurrentTasks:1],
+                    [[LGAutoPkgSchedulerLaneState alloc] initWithName:@"maintenance" maxConcurrentTasks:1] ];
+        _inFlight = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (LGAutoPkgSchedulerLaneState *)stateForLane:(LGAutoPkgSchedulerLane)lane
+{
+    NSParameterAssert(lane >= 0 && lane < kLGSchedulerLaneCount);
+    return _lanes[lane];
+}
+
+#pragma mark - Scheduling
+- (void)addTask:(LGAutoPkgTask *)task
+{
+    [self addTask:task toQueue:[self stateForLane:task.lane].queue];
+}
+
+- (void)addTasks:(NSArray *)tasks maxConcurrentTasks:(NSInteger)count
+{
+    if (!tasks.count) {
+        return;
+    }
+
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:[tasks.firstObject lane]];
+
+    /* The set gets a queue of its own, which stays suspended until
+     * a placeholder operation gets its turn in the lane. The placeholder
+     * then holds that place until every task of the set is finished. */
+    NSOperationQueue *setQueue = [[NSOperationQueue alloc] init];
+    setQueue.name = [state.queue.name stringByAppendingString:@".set"];
+    setQueue.maxConcurrentOperationCount = MAX(count, 1);
+    setQueue.suspended = YES;
+
+    for (LGAutoPkgTask *task in tasks) {
+        NSParameterAssert(task.lane == [tasks.firstObject lane]);
+        [self addTask:task toQueue:setQueue];
+    }
+
+    NSBlockOperation *placeholder = [NSBlockOperation blockOperationWithBlock:^{
+        setQueue.suspended = NO;
+        [setQueue waitUntilAllOperationsAreFinished];
+    }];
+
+    placeholder.completionBlock = ^{
+        @synchronized(self)
+        {
+            [state.setQueues removeObject:setQueue];
+        }
+    };
+
+    @synchronized(self)
+    {
+        [state.setQueues addObject:setQueue];
+    }
+
+    [state.queue addOperation:placeholder];
+}
+
+- (void)addTask:(LGAutoPkgTask *)task toQueue:(NSOperationQueue *)queue
+{
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:task.lane];
+
+    NSString *sharingKey = nil;
+    if (verbCanBeShared(task.arguments.firstObject)) {
+        sharingKey = [task.arguments componentsJoinedByString:@"\n"];
+    }
+
+    @synchronized(self)
+    {
+        LGAutoPkgTask *inFlightTask = sharingKey ? _inFlight[sharingKey] : nil;
+        if (inFlightTask && !inFlightTask.isFinished && !inFlightTask.isCancelled) {
+            // The task picks up the results once the in flight one finishes.
+            task.sharedTask = inFlightTask;
+            [task addDependency:inFlightTask];
+            state.deduplicated++;
+        } else if (sharingKey) {
+            _inFlight[sharingKey] = task;
+        }
+
+        state.scheduled++;
+        state.queueDepth++;
+        task.scheduledDate = [NSDate date];
+    }
+
+    __weak typeof(task) weakTask = task;
+    void (^completionBlock)(void) = task.completionBlock;
+    task.completionBlock = ^{
+        [self taskDidFinish:weakTask sharingKey:sharingKey];
+        if (completionBlock) {
+            completionBlock();
+        }
+    };
+
+    [queue addOperation:task];
+}
+
+- (void)taskDidStart:(LGAutoPkgTask *)task
+{
+    // Not scheduled here, it was started directly or by some other queue.
+    if (!task.scheduledDate) {
+        return;
+    }
+
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:task.lane];
+    NSTimeInterval waitTime = -[task.scheduledDate timeIntervalSinceNow];
+
+    @synchronized(self)
+    {
+        state.queueDepth--;
+        state.running++;
+        state.totalWaitTime += waitTime;
+        state.maxWaitTime = MAX(state.maxWaitTime, waitTime);
+    }
+}
+
+- (void)taskDidFinish:(LGAutoPkgTask *)task sharingKey:(NSString *)sharingKey
+{
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:task.lane];
+
+    @synchronized(self)
+    {
+        state.running--;
+        if (sharingKey && _inFlight[sharingKey] == task) {
+            [_inFlight removeObjectForKey:sharingKey];
+        }
+    }
+}
+
+#pragma mark - Lanes
+- (NSInteger)maxConcurrentTasksForLane:(LGAutoPkgSchedulerLane)lane
+{
+    return [self stateForLane:lane].queue.maxConcurrentOperationCount;
+}
+
+- (void)setMaxConcurrentTasks:(NSInteger)count forLane:(LGAutoPkgSchedulerLane)lane
+{
+    [self stateForLane:lane].queue.maxConcurrentOperationCount = MAX(count, 1);
+}
+
+- (void)cancelTasksInLane:(LGAutoPkgSchedulerLane)lane
+{
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:lane];
+
+    NSSet *setQueues;
+    @synchronized(self)
+    {
+        setQueues = [state.setQueues copy];
+    }
+
+    // A canceled placeholder never resumes its set, so let the canceled tasks finish here.
+    for (NSOperationQueue *setQueue in setQueues) {
+        [setQueue cancelAllOperations];
+        setQueue.suspended = NO;
+    }
+    [state.queue cancelAllOperations];
+}
+
+- (NSDictionary *)statisticsForLane:(LGAutoPkgSchedulerLane)lane
+{
+    LGAutoPkgSchedulerLaneState *state = [self stateForLane:lane];
+
+    @synchronized(self)
+    {
+        return @{ kLGSchedulerQueueDepthKey : @(state.queueDepth),
+                  kLGSchedulerRunningKey : @(state.running),
+                  kLGSchedulerScheduledKey : @(state.scheduled),
+                  kLGSchedulerDeduplicatedKey : @(state.deduplicated),
+                  kLGSchedulerTotalWaitTimeKey : @(state.totalWaitTime),
+                  kLGSchedulerMaxWaitTimeKey : @(state.maxWaitTime) };
+    }
+}
+
+@end
@@ -22,6 +22,7 @@
 
 #import "LGAutoPkgr.h"
 #import "LGProgressDelegate.h"
+#import "LGAutoPkgScheduler.h"
 
 @class LGAutoPkgTaskManager;
 @class LGAutoPkgTask;
@@ -72,10 +73,25 @@ extern NSString *const kLGAutoPkgRepoPathKey;
  *  Constant to access git url for the repo from autopkg repo-list
  */
 extern NSString *const kLGAutoPkgRepoURLKey;
+/**
+ *  Constant to access the date a repo's update started in the results of a parallel repo update
+ */
+extern NSString *const kLGAutoPkgRepoUpdateStartedKey;
+/**
+ *  Constant to access the date a repo's update finished in the results of a parallel repo update
+ */
+extern NSString *const kLGAutoPkgRepoUpdateFinishedKey;
+/**
+ *  Constant to access the error message of a repo that failed to update in the results of a parallel repo update
+ */
+extern NSString *const kLGAutoPkgRepoUpdateErrorKey;
 
 
 #pragma mark Task Status Delegate
 @protocol LGTaskStatusDelegate <NSObject>
+/**
+ *  Called for every progress update, on the thread reading the task's output.
+ */
 - (void)didReceiveStatusUpdate:(LGAutoPkgTaskResponseObject *)object;
 - (void)didCompleteOperation:(LGAutoPkgTaskResponseObject *)object;
 @end
@@ -104,6 +120,7 @@ extern NSString *const kLGAutoPkgRepoURLKey;
 #pragma mark-- NSOperation Queue --
 /**
  *  Subclass override to produce warning if an incorrect operation is submitted
+ *  @note LGAutoPkgTasks are run by the shared LGAutoPkgScheduler, operationCount and cancel still cover them.
  *
  *  @param op LGAutoPkgTask
  */
@@ -116,6 +133,30 @@ extern NSString *const kLGAutoPkgRepoURLKey;
  */
 - (void)cancel;
 
+/**
+ *  Report assembled from the recipes the manager's autopkg runs have completed so far.
+ *  @discussion The reports of a sharded run's shards are merged. This can be read from the progress updates while a run is in progress, nil when no run is being tracked.
+ */
+@property (copy, nonatomic, readonly) NSDictionary *partialReport;
+
+#pragma mark-- Interrupted Runs --
+/**
+ *  Record the runs a crash or forced quit interrupted, from the recipe journals they left behind.
+ *  @discussion The recovered runs are added to the run history and the recipe timings, and the journals removed. Nothing is recovered while an autopkg run is in progress, or when debugging since completed runs keep their journals then.
+ *
+ *  @return Array of report dictionaries, one per interrupted run.
+ */
++ (NSArray *)recoverInterruptedRuns;
+
+/**
+ *  Assemble the reports of the runs whose journals were left in a directory, and remove the journals.
+ *
+ *  @param directory Directory of the run reports, the journals of sharded runs are in its shards folder.
+ *
+ *  @return Array of report dictionaries, one per interrupted run. The shards of a run are merged into one report.
+ */
++ (NSArray *)reportsOfInterruptedRunsInDirectory:(NSString *)directory;
+
 #pragma mark-- Convenience Methods --
 /**
  *  Equivalent to /usr/bin/local/autopkg run --recipe-list=xxx --report-plist=xxx
@@ -124,11 +165,26 @@ extern NSString *const kLGAutoPkgRepoURLKey;
  *  @param updateRepo whether the repos should be updated prior to run
  *  @param reply The block to be executed on upon task completion. This block has no return value and takes two arguments: NSDictionary (with the report plist data), NSError
  *  @note to receive progress messages from this operation the LGProgressDelegate protocol needs to be implemented and the task manager's progressDelegate property set.
+ *  @note if sharded runs are enabled in the AutoPkgr defaults, this will run the list using runRecipeList:shards:updateRepo:reply:
  */
 - (void)runRecipeList:(NSString *)recipeList
            updateRepo:(BOOL)updateRepo
                 reply:(void (^)(NSDictionary *report, NSError *error))reply;
 
+/**
+ *  Split the recipe list into shards and run each shard as a concurrent autopkg run.
+ *
+ *  @param recipeList Full path to the recipe list
+ *  @param shards Number of concurrent autopkg runs. A value of 1 (or less) behaves exactly like runRecipeList:updateRepo:reply:
+ *  @param updateRepo whether the repos should be updated prior to run
+ *  @param reply The block to be executed on upon completion of all shards. This block has no return value and takes two arguments: NSDictionary (the merged report plist data of every shard), NSError
+ *  @note The MakeCatalogs recipe is never sharded, it's run once after every other shard has completed.
+ */
+- (void)runRecipeList:(NSString *)recipeList
+               shards:(NSInteger)shards
+           updateRepo:(BOOL)updateRepo
+                reply:(void (^)(NSDictionary *report, NSError *error))reply;
+
 /**
  *  Equivalent to /usr/bin/local/autopkg run recipe1 recipe2 ... recipe(n) --report-plist=xxx
  *
@@ -195,11 +251,22 @@ extern NSString *const kLGAutoPkgRepoURLKey;
  */
 @property (copy, nonatomic, readonly) NSDictionary *report;
 
+/**
+ *  Report dictionary assembled from the recipes that have completed so far when the task is an autopkg `run` task.
+ *  @discussion This is available while the run is in progress, and is the report a canceled run replies with. Once the task has finished it's the same as `report`.
+ */
+@property (copy, nonatomic, readonly) NSDictionary *partialReport;
+
 /**
  *  The block to use for providing run status updates asynchronously.
  */
 @property (copy) void (^progressUpdateBlock)(NSString *message, double progress);
 
+/**
+ *  Scheduler lane the task runs in, based on the autopkg verb.
+ */
+@property (assign, nonatomic, readonly) LGAutoPkgSchedulerLane lane;
+
 #pragma mark - Instance Methods
 /**
  *  Launch task in a synchronous way
@@ -336,16 +403,28 @@ extern NSString *const kLGAutoPkgRepoURLKey;
 
 + (LGAutoPkgTask *)repoAddTask:(NSString *)repo;
 + (LGAutoPkgTask *)repoDeleteTask:(NSString *)repo;
+/**
+ *  Task that updates all repos.
+ *  @discussion When parallelRepoUpdateEnabled is set in LGDefaults, each repo is updated with its own git pull --ff-only, several at a time, instead of autopkg repo-update all. The task's results are then an array with one dictionary per repo, which holds the repo-list keys along with the kLGAutoPkgRepoUpdate... keys.
+ */
 + (LGAutoPkgTask *)repoUpdateTask;
 
 #pragma mark-- Other --
 /**
  *  Equivalent to /usr/bin/local/autopkg version
+ *  @note The version is cached until the autopkg binary's path, inode or modification date changes.
  *
  *  @return version string
  */
 + (NSString *)version;
 
+/**
+ *  Check the autopkg binary on a background queue, and probe its version if it has changed.
+ *
+ *  @param reply block called on the main queue with the current version.
+ */
++ (void)refreshVersionInBackground:(void (^)(NSString *version))reply;
+
 /**
  *  Generate a GitHub API key for user with autopkg.
  *
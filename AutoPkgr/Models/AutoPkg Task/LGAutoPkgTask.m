@@ -21,12 +21,24 @@
 #import "LGAutoPkgTask.h"
 #import "LGAutoPkgErrorHandler.h"
 #import "LGAutoPkgResultHandler.h"
+#import "LGAutoPkgRecipeJournal.h"
+#import "LGAutoPkgIncrementalRun.h"
+#import "LGAutoPkgRecipeList.h"
+#import "LGAutoPkgRecipeTimings.h"
+#import "LGAutoPkgRunHistory.h"
 #import "LGHostInfo.h"
 #import "LGVersioner.h"
 #import "BSDProcessInfo.h"
 #import "NSData+taskData.h"
+#import "LGLineFramer.h"
+#import "LGRedactor.h"
+#import "LGProgressChannel.h"
+#import "LGGitIntegration.h"
+#import "LGAutoPkgScheduler.h"
+#import "LGAutoPkgWorker.h"
 
 #import <AHProxySettings/AHProxySettings.h>
+#import <sys/stat.h>
 #import <AFNetworking/AFNetworking.h>
 
 #if DEBUG
@@ -71,12 +83,242 @@ NSString *const kLGAutoPkgRecipePathKey = @"Path";
 NSString *const kLGAutoPkgRepoNameKey = @"RepoName";
 NSString *const kLGAutoPkgRepoPathKey = @"RepoPath";
 NSString *const kLGAutoPkgRepoURLKey = @"RepoURL";
+NSString *const kLGAutoPkgRepoUpdateStartedKey = @"UpdateStarted";
+NSString *const kLGAutoPkgRepoUpdateFinishedKey = @"UpdateFinished";
+NSString *const kLGAutoPkgRepoUpdateErrorKey = @"UpdateError";
 
 // Reply blocks
 typedef void (^AutoPkgReplyResultsBlock)(NSArray *results, NSError *error);
 typedef void (^AutoPkgReplyReportBlock)(NSDictionary *report, NSError *error);
 typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 
+// MakeCatalogs recipe identifier string
+static NSString *const kLGMakeCatalogsIdentifier = @"com.github.autopkg.munki.makecatalogs";
+
+#pragma mark - Persistent Worker
+static LGAutoPkgWorker *sharedAutoPkgWorker()
+{
+    static LGAutoPkgWorker *worker;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *script = [[NSBundle mainBundle] pathForResource:@"autopkg_worker" ofType:@"py"];
+        if (script) {
+            worker = [[LGAutoPkgWorker alloc] initWithScript:script autopkg:autopkg()];
+
+            // Start a fresh worker after the repos change, rather than trust what autopkg has loaded.
+            [[NSNotificationCenter defaultCenter] addObserverForName:kLGNotificationReposModified
+                                                              object:nil
+                                                               queue:nil
+                                                          usingBlock:^(NSNotification *note) {
+                                                              dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                                                                  [worker terminate];
+                                                              });
+                                                          }];
+        }
+    });
+    return worker;
+}
+
+#pragma mark - Run Group
+/* A run group ties together the tasks that make up a single sharded
+ * autopkg run. Every shard's recipe list and report plist is written
+ * to the group's directory, and the shards share one progress counter
+ * so the progress messages reflect the run as a whole. */
+@interface LGAutoPkgRunGroup : NSObject
+@property (copy, nonatomic, readonly) NSString *directory;
+@property (assign, nonatomic, readonly) NSInteger totalRecipes;
+
+- (instancetype)initWithTotalRecipes:(NSInteger)totalRecipes;
+- (NSInteger)nextProcessedIndex;
+- (NSString *)writeShard:(NSArray *)recipes named:(NSString *)name;
+- (void)cleanup;
+@end
+
+@implementation LGAutoPkgRunGroup {
+    NSInteger _processed;
+}
+
+- (instancetype)initWithTotalRecipes:(NSInteger)totalRecipes
+{
+    if (self = [super init]) {
+        _totalRecipes = totalRecipes;
+
+        NSString *shardFolder = [[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]] stringByAppendingPathComponent:@"shards"];
+        _directory = [shardFolder stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+
+        [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    return self;
+}
+
+- (NSInteger)nextProcessedIndex
+{
+    @synchronized(self)
+    {
+        return _processed++;
+    }
+}
+
+- (NSString *)writeShard:(NSArray *)recipes named:(NSString *)name
+{
+    NSError *error;
+    NSString *shardList = [[_directory stringByAppendingPathComponent:name] stringByAppendingPathExtension:@"txt"];
+    if (![[recipes componentsJoinedByString:@"\n"] writeToFile:shardList atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+        NSLog(@"Error while writing %@. %@", shardList, error);
+        return nil;
+    }
+    return shardList;
+}
+
+- (void)cleanup
+{
+    // Leave the shard lists and reports in place when debugging.
+    if (![[LGDefaults standardUserDefaults] debug]) {
+        [[NSFileManager defaultManager] removeItemAtPath:_directory error:nil];
+    }
+}
+@end
+
+#pragma mark - Report Merging
+/* Combine the report plists of every shard into a single report.
+ * Arrays (failures, detected_versions, pre 0.4.3 keys) are concatenated,
+ * and the data_rows of each summary_results processor are combined. */
+static NSDictionary *mergedReports(NSArray *reports)
+{
+    NSMutableDictionary *merged = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary *summaryResults = [[NSMutableDictionary alloc] init];
+
+    for (NSDictionary *report in reports) {
+        [report enumerateKeysAndObjectsUsingBlock:^(NSString *key, id obj, BOOL *stop) {
+            if ([key isEqualToString:@"summary_results"] && [obj isKindOfClass:[NSDictionary class]]) {
+                [obj enumerateKeysAndObjectsUsingBlock:^(NSString *processor, NSDictionary *summary, BOOL *stop) {
+                    NSMutableDictionary *existing = summaryResults[processor];
+                    if (!existing) {
+                        existing = [summary mutableCopy];
+                        existing[@"data_rows"] = [NSMutableArray arrayWithArray:summary[@"data_rows"] ?: @[]];
+                        summaryResults[processor] = existing;
+                    } else if ([summary[@"data_rows"] isKindOfClass:[NSArray class]]) {
+                        [existing[@"data_rows"] addObjectsFromArray:summary[@"data_rows"]];
+                    }
+                }];
+            } else if ([obj isKindOfClass:[NSArray class]]) {
+                NSMutableArray *existing = merged[key];
+                if (!existing) {
+                    merged[key] = [obj mutableCopy];
+                } else if ([existing isKindOfClass:[NSMutableArray class]]) {
+                    [existing addObjectsFromArray:obj];
+                }
+            } else if (!merged[key]) {
+                merged[key] = obj;
+            }
+        }];
+    }
+
+    if (summaryResults.count) {
+        merged[@"summary_results"] = [summaryResults copy];
+    }
+
+    return [merged copy];
+}
+
+#pragma mark - Run Records
+/* Keep the timings and history of a run once its report is complete,
+ * for a sharded run that's the merged report of all the shards, so the
+ * whole run is recorded once. */
+static void recordRun(NSDictionary *report)
+{
+    // Keep the timings of every run, for monitoring and the recipe table.
+    NSArray *timings = report[kLGRecipeTimingsReportKey];
+    if (timings.count) {
+        double started = DBL_MAX;
+        for (NSDictionary *timing in timings) {
+            if (timing[kLGRecipeJournalStartedKey]) {
+                started = MIN(started, [timing[kLGRecipeJournalStartedKey] doubleValue]);
+            }
+        }
+
+        NSDate *run = (started < DBL_MAX) ? [NSDate dateWithTimeIntervalSince1970:started] : [NSDate date];
+        NSError *error;
+        if (![LGAutoPkgRecipeTimings appendTimings:timings ofRun:run toFile:[LGAutoPkgRecipeTimings exportFile] error:&error]) {
+            NSLog(@"Error exporting recipe timings. %@", error.localizedDescription);
+        }
+    }
+
+    // The report plist is deleted, the history keeps what each recipe did across runs.
+    NSError *historyError;
+    if (report && ![[LGAutoPkgRunHistory sharedHistory] recordRunWithReport:report error:&historyError]) {
+        NSLog(@"Error recording the run history. %@", historyError.localizedDescription);
+    }
+}
+
+/* Journal files a run, or the shards of a run, left in the directory. */
+static NSArray *journalFilesInDirectory(NSString *directory)
+{
+    NSMutableArray *journalFiles = [[NSMutableArray alloc] init];
+    for (NSString *file in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:nil]) {
+        if ([file.pathExtension isEqualToString:@"journal"]) {
+            [journalFiles addObject:[directory stringByAppendingPathComponent:file]];
+        }
+    }
+    return [journalFiles sortedArrayUsingSelector:@selector(compare:)];
+}
+
+/* Combine the errors of every shard. The first error's domain, code
+ * and description are kept, and all the recovery suggestions are joined. */
+static NSError *mergedErrors(NSArray *errors)
+{
+    NSError *firstError = errors.firstObject;
+    if (errors.count < 2) {
+        return firstError;
+    }
+
+    NSMutableOrderedSet *suggestions = [[NSMutableOrderedSet alloc] init];
+    for (NSError *error in errors) {
+        if (error.localizedRecoverySuggestion.length) {
+            [suggestions addObject:error.localizedRecoverySuggestion];
+        }
+    }
+
+    NSDictionary *userInfo = @{ NSLocalizedDescriptionKey : firstError.localizedDescription ?: @"",
+                                NSLocalizedRecoverySuggestionErrorKey : [suggestions.array componentsJoinedByString:@"\n"] };
+
+    return [NSError errorWithDomain:firstError.domain code:firstError.code userInfo:userInfo];
+}
+
+#pragma mark - Output Line Matchers
+/* These match lines of autopkg's stdout framed by LGLineFramer. */
+static BOOL isRunProgressLine(const char *bytes, NSUInteger length)
+{
+    return LGLineHasPrefix(bytes, length, "Processing") && LGLineHasSuffix(bytes, length, "...");
+}
+
+// Identifier of the recipe in a "Processing <recipe>..." line.
+static NSString *recipeFromRunProgressMessage(NSString *message)
+{
+    NSString *recipe = [message.trimmed substringFromIndex:@"Processing".length];
+    if ([recipe hasSuffix:@"..."]) {
+        recipe = [recipe substringToIndex:recipe.length - 3];
+    }
+    return recipe.trimmed;
+}
+
+static BOOL isRepoUpdateProgressLine(const char *bytes, NSUInteger length)
+{
+    return LGLineContains(bytes, length, ".git");
+}
+
+static BOOL isInteractivePrompt(const char *bytes, NSUInteger length)
+{
+    static const char *const prompts[] = { "[y/n]:", "[YES/NO]:", "Password:", "Password" };
+
+    for (size_t i = 0; i < sizeof(prompts) / sizeof(prompts[0]); i++) {
+        if (LGLineHasSuffix(bytes, length, prompts[i])) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
 #pragma mark - AutoPkg Task (Internal Extensions)
 @interface LGAutoPkgTask ()
 
@@ -93,6 +335,9 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 // Handlers
 @property (strong, nonatomic) LGAutoPkgErrorHandler *errorHandler;
 @property (strong, nonatomic) LGVersioner *versioner;
+@property (strong, nonatomic) LGAutoPkgRecipeJournal *journal;
+@property (strong, nonatomic) LGLineFramer *stdoutFramer;
+@property (strong, nonatomic) LGProgressChannel *progressChannel;
 
 // Results objects
 @property (copy, nonatomic) NSString *reportPlistFile;
@@ -100,6 +345,16 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 @property (copy, nonatomic, readwrite) id results;
 @property (strong, nonatomic) NSError *error;
 
+// Sharded run
+@property (strong, nonatomic) LGAutoPkgRunGroup *runGroup;
+
+// Parallel repo update
+@property (assign, nonatomic) BOOL parallelRepoUpdate;
+
+// Scheduling
+@property (strong, atomic) LGAutoPkgTask *sharedTask;
+@property (strong, atomic) NSDate *scheduledDate;
+
 // Version
 @property (copy, nonatomic) NSString *version;
 
@@ -111,14 +366,50 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 @property (copy, nonatomic, readwrite) AutoPkgReplyErrorBlock replyErrorBlock;
 
 - (NSString *)taskDescription;
++ (LGAutoPkgTask *)runRecipeListTask:(NSString *)recipeList runGroup:(LGAutoPkgRunGroup *)runGroup;
++ (BOOL)instanceIsRunning;
+@end
+
+@interface LGAutoPkgScheduler (LGAutoPkgTask)
+- (void)taskDidStart:(LGAutoPkgTask *)task;
 @end
 
 #pragma mark - Task Manager
-@implementation LGAutoPkgTaskManager
+@implementation LGAutoPkgTaskManager {
+    // Tasks handed to the scheduler, held weakly so they drop out once finished.
+    NSHashTable *_tasks;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _tasks = [NSHashTable weakObjectsHashTable];
+    }
+    return self;
+}
 
 - (void)addOperation:(LGAutoPkgTask *)op
 {
-    [super addOperation:op];
+    if (![op isKindOfClass:[LGAutoPkgTask class]]) {
+        return [super addOperation:op];
+    }
+
+    [self trackTask:op];
+
+    // autopkg tasks run in the shared scheduler's lanes, the manager only keeps track of them.
+    [[LGAutoPkgScheduler sharedScheduler] addTask:op];
+}
+
+- (void)addTaskSet:(NSArray *)tasks maxConcurrentTasks:(NSInteger)count
+{
+    for (LGAutoPkgTask *task in tasks) {
+        [self trackTask:task];
+    }
+    [[LGAutoPkgScheduler sharedScheduler] addTasks:tasks maxConcurrentTasks:count];
+}
+
+- (void)trackTask:(LGAutoPkgTask *)op
+{
     if (!op.progressDelegate && _progressDelegate) {
         op.progressDelegate = _progressDelegate;
     }
@@ -130,6 +421,11 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     if (!op.replyErrorBlock && _errorBlock) {
         op.replyErrorBlock = _errorBlock;
     }
+
+    @synchronized(self)
+    {
+        [_tasks addObject:op];
+    }
 }
 
 - (void)addOperationAndWait:(LGAutoPkgTask *)op
@@ -143,11 +439,43 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     NSPredicate *classPredicate = [NSPredicate predicateWithFormat:@"SELF isKindOfClass: %@", [LGAutoPkgTask class]];
     NSArray *validObjects = [ops filteredArrayUsingPredicate:classPredicate];
     for (LGAutoPkgTask *op in validObjects) {
-        if (!op.progressDelegate && _progressDelegate) {
-            op.progressDelegate = _progressDelegate;
+        [self addOperation:op];
+    }
+
+    if (wait) {
+        [validObjects makeObjectsPerformSelector:@selector(waitUntilFinished)];
+    }
+}
+
+- (NSArray *)operations
+{
+    NSMutableArray *operations = [[super operations] mutableCopy];
+    @synchronized(self)
+    {
+        for (LGAutoPkgTask *task in _tasks) {
+            if (!task.isFinished) {
+                [operations addObject:task];
+            }
         }
     }
-    [super addOperations:validObjects waitUntilFinished:wait];
+    return [operations copy];
+}
+
+- (NSUInteger)operationCount
+{
+    return self.operations.count;
+}
+
+- (void)cancelAllOperations
+{
+    [super cancelAllOperations];
+    [self.operations makeObjectsPerformSelector:@selector(cancel)];
+}
+
+- (void)waitUntilAllOperationsAreFinished
+{
+    [super waitUntilAllOperationsAreFinished];
+    [self.operations makeObjectsPerformSelector:@selector(waitUntilFinished)];
 }
 
 - (void)cancel
@@ -155,12 +483,93 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     [self cancelAllOperations];
 }
 
+- (NSDictionary *)partialReport
+{
+    NSMutableArray *reports = [[NSMutableArray alloc] init];
+    @synchronized(self)
+    {
+        for (LGAutoPkgTask *task in _tasks) {
+            NSDictionary *report = task.partialReport;
+            if (report) {
+                [reports addObject:report];
+            }
+        }
+    }
+    return reports.count ? mergedReports(reports) : nil;
+}
+
+#pragma mark - Interrupted Runs
++ (NSArray *)recoverInterruptedRuns
+{
+    /* The journals of a run in progress, e.g. a scheduled run, are still being written.
+     * When debugging, the journals of completed runs are kept and aren't told apart. */
+    if ([LGAutoPkgTask instanceIsRunning] || [[LGDefaults standardUserDefaults] debug]) {
+        return @[];
+    }
+
+    NSString *reportSubfolder = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]];
+    NSArray *reports = [self reportsOfInterruptedRunsInDirectory:reportSubfolder];
+    for (NSDictionary *report in reports) {
+        NSLog(@"Recovered %lu recipe results of an interrupted autopkg run.", (unsigned long)[report[kLGRecipeJournalReportKey] count]);
+        recordRun(report);
+    }
+    return reports;
+}
+
++ (NSArray *)reportsOfInterruptedRunsInDirectory:(NSString *)directory
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *shardFolder = [directory stringByAppendingPathComponent:@"shards"];
+
+    // A run's journal sits in the directory, a sharded run's journals share a folder of their own.
+    NSMutableArray *runs = [[NSMutableArray alloc] init];
+    for (NSString *journalFile in journalFilesInDirectory(directory)) {
+        [runs addObject:@[ journalFile ]];
+    }
+
+    for (NSString *group in [fm contentsOfDirectoryAtPath:shardFolder error:nil]) {
+        NSString *groupDirectory = [shardFolder stringByAppendingPathComponent:group];
+        NSArray *journalFiles = journalFilesInDirectory(groupDirectory);
+        if (journalFiles.count) {
+            [runs addObject:journalFiles];
+        }
+    }
+
+    NSMutableArray *reports = [[NSMutableArray alloc] init];
+    for (NSArray *journalFiles in runs) {
+        NSMutableArray *shardReports = [[NSMutableArray alloc] init];
+        for (NSString *journalFile in journalFiles) {
+            NSArray *records = [LGAutoPkgRecipeJournal recordsFromJournalFile:journalFile];
+            if (records.count) {
+                [shardReports addObject:[LGAutoPkgRecipeJournal reportWithRecords:records]];
+            }
+            [fm removeItemAtPath:journalFile error:nil];
+        }
+
+        if (shardReports.count) {
+            [reports addObject:mergedReports(shardReports)];
+        }
+    }
+
+    // Shard lists of interrupted runs are left behind too.
+    for (NSString *group in [fm contentsOfDirectoryAtPath:shardFolder error:nil]) {
+        [fm removeItemAtPath:[shardFolder stringByAppendingPathComponent:group] error:nil];
+    }
+
+    return [reports copy];
+}
+
 #pragma mark - Convenience Instance Methods
 - (void)runRecipes:(NSArray *)recipes
              reply:(void (^)(NSDictionary *, NSError *))reply
 {
     LGAutoPkgTask *task = [LGAutoPkgTask runRecipesTask:recipes];
-    task.replyReportBlock = reply;
+    task.replyReportBlock = ^(NSDictionary *report, NSError *error) {
+        recordRun(report);
+        if (reply) {
+            reply(report, error);
+        }
+    };
     [self addOperation:task];
 }
 
@@ -169,7 +578,12 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
               reply:(void (^)(NSDictionary *, NSError *))reply
 {
     LGAutoPkgTask *task = [LGAutoPkgTask runRecipesTask:recipes];
-    task.replyReportBlock = reply;
+    task.replyReportBlock = ^(NSDictionary *report, NSError *error) {
+        recordRun(report);
+        if (reply) {
+            reply(report, error);
+        }
+    };
     [self addOperation:task];
 }
 
@@ -177,8 +591,72 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
            updateRepo:(BOOL)updateRepo
                 reply:(void (^)(NSDictionary *, NSError *))reply
 {
+    // Make sure recipes that were just enabled are in the file autopkg reads.
+    [[LGAutoPkgRecipeList sharedList] synchronize];
+
+    LGDefaults *defaults = [LGDefaults standardUserDefaults];
+    if (defaults.incrementalAutoPkgRunEnabled) {
+        return [self runRecipeListIncrementally:recipeList
+                                     updateRepo:updateRepo
+                                          reply:reply];
+    }
+
+    [self scheduleRecipeList:recipeList updateRepo:updateRepo reply:reply];
+}
+
+- (void)runRecipeListIncrementally:(NSString *)recipeList
+                        updateRepo:(BOOL)updateRepo
+                             reply:(void (^)(NSDictionary *, NSError *))reply
+{
+    LGAutoPkgIncrementalRun *incrementalRun = [[LGAutoPkgIncrementalRun alloc] initWithRecipeList:recipeList];
+
+    /* Which recipes changed can only be told once the
+     * repos are updated, so plan after the repo update. */
+    NSBlockOperation *planOperation = [NSBlockOperation blockOperationWithBlock:^{
+        NSString *plannedRecipeList = [incrementalRun plan];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!plannedRecipeList) {
+                NSLog(@"All recipes are unchanged, deferring %ld recipes.", (long)incrementalRun.deferredRecipes.count);
+                reply([incrementalRun recordReport:nil], nil);
+                return;
+            }
+
+            [self scheduleRecipeList:plannedRecipeList updateRepo:NO reply:^(NSDictionary *report, NSError *error) {
+                reply([incrementalRun recordReport:report], error);
+            }];
+        });
+    }];
+
+    if (updateRepo) {
+        LGAutoPkgTask *repoUpdate = [LGAutoPkgTask repoUpdateTask];
+        [planOperation addDependency:repoUpdate];
+        [self addOperation:repoUpdate];
+    }
+
+    // Not an LGAutoPkgTask, so skip the progress delegate setup.
+    [super addOperation:planOperation];
+}
+
+- (void)scheduleRecipeList:(NSString *)recipeList
+                updateRepo:(BOOL)updateRepo
+                     reply:(void (^)(NSDictionary *, NSError *))reply
+{
+    LGDefaults *defaults = [LGDefaults standardUserDefaults];
+    if (defaults.shardedAutoPkgRunEnabled) {
+        return [self runRecipeList:recipeList
+                            shards:defaults.autoPkgRunShardCount
+                        updateRepo:updateRepo
+                             reply:reply];
+    }
+
     LGAutoPkgTask *runTask = [LGAutoPkgTask runRecipeListTask:recipeList];
-    runTask.replyReportBlock = reply;
+    runTask.replyReportBlock = ^(NSDictionary *report, NSError *error) {
+        recordRun(report);
+        if (reply) {
+            reply(report, error);
+        }
+    };
 
     if (updateRepo) {
         LGAutoPkgTask *repoUpdate = [LGAutoPkgTask repoUpdateTask];
@@ -189,6 +667,117 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     [self addOperation:runTask];
 }
 
+- (void)runRecipeList:(NSString *)recipeList
+               shards:(NSInteger)shards
+           updateRepo:(BOOL)updateRepo
+                reply:(void (^)(NSDictionary *, NSError *))reply
+{
+    NSString *fileContents = [NSString stringWithContentsOfFile:recipeList encoding:NSUTF8StringEncoding error:nil];
+    NSMutableArray *recipes = [fileContents.split_byLine.filtered_noEmptyStrings mutableCopy];
+
+    /* MakeCatalogs needs to run once, after everything else
+     * has been imported, so pull it out of the shards. */
+    BOOL makeCatalogs = [recipes containsObject:kLGMakeCatalogsIdentifier];
+    [recipes removeObject:kLGMakeCatalogsIdentifier];
+
+    shards = MIN(shards, (NSInteger)recipes.count);
+    if (shards < 2) {
+        LGAutoPkgTask *runTask = [LGAutoPkgTask runRecipeListTask:recipeList];
+        runTask.replyReportBlock = ^(NSDictionary *report, NSError *error) {
+            recordRun(report);
+            if (reply) {
+                reply(report, error);
+            }
+        };
+
+        if (updateRepo) {
+            LGAutoPkgTask *repoUpdate = [LGAutoPkgTask repoUpdateTask];
+            [runTask addDependency:repoUpdate];
+            [self addOperation:repoUpdate];
+        }
+        return [self addOperation:runTask];
+    }
+
+    LGAutoPkgRunGroup *runGroup = [[LGAutoPkgRunGroup alloc] initWithTotalRecipes:recipes.count + makeCatalogs];
+
+    /* Deal the recipes out round robin, so recipes from the
+     * same repo (which are usually listed together) get spread
+     * across the shards. */
+    NSMutableArray *shardRecipes = [NSMutableArray arrayWithCapacity:shards];
+    for (NSInteger i = 0; i < shards; i++) {
+        [shardRecipes addObject:[NSMutableArray array]];
+    }
+    [recipes enumerateObjectsUsingBlock:^(NSString *recipe, NSUInteger idx, BOOL *stop) {
+        [shardRecipes[idx % shards] addObject:recipe];
+    }];
+
+    NSMutableArray *tasks = [NSMutableArray arrayWithCapacity:shards + 1];
+    [shardRecipes enumerateObjectsUsingBlock:^(NSArray *list, NSUInteger idx, BOOL *stop) {
+        NSString *shardList = [runGroup writeShard:list named:quick_formatString(@"shard-%ld", (long)idx)];
+        if (shardList) {
+            [tasks addObject:[LGAutoPkgTask runRecipeListTask:shardList runGroup:runGroup]];
+        }
+    }];
+
+    LGAutoPkgTask *makeCatalogsTask = nil;
+    if (makeCatalogs) {
+        NSString *shardList = [runGroup writeShard:@[ kLGMakeCatalogsIdentifier ] named:@"makecatalogs"];
+        if (shardList) {
+            makeCatalogsTask = [LGAutoPkgTask runRecipeListTask:shardList runGroup:runGroup];
+            for (LGAutoPkgTask *task in tasks) {
+                [makeCatalogsTask addDependency:task];
+            }
+            [tasks addObject:makeCatalogsTask];
+        }
+    }
+
+    /* Each task's reply is called on the main thread, so
+     * the bookkeeping here doesn't need any locking. */
+    NSMutableArray *reports = [NSMutableArray arrayWithCapacity:tasks.count];
+    NSMutableArray *errors = [NSMutableArray arrayWithCapacity:tasks.count];
+    NSMutableIndexSet *completed = [NSMutableIndexSet indexSet];
+    NSInteger expected = tasks.count;
+
+    [tasks enumerateObjectsUsingBlock:^(LGAutoPkgTask *task, NSUInteger idx, BOOL *stop) {
+        task.replyReportBlock = ^(NSDictionary *report, NSError *error) {
+            if ([completed containsIndex:idx]) {
+                return;
+            }
+            [completed addIndex:idx];
+
+            if (report) {
+                [reports addObject:report];
+            }
+            if (error) {
+                [errors addObject:error];
+            }
+
+            if (completed.count == expected) {
+                [runGroup cleanup];
+
+                NSDictionary *report = mergedReports(reports);
+                recordRun(report);
+                if (reply) {
+                    reply(report, mergedErrors(errors));
+                }
+            }
+        };
+    }];
+
+    if (updateRepo) {
+        LGAutoPkgTask *repoUpdate = [LGAutoPkgTask repoUpdateTask];
+        for (LGAutoPkgTask *task in tasks) {
+            [task addDependency:repoUpdate];
+        }
+        [self addOperation:repoUpdate];
+    }
+
+    /* The shards run side by side as one set, which takes a
+     * single place in the run lane, so other runs are still
+     * serialized with it. */
+    [self addTaskSet:tasks maxConcurrentTasks:shards];
+}
+
 - (void)search:(NSString *)recipe reply:(void (^)(NSArray *results, NSError *error))reply
 {
     LGAutoPkgTask *task = [LGAutoPkgTask searchTask:recipe];
@@ -235,6 +824,11 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
         _isExecuting = NO;
         _isFinished = NO;
         _version = [[self class] version];
+
+        __weak typeof(self) weakSelf = self;
+        _progressChannel = [LGProgressChannel channelWithHandler:^(NSString *message, double progress) {
+            [weakSelf updateProgress:message progress:progress];
+        }];
     }
     return self;
 }
@@ -251,6 +845,8 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 #pragma mark - NSOperation Overrides
 - (void)start
 {
+    [[LGAutoPkgScheduler sharedScheduler] taskDidStart:self];
+
     if ([self isCancelled]) {
         // Must move the operation to the finished state if it is canceled.
         return [self setIsFinished:YES];
@@ -272,8 +868,14 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     if (self.task && self.task.isRunning) {
         DLog(@"Canceling %@", self.taskDescription);
         [self.task terminate];
+    } else if (_parallelRepoUpdate && _isExecuting) {
+        // No more repos get pulled, the task completes once the ones in flight finish.
+        DLog(@"Canceling parallel repo update");
     } else if (_taskStatusDelegate) {
-        [(NSObject *)_taskStatusDelegate performSelectorOnMainThread:@selector(didCompleteOperation:) withObject:nil waitUntilDone:NO];
+        // Reply with whatever the run got through before it was canceled.
+        LGAutoPkgTaskResponseObject *response = [[LGAutoPkgTaskResponseObject alloc] init];
+        response.report = self.partialReport;
+        [(NSObject *)_taskStatusDelegate performSelectorOnMainThread:@selector(didCompleteOperation:) withObject:response waitUntilDone:NO];
     }
     [self.taskLock unlock];
     [super cancel];
@@ -283,6 +885,18 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 {
     @autoreleasepool
     {
+        if (_parallelRepoUpdate && [self updateReposInParallel]) {
+            return;
+        }
+
+        if (_sharedTask && [self adoptResultsOfSharedTask]) {
+            return;
+        }
+
+        if ([self runInWorker]) {
+            return;
+        }
+
         self.task = [[NSTask alloc] init];
         self.task.launchPath = @"/usr/bin/python";
 
@@ -297,7 +911,7 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 
         // If an instance of autopkg is running,
         // and we're trying to do a run, exit.
-        if (_verb == kLGAutoPkgRun && [[self class] instanceIsRunning]) {
+        if (_verb == kLGAutoPkgRun && [self conflictingInstanceIsRunning]) {
             self.error = [LGError errorWithCode:kLGErrorMultipleRunsOfAutopkg];
             [self didCompleteTaskExecution];
             return;
@@ -337,6 +951,165 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     }
 }
 
+#pragma mark - Shared Task
+/* The scheduler makes a task that's identical to one already in flight
+ * depend on it, rather than launching another autopkg process. Once the
+ * shared task finishes its output is taken as this task's own.
+ */
+- (BOOL)adoptResultsOfSharedTask
+{
+    LGAutoPkgTask *sharedTask = _sharedTask;
+    self.sharedTask = nil;
+
+    // If the shared task was canceled by its owner this task still needs to run.
+    if (sharedTask.isCancelled) {
+        return NO;
+    }
+
+    [self.taskLock lock];
+    _results = [sharedTask.results copy];
+    _standardOutString = [sharedTask.standardOutString copy];
+    _standardErrString = [sharedTask.standardErrString copy];
+    _error = sharedTask.error;
+    [self.taskLock unlock];
+
+    [self didCompleteTaskExecution];
+    return YES;
+}
+
+#pragma mark - Persistent Worker
+/* Read only verbs can be answered by the persistent worker, which
+ * already has autopkg loaded. If the worker is disabled, busy or
+ * fails, the task launches autopkg as usual.
+ */
+- (BOOL)runInWorker
+{
+    LGAutoPkgVerb workerVerbs = (kLGAutoPkgListRecipes | kLGAutoPkgRepoList | kLGAutoPkgListProcessors | kLGAutoPkgProcessorInfo | kLGAutoPkgSearch | kLGAutoPkgInfo);
+
+    // Prompts need a stdin of their own.
+    if (!(_verb & workerVerbs) || [self isInteractiveOperation]) {
+        return NO;
+    }
+
+    LGAutoPkgWorker *worker = sharedAutoPkgWorker();
+    if (!worker || ![[LGDefaults standardUserDefaults] persistentAutoPkgWorkerEnabled]) {
+        return NO;
+    }
+
+    [self configureEnvironment];
+
+    NSArray *arguments = [self.internalArgs subarrayWithRange:NSMakeRange(1, self.internalArgs.count - 1)];
+    NSDictionary *response = [worker sendRequest:arguments environment:self.internalEnvironment version:self.version];
+    if (!response) {
+        return NO;
+    }
+
+    NSString *standardOut = response[kLGAutoPkgWorkerStandardOutKey];
+    NSData *data = [standardOut dataUsingEncoding:NSUTF8StringEncoding];
+
+    _errorHandler = [[LGAutoPkgErrorHandler alloc] initWithVerb:_verb];
+    [_errorHandler appendErrorString:response[kLGAutoPkgWorkerStandardErrKey]];
+
+    [self.taskLock lock];
+    _standardOutData = [data mutableCopy];
+    _standardOutString = [standardOut copy];
+    _results = [[[LGAutoPkgResultHandler alloc] initWithData:data verb:_verb] results];
+    _error = [_errorHandler errorWithExitCode:[response[kLGAutoPkgWorkerExitCodeKey] integerValue]];
+    [self.taskLock unlock];
+
+    [self didCompleteTaskExecution];
+    return YES;
+}
+
+#pragma mark - Parallel Repo Update
+/* Update each repo with its own git pull --ff-only, a few at a time,
+ * rather than autopkg repo-update all which pulls them one after the
+ * other. Returns NO when git can't be found, so autopkg is used instead. */
+- (BOOL)updateReposInParallel
+{
+    if (![LGGitIntegration isInstalled]) {
+        DLog(@"Git is not installed, falling back to autopkg repo-update all.");
+        return NO;
+    }
+
+    NSArray *repos = [[self class] repoList];
+    NSInteger total = repos.count;
+
+    NSMutableArray *results = [[NSMutableArray alloc] initWithCapacity:total];
+    NSMutableArray *failures = [[NSMutableArray alloc] init];
+
+    dispatch_semaphore_t slots = dispatch_semaphore_create([[LGDefaults standardUserDefaults] repoUpdateConcurrency]);
+    dispatch_group_t group = dispatch_group_create();
+
+    for (NSDictionary *repo in repos) {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        if (_userCanceled) {
+            dispatch_semaphore_signal(slots);
+            break;
+        }
+
+        NSString *repoPath = repo[kLGAutoPkgRepoPathKey];
+        NSDate *started = [NSDate date];
+
+        dispatch_group_enter(group);
+        [LGGitIntegration gitTaskWithArguments:@[ @"pull", @"--ff-only" ] repoPath:repoPath reply:^(NSString *stdOut, NSError *error) {
+            NSMutableDictionary *result = [repo mutableCopy];
+            result[kLGAutoPkgRepoUpdateStartedKey] = started;
+            result[kLGAutoPkgRepoUpdateFinishedKey] = [NSDate date];
+
+            NSString *progressMessage;
+            if (error) {
+                NSString *errorMessage = error.localizedRecoverySuggestion.trimmed;
+                if (!errorMessage.length) {
+                    errorMessage = error.localizedDescription;
+                }
+                // Remote URLs can carry credentials.
+                errorMessage = LGRedactedString(errorMessage);
+                result[kLGAutoPkgRepoUpdateErrorKey] = errorMessage;
+                progressMessage = [NSString stringWithFormat:@"Failed to update %@", repoPath.lastPathComponent];
+                NSLog(@"%@: %@", progressMessage, errorMessage);
+            } else {
+                progressMessage = [NSString stringWithFormat:@"Updated %@", repoPath.lastPathComponent];
+                NSLog(@"%@", progressMessage);
+            }
+
+            NSInteger count;
+            @synchronized(results)
+            {
+                [results addObject:[result copy]];
+                if (error) {
+                    [failures addObject:quick_formatString(@"%@: %@", repo[kLGAutoPkgRepoURLKey] ?: repoPath, result[kLGAutoPkgRepoUpdateErrorKey])];
+                }
+                count = results.count;
+            }
+
+            LGAutoPkgTaskResponseObject *response = [[LGAutoPkgTaskResponseObject alloc] init];
+            response.progressMessage = [NSString stringWithFormat:@"(%ld/%ld) %@", (long)count, (long)total, progressMessage];
+            response.progress = ((double)count / total) * 100;
+
+            [_taskStatusDelegate didReceiveStatusUpdate:response];
+
+            dispatch_semaphore_signal(slots);
+            dispatch_group_leave(group);
+        }];
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    self.results = results;
+    if (failures.count && !_userCanceled) {
+        NSString *message = LGAutoPkgLocalizedString(@"Some repos could not be updated", nil);
+        self.error = [NSError errorWithDomain:kLGApplicationName
+                                         code:kLGErrorAutoPkgConfig
+                                     userInfo:@{ NSLocalizedDescriptionKey : message,
+                                                 NSLocalizedRecoverySuggestionErrorKey : [failures componentsJoinedByString:@"\n"] }];
+    }
+
+    // This posts the single repos modified notification for the whole update.
+    [self didCompleteTaskExecution];
+    return YES;
+}
+
 #pragma mark
 - (BOOL)isExecuting
 {
@@ -373,6 +1146,11 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
         [self.task.standardError fileHandleForReading].readabilityHandler = nil;
     }
 
+    // Handle a final line that wasn't terminated, then release the
+    // framer, its handlers hold on to the task.
+    [_stdoutFramer flush];
+    _stdoutFramer = nil;
+
     if (!_error && !_userCanceled) {
         [self.taskLock lock];
         self.error = [_errorHandler errorWithExitCode:self.task.terminationStatus];
@@ -402,17 +1180,16 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 #pragma mark - Convenience Initializers
 - (void)launch
 {
-    LGAutoPkgTaskManager *mgr = [[LGAutoPkgTaskManager alloc] init];
     //    NSAssert([self isInteractiveOperation], @"[autopkg %@] Interactive commands must be launched asynchronously. Use launchInBackground:", self.internalArgs.firstObject);
 
-    [mgr addOperationAndWait:self];
+    [[LGAutoPkgScheduler sharedScheduler] addTask:self];
+    [self waitUntilFinished];
 }
 
 - (void)launchInBackground:(void (^)(NSError *))reply
 {
-    LGAutoPkgTaskManager *bgQueue = [LGAutoPkgTaskManager new];
     self.replyErrorBlock = reply;
-    [bgQueue addOperation:self];
+    [[LGAutoPkgScheduler sharedScheduler] addTask:self];
 }
 
 #pragma mark - Accessors
@@ -505,59 +1282,90 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 
             __block double count = 0.0;
             __block double total;
-            NSPredicate *progressPredicate;
+            BOOL (*isProgressLine)(const char *, NSUInteger);
 
             if (_verb == kLGAutoPkgRun) {
                 _versioner = [[LGVersioner alloc] init];
-                progressPredicate = [NSPredicate predicateWithFormat:@"SELF MATCHES '^Processing.*\\.\\.\\.'"];
 
-                total = [self recipeListCount];
-            } else if (_verb == kLGAutoPkgRepoUpdate) {
-                progressPredicate = [NSPredicate predicateWithFormat:@"SELF CONTAINS[cd] '.git'"];
+                // Each recipe's outcome is journaled next to the report plist as soon as it completes.
+                NSString *journalFile = [self.reportPlistFile.stringByDeletingPathExtension stringByAppendingPathExtension:@"journal"];
+                _journal = [[LGAutoPkgRecipeJournal alloc] initWithJournalFile:journalFile];
+                isProgressLine = isRunProgressLine;
+
+                // Shards of the same run report progress for the whole run.
+                total = _runGroup ? _runGroup.totalRecipes : [self recipeListCount];
+            } else {
+                isProgressLine = isRepoUpdateProgressLine;
                 total = [[[self class] repoList] count];
             }
 
             BOOL verbose = [[NSUserDefaults standardUserDefaults] boolForKey:@"verboseAutoPkgRun"];
-            [[standardOutput fileHandleForReading] setReadabilityHandler:^(NSFileHandle *handle) {
-                NSData *data = handle.availableData;
 
-                if (data.length) {
-                    NSString *message = [[NSString alloc]initWithData:data encoding:NSUTF8StringEncoding];
+            // Lines are matched on the raw bytes, a string is only created for lines that get used.
+            _stdoutFramer = [[LGLineFramer alloc] initWithLineHandler:^(const char *bytes, NSUInteger length) {
+                BOOL isProgress = isProgressLine(bytes, length);
+                if (!isProgress && !verbose && _verb != kLGAutoPkgRun) {
+                    return;
+                }
 
-                    if (isInteractive && data.taskData_isInteractive) {
-                        DevLog(@"Prompting for interaction: %@", message);
-                        return [self interactiveAlertWithMessage:message];
+                NSString *message = LGLineString(bytes, length);
+
+                [_versioner parseLine:message];
+                [_journal parseLine:message];
+                if (isProgress) {
+                    if (_verb == kLGAutoPkgRun) {
+                        // What autopkg writes to stderr from here on is about this recipe.
+                        _errorHandler.currentRecipe = recipeFromRunProgressMessage(message);
                     }
 
-                    [_versioner parseString:message];
-                    if ([progressPredicate evaluateWithObject:message]) {
-                        NSString *fullMessage;
-                        if (_verb == kLGAutoPkgRepoUpdate) {
-                            fullMessage = [NSString stringWithFormat:@"Updating %@", [message lastPathComponent]];
-                        } else {
-                            int cntStr = (int)round(count) + 1;
-                            int totStr = (int)round(total);
-                            fullMessage = [[NSString stringWithFormat:@"(%d/%d) %@", cntStr, totStr, message] stringByTrimmingCharactersInSet:[NSCharacterSet newlineCharacterSet]];
-                        }
-
-                        double progress = ((count/total) * 100);
-
-                        LGAutoPkgTaskResponseObject *response = [[LGAutoPkgTaskResponseObject alloc] init];
-                        response.progressMessage = fullMessage;
-                        response.progress = progress;
-                        count++;
-
-                        [(NSObject *)_taskStatusDelegate performSelectorOnMainThread:@selector(didReceiveStatusUpdate:) withObject:response waitUntilDone:NO];
-
-                        // If verboseAutoPkgRun is not enabled, log the limited message here.
-                        if (!verbose) {
-                            NSLog(@"%@",message);
-                        }
+                    if (_runGroup) {
+                        count = [_runGroup nextProcessedIndex];
                     }
-                    // If verboseAutoPkgRun is enabled, log everything generated by autopkg run -v.
-                    if (verbose) {
-                        NSLog(@"%@",message);
+
+                    NSString *fullMessage;
+                    if (_verb == kLGAutoPkgRepoUpdate) {
+                        fullMessage = [NSString stringWithFormat:@"Updating %@", [message lastPathComponent]];
+                    } else {
+                        int cntStr = (int)round(count) + 1;
+                        int totStr = (int)round(total);
+                        fullMessage = [NSString stringWithFormat:@"(%d/%d) %@", cntStr, totStr, message];
                     }
+
+                    double progress = ((count/total) * 100);
+
+                    LGAutoPkgTaskResponseObject *response = [[LGAutoPkgTaskResponseObject alloc] init];
+                    response.progressMessage = fullMessage;
+                    response.progress = progress;
+                    count++;
+
+                    [_taskStatusDelegate didReceiveStatusUpdate:response];
+
+                    // If verboseAutoPkgRun is not enabled, log the limited message here.
+                    if (!verbose) {
+                        NSLog(@"%@", LGRedactedString(message));
+                    }
+                }
+                // If verboseAutoPkgRun is enabled, log everything generated by autopkg run -v.
+                if (verbose) {
+                    NSLog(@"%@", LGRedactedString(message));
+                }
+            }];
+
+            if (isInteractive) {
+                // Prompts don't end with a line break, so check the unterminated line.
+                _stdoutFramer.partialLineHandler = ^(const char *bytes, NSUInteger length) {
+                    if (isInteractivePrompt(bytes, length)) {
+                        NSString *message = LGLineString(bytes, length);
+                        DevLog(@"Prompting for interaction: %@", message);
+                        [self interactiveAlertWithMessage:message];
+                    }
+                };
+            }
+
+            [[standardOutput fileHandleForReading] setReadabilityHandler:^(NSFileHandle *handle) {
+                NSData *data = handle.availableData;
+                if (data.length) {
+                    [_stdoutFramer appendData:data];
                 }
             }];
         }
@@ -690,9 +1498,17 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
         NSFileManager *fm = [NSFileManager defaultManager];
         NSString *reportPlistFile = self.reportPlistFile;
 
+        // Start with the journaled recipe results, these are all there is
+        // when the run was canceled or autopkg exited before writing the report.
+        [_journal finish];
+        workingReport = [self.partialReport mutableCopy] ?: [[NSMutableDictionary alloc] init];
+
         if (reportPlistFile && [fm fileExistsAtPath:reportPlistFile]) {
-            // Create dictionary from the tmp file
-            workingReport = [NSMutableDictionary dictionaryWithContentsOfFile:reportPlistFile];
+            // Values from the tmp file take precedence over the journaled values.
+            NSDictionary *reportPlist = [NSDictionary dictionaryWithContentsOfFile:reportPlistFile];
+            if (reportPlist) {
+                [workingReport addEntriesFromDictionary:reportPlist];
+            }
 
             // Cleanup the tmp file (unless debugging is enabled)
             if (![[LGDefaults standardUserDefaults] debug]) {
@@ -702,6 +1518,10 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
                 }
             }
         }
+
+        if (_journal.journalFile && ![[LGDefaults standardUserDefaults] debug]) {
+            [fm removeItemAtPath:_journal.journalFile error:nil];
+        }
     } else {
         // For AutoPkg earlier than 0.4.0 the report plist was piped to stdout
         // so convert that string to an NSDictionary
@@ -719,6 +1539,20 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     return _report;
 }
 
+- (NSDictionary *)partialReport
+{
+    if (_report || !_journal) {
+        return _report;
+    }
+
+    // The versioner is still being fed from the stdout handler, so
+    // detected_versions are only added to the final report.
+    NSMutableDictionary *partialReport = [[_journal report] mutableCopy];
+    [partialReport setObject:_version forKey:@"report_version"];
+
+    return [partialReport copy];
+}
+
 - (NSString *)reportPlistFile
 {
     if (!_reportPlistFile) {
@@ -763,6 +1597,16 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 }
 
 #pragma mark - Utility
+- (LGAutoPkgSchedulerLane)lane
+{
+    if (_verb == kLGAutoPkgRun) {
+        return kLGAutoPkgSchedulerLaneRun;
+    } else if (_verb & (kLGAutoPkgRepoAdd | kLGAutoPkgRepoDelete | kLGAutoPkgRepoUpdate)) {
+        return kLGAutoPkgSchedulerLaneMaintenance;
+    }
+    return kLGAutoPkgSchedulerLaneInteractive;
+}
+
 - (BOOL)isNetworkOperation
 {
     return (_verb & (kLGAutoPkgRun | kLGAutoPkgSearch | kLGAutoPkgRepoAdd | kLGAutoPkgRepoUpdate));
@@ -838,7 +1682,11 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 
     __weak typeof(task) weakTask = task;
     [task launchInBackground:^(NSError *error) {
-        reply(weakTask.report,error);
+        NSDictionary *report = weakTask.report;
+        recordRun(report);
+        if (reply) {
+            reply(report, error);
+        }
     }];
 }
 
@@ -846,12 +1694,18 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
              progress:(void (^)(NSString *, double))progress
                 reply:(void (^)(NSDictionary *, NSError *))reply
 {
+    [[LGAutoPkgRecipeList sharedList] synchronize];
+
     LGAutoPkgTask *task = [LGAutoPkgTask runRecipeListTask:recipeList];
     task.progressUpdateBlock = progress;
 
     __weak typeof(task) weakTask = task;
     [task launchInBackground:^(NSError *error) {
-        reply(weakTask.report,error);
+        NSDictionary *report = weakTask.report;
+        recordRun(report);
+        if (reply) {
+            reply(report, error);
+        }
     }];
 }
 
@@ -947,7 +1801,7 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 + (void)repoUpdate:(void (^)(NSString *, double taskProgress))progress
              reply:(void (^)(NSError *error))reply;
 {
-    LGAutoPkgTask *task = [[LGAutoPkgTask alloc] initWithArguments:@[ @"repo-update", @"all" ]];
+    LGAutoPkgTask *task = [self repoUpdateTask];
     task.progressUpdateBlock = progress;
     [task launchInBackground:^(NSError *error) {
         reply(error);
@@ -979,15 +1833,44 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 }
 
 #pragma mark - Other
-+ (NSString *)version
+#pragma mark-- Version Cache --
+/* Asking autopkg for its version means starting a Python interpreter,
+ * so the answer is kept for as long as the autopkg binary stays the
+ * same file. stat() follows the /usr/local/bin/autopkg symlink, so
+ * installing a new release changes the inode or modification date.
+ */
+static dispatch_queue_t autopkg_version_queue()
+{
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.lindegroup.autopkgr.version.queue", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+static NSString *_cachedVersion;
+static NSString *_cachedVersionPath;
+static dev_t _cachedVersionDevice;
+static ino_t _cachedVersionInode;
+static struct timespec _cachedVersionModified;
+
+static BOOL versionCacheIsCurrent(NSString *path, struct stat *st)
+{
+    return _cachedVersion && [_cachedVersionPath isEqualToString:path] &&
+           _cachedVersionDevice == st->st_dev &&
+           _cachedVersionInode == st->st_ino &&
+           _cachedVersionModified.tv_sec == st->st_mtimespec.tv_sec &&
+           _cachedVersionModified.tv_nsec == st->st_mtimespec.tv_nsec;
+}
+
+static NSString *probeAutoPkgVersion(NSString *path)
 {
     NSString *version;
 
     NSTask *task = [[NSTask alloc] init];
-
-    task = task;
     task.launchPath = @"/usr/bin/python";
-    task.arguments = @[ autopkg(), @"version" ];
+    task.arguments = @[ path, @"version" ];
     task.standardOutput = [NSPipe pipe];
     [task launch];
     [task waitUntilExit];
@@ -1000,11 +1883,60 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     return [version stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] ?: @"0.0.0";
 }
 
+/* Must be called on the autopkg_version_queue. */
+static NSString *currentAutoPkgVersion()
+{
+    NSString *path = autopkg();
+
+    struct stat st;
+    if (stat(path.fileSystemRepresentation, &st) != 0) {
+        // Nothing to ask, autopkg isn't installed.
+        _cachedVersion = nil;
+        return @"0.0.0";
+    }
+
+    if (!versionCacheIsCurrent(path, &st)) {
+        _cachedVersion = probeAutoPkgVersion(path);
+        _cachedVersionPath = path;
+        _cachedVersionDevice = st.st_dev;
+        _cachedVersionInode = st.st_ino;
+        _cachedVersionModified = st.st_mtimespec;
+    }
+
+    return _cachedVersion;
+}
+
++ (NSString *)version
+{
+    __block NSString *version;
+    // Serial so simultaneous callers share a single probe.
+    dispatch_sync(autopkg_version_queue(), ^{
+        version = currentAutoPkgVersion();
+    });
+    return version;
+}
+
++ (void)refreshVersionInBackground:(void (^)(NSString *version))reply
+{
+    dispatch_async(autopkg_version_queue(), ^{
+        NSString *version = currentAutoPkgVersion();
+        if (reply) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                reply(version);
+            });
+        }
+    });
+}
+
 + (NSString *)apiToken
 {
     NSString *tokenFile = nil;
     if ([self apiTokenFileExists:&tokenFile]) {
-        return [NSString stringWithContentsOfFile:tokenFile encoding:NSUTF8StringEncoding error:nil];
+        NSString *token = [NSString stringWithContentsOfFile:tokenFile encoding:NSUTF8StringEncoding error:nil];
+
+        // Keep the token out of logs and reports, whatever its format.
+        [[LGRedactor sharedRedactor] addSecret:token];
+        return token;
     }
     return nil;
 }
@@ -1143,6 +2075,18 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
     return task;
 }
 
++ (LGAutoPkgTask *)runRecipeListTask:(NSString *)recipeList runGroup:(LGAutoPkgRunGroup *)runGroup
+{
+    NSParameterAssert(recipeList && runGroup);
+    LGAutoPkgTask *task = [[LGAutoPkgTask alloc] init];
+    task.runGroup = runGroup;
+
+    // Keep each shard's report next to its recipe list, so concurrent shards never collide.
+    task.reportPlistFile = [recipeList.stringByDeletingPathExtension stringByAppendingPathExtension:@"plist"];
+    task.arguments = @[ @"run", @"--recipe-list", recipeList, @"--report-plist" ];
+    return task;
+}
+
 + (LGAutoPkgTask *)searchTask:(NSString *)recipe
 {
     NSParameterAssert(recipe);
@@ -1153,6 +2097,7 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
 + (LGAutoPkgTask *)repoUpdateTask
 {
     LGAutoPkgTask *task = [[LGAutoPkgTask alloc] initWithArguments:@[ @"repo-update", @"all" ]];
+    task.parallelRepoUpdate = [[LGDefaults standardUserDefaults] parallelRepoUpdateEnabled];
     return task;
 }
 
@@ -1178,23 +2123,49 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
                           matchingArguments:runningArgs] != nil);
 }
 
-#pragma mark - Task Status Update Delegate
-- (void)didReceiveStatusUpdate:(LGAutoPkgTaskResponseObject *)object
+- (BOOL)conflictingInstanceIsRunning
 {
-    if (![NSThread isMainThread]) {
-        [self performSelector:@selector(didReceiveStatusUpdate:) onThread:[NSThread mainThread] withObject:object waitUntilDone:NO];
-        return;
+    if (!_runGroup) {
+        return [[self class] instanceIsRunning];
     }
 
-    if (object.progressMessage) {
-        if (_progressUpdateBlock) {
-            _progressUpdateBlock(object.progressMessage, object.progress);
+    /* A shard only conflicts with autopkg runs that
+     * aren't part of its own run group. */
+    NSArray *runningArgs = @[ autopkg(), @"run", @"--recipe-list" ];
+    for (BSDProcessInfo *process in [BSDProcessInfo allProcessesWithName:@"Python" matchingArguments:runningArgs]) {
+        NSUInteger idx = [process.arguments indexOfObject:@"--recipe-list"];
+        if (idx == NSNotFound || idx + 1 >= process.arguments.count) {
+            return YES;
         }
 
-        if (_progressDelegate) {
-            [_progressDelegate updateProgress:object.progressMessage progress:object.progress];
+        NSString *runningList = process.arguments[idx + 1];
+        if (![runningList.stringByDeletingLastPathComponent isEqualToString:_runGroup.directory]) {
+            return YES;
         }
     }
+    return NO;
+}
+
+#pragma mark - Task Status Update Delegate
+- (void)didReceiveStatusUpdate:(LGAutoPkgTaskResponseObject *)object
+{
+    // Output can produce many updates a second, the channel
+    // only passes the latest one on to the main thread per interval.
+    if (object.progressMessage) {
+        [_progressChannel sendMessage:object.progressMessage progress:object.progress];
+    }
+}
+
+- (void)updateProgress:(NSString *)message progress:(double)progress
+{
+    // Called on the main thread by the progress channel.
+    if (_progressUpdateBlock) {
+        _progressUpdateBlock(message, progress);
+    }
+
+    if (_progressDelegate) {
+        [_progressDelegate updateProgress:message progress:progress];
+    }
 }
 
 - (void)didCompleteOperation:(LGAutoPkgTaskResponseObject *)object
@@ -1204,6 +2175,9 @@ typedef void (^AutoPkgReplyErrorBlock)(NSError *error);
         return;
     }
 
+    // Make sure the final progress is shown before the task replies.
+    [_progressChannel flush];
+
     if (_replyResultsBlock) {
         _replyResultsBlock(object.results, object.error);
     }
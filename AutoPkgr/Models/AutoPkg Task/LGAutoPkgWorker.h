@@ -0,0 +1,81 @@
+//
+//  LGAutoPkgWorker.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+// Response keys.
+/**
+ *  NSNumber, exit code autopkg returned for the request.
+ */
+extern NSString *const kLGAutoPkgWorkerExitCodeKey;
+/**
+ *  NSString, what autopkg wrote to stdout.
+ */
+extern NSString *const kLGAutoPkgWorkerStandardOutKey;
+/**
+ *  NSString, what autopkg wrote to stderr.
+ */
+extern NSString *const kLGAutoPkgWorkerStandardErrKey;
+
+/*
+ * LGAutoPkgWorker keeps a single python process with autopkg already
+ * loaded, so a request only pays for the verb's own work instead of
+ * the interpreter start up and library imports.
+ *
+ * Requests and responses are single lines of JSON on the process's
+ * stdin and stdout. The process is launched on the first request and
+ * relaunched after it crashes, or when the version of autopkg changes.
+ */
+@interface LGAutoPkgWorker : NSObject
+
+/**
+ *  Initialize a worker.
+ *
+ *  @param script  path of the worker script, it's run with /usr/bin/python.
+ *  @param autopkg path of the autopkg binary passed to the script.
+ */
+- (instancetype)initWithScript:(NSString *)script autopkg:(NSString *)autopkg;
+
+@property (copy, nonatomic, readonly) NSString *script;
+@property (copy, nonatomic, readonly) NSString *autopkg;
+
+/**
+ *  Whether the worker process is currently running.
+ */
+@property (assign, readonly, getter=isRunning) BOOL running;
+
+/**
+ *  Send a request to the worker, launching it if needed.
+ *
+ *  @param arguments   autopkg arguments, starting with the verb.
+ *  @param environment environment to use for the request, or nil to keep the worker's.
+ *  @param version     version of autopkg currently installed, the worker is relaunched if it has a different one loaded.
+ *
+ *  @return dictionary with the kLGAutoPkgWorker... keys, or nil if the worker is busy with another request or couldn't answer.
+ */
+- (NSDictionary *)sendRequest:(NSArray *)arguments
+                  environment:(NSDictionary *)environment
+                      version:(NSString *)version;
+
+/**
+ *  Stop the worker process, the next request launches a new one.
+ */
+- (void)terminate;
+
+@end
@@ -0,0 +1,215 @@
+//
+//  LGAutoPkgWorker.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGAutoPkgWorker.h"
+#import "LGAutoPkgr.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+
+NSString *const kLGAutoPkgWorkerExitCodeKey = @"exit_code";
+NSString *const kLGAutoPkgWorkerStandardOutKey = @"stdout";
+NSString *const kLGAutoPkgWorkerStandardErrKey = @"stderr";
+
+@implementation LGAutoPkgWorker {
+    NSLock *_lock;
+    NSTask *_task;
+    int _requestFD;
+    int _responseFD;
+    NSMutableData *_buffer;
+
+    // Version of autopkg the running worker loaded.
+    NSString *_version;
+}
+
+- (void)dealloc
+{
+    [self terminate];
+}
+
+- (instancetype)initWithScript:(NSString *)script autopkg:(NSString *)autopkg
+{
+    if (self = [super init]) {
+        _script = [script copy];
+        _autopkg = [autopkg copy];
+        _lock = [[NSLock alloc] init];
+        _lock.name = @"com.lindegroup.autopkgr.worker.lock";
+        _buffer = [[NSMutableData alloc] init];
+        _requestFD = -1;
+        _responseFD = -1;
+    }
+    return self;
+}
+
+- (BOOL)isRunning
+{
+    [_lock lock];
+    BOOL running = _task.isRunning;
+    [_lock unlock];
+    return running;
+}
+
+#pragma mark - Requests
+- (NSDictionary *)sendRequest:(NSArray *)arguments
+                  environment:(NSDictionary *)environment
+                      version:(NSString *)version
+{
+    // A busy worker isn't waited on, the caller can launch autopkg itself.
+    if (![_lock tryLock]) {
+        return nil;
+    }
+
+    NSDictionary *response = nil;
+
+    if (_task.isRunning && version && ![version isEqualToString:_version]) {
+        DLog(@"autopkg changed from %@ to %@, relaunching the worker", _version, version);
+        [self terminateProcess];
+    }
+
+    if (!_task.isRunning && [self launchProcess]) {
+        _version = [version copy];
+    }
+
+    if (_task) {
+        NSMutableDictionary *request = [@{ @"arguments" : arguments ?: @[] } mutableCopy];
+        if (environment) {
+            request[@"environment"] = environment;
+        }
+
+        NSMutableData *requestData = [[NSJSONSerialization dataWithJSONObject:request options:0 error:nil] mutableCopy];
+        [requestData appendBytes:"\n" length:1];
+
+        NSData *responseData = nil;
+        if ([self writeData:requestData] && (responseData = [self readLine])) {
+            id object = [NSJSONSerialization JSONObjectWithData:responseData options:0 error:nil];
+            if ([object isKindOfClass:[NSDictionary class]] && object[kLGAutoPkgWorkerExitCodeKey]) {
+                response = object;
+            }
+        }
+
+        if (!response) {
+            // The worker crashed or is confused, start over with the next request.
+            DLog(@"autopkg worker failed to answer %@", arguments.firstObject);
+            [self terminateProcess];
+        }
+    }
+
+    [_lock unlock];
+    return response;
+}
+
+- (void)terminate
+{
+    [_lock lock];
+    [self terminateProcess];
+    [_lock unlock];
+}
+
+#pragma mark - Process
+- (BOOL)launchProcess
+{
+    [self terminateProcess];
+
+    NSPipe *requestPipe = [NSPipe pipe];
+    NSPipe *responsePipe = [NSPipe pipe];
+
+    NSTask *task = [[NSTask alloc] init];
+    task.launchPath = @"/usr/bin/python";
+    task.arguments = @[ _script, _autopkg ];
+    task.currentDirectoryPath = NSTemporaryDirectory();
+    task.standardInput = requestPipe;
+    task.standardOutput = responsePipe;
+    task.standardError = [NSFileHandle fileHandleWithNullDevice];
+
+    @try {
+        [task launch];
+    }
+    @catch (NSException *exception)
+    {
+        NSLog(@"Could not launch the autopkg worker: %@", exception.reason);
+        return NO;
+    }
+
+    _task = task;
+    _requestFD = requestPipe.fileHandleForWriting.fileDescriptor;
+    _responseFD = responsePipe.fileHandleForReading.fileDescriptor;
+
+    // Report a dead worker as EPIPE rather than a signal.
+    fcntl(_requestFD, F_SETNOSIGPIPE, 1);
+
+    return YES;
+}
+
+- (void)terminateProcess
+{
+    if (_task.isRunning) {
+        [_task terminate];
+    }
+    _task = nil;
+    _requestFD = -1;
+    _responseFD = -1;
+    _version = nil;
+    _buffer.length = 0;
+}
+
+- (BOOL)writeData:(NSData *)data
+{
+    const char *bytes = data.bytes;
+    NSUInteger remaining = data.length;
+
+    while (remaining) {
+        ssize_t written = write(_requestFD, bytes, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return NO;
+        }
+        bytes += written;
+        remaining -= written;
+    }
+    return YES;
+}
+
+- (NSData *)readLine
+{
+    char chunk[4096];
+
+    while (YES) {
+        const char *bytes = _buffer.bytes;
+        const char *newline = memchr(bytes, '\n', _buffer.length);
+        if (newline) {
+            NSUInteger length = newline - bytes;
+            NSData *line = [NSData dataWithBytes:bytes length:length];
+            [_buffer replaceBytesInRange:NSMakeRange(0, length + 1) withBytes:NULL length:0];
+            return line;
+        }
+
+        ssize_t count = read(_responseFD, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            // EOF, the worker has exited.
+            return nil;
+        }
+        [_buffer appendBytes:chunk length:count];
+    }
+}
+
+@end
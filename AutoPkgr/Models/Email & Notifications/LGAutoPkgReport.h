@@ -70,10 +70,31 @@ typedef NS_ENUM(NSInteger, LGReportIntegrationFrequency) {
 
 #pragma mark - Strings
 /**
- *  Fully formatted HTML message suitable for email
+ *  Fully formatted HTML message suitable for email, rendered with the report.html template
  */
 @property (copy, nonatomic, readonly) NSString *emailMessageString;
 
+/**
+ *  Plain text message, rendered with the report.txt template
+ */
+@property (copy, nonatomic, readonly) NSString *plainTextMessageString;
+
+/**
+ *  Slack section blocks, rendered with the report_slack.txt template
+ */
+@property (copy, nonatomic, readonly) NSArray *slackBlocks;
+
+/**
+ *  The report model as JSON
+ */
+@property (copy, nonatomic, readonly) NSData *JSONData;
+
+/**
+ *  Dictionary the report templates are rendered with
+ *  @note See the templates in AutoPkgr's resources for the keys, custom templates can be put in the LGReportTemplate userTemplatesDirectory.
+ */
+@property (copy, nonatomic, readonly) NSDictionary *reportModel;
+
 /**
  *  Email subject message
  */
@@ -19,36 +19,34 @@
 //
 
 #import "LGAutoPkgReport.h"
+#import "LGAutoPkgReportAnalyzer.h"
 #import "LGAutoPkgRecipe.h"
 #import "LGIntegrationManager.h"
+#import "LGRedactor.h"
+#import "LGReportTemplate.h"
 
 #import "HTMLCategories.h"
 
-// Key for AutoPkg 0.4.3 report summary
-NSString *const kReportKeySummaryResults = @"summary_results";
+// Slack's limit on the text of a section block.
+static NSUInteger const kLGSlackSectionLength = 3000;
 
-// Key used to check for AutoPkg version
-NSString *const kReportKeyReportVersion = @"report_version";
+static NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Helvetica Neue',Helvetica,sans-serif;font-size:11pt}a{color:#157463;text-decoration:underline}a:hover{color:#0d332a}h1{background-color:#eaf6f4;color:#157463;font-weight:700;font-size:14pt;margin:30px 0 0;padding:5px;text-transform:uppercase;text-align:center}ul{list-style-type:none;padding:0;margin:0;margin-left:1em}p{padding:5px}td,th{padding:5px 15px;text-align:left}th{background-color:#eaf6f4;color:#157463;font-weight:400;text-transform:uppercase}.status,.pkgname{font-weight:700}.footer{font-size:10pt;text-align:center;margin:30px 0 10px}</style>";
 
-// Other Top level keys
-NSString *const kReportKeyFailures = @"failures";
-NSString *const kReportKeyDetectedVersions = @"detected_versions";
-
-// _summary_result level keys for AutoPkg report
-NSString *const kReportKeySummaryText = @"summary_text";
-NSString *const kReportKeyDataRows = @"data_rows";
-NSString *const kReportKeyHeaders = @"header";
-
-// _summary_result processor keys
-NSString *const kReportProcessorInstaller = @"installer_summary_result";
-NSString *const kReportProcessorURLDownloader = @"url_downloader_summary_result";
-NSString *const kReportProcessorInstallFromDMG = @"install_from_dmg_summary_result";
-NSString *const kReportProcessorMunkiImporter = @"munki_importer_summary_result";
-NSString *const kReportProcessorPKGCreator = @"pkg_creator_summary_result";
-NSString *const kReportProcessorJSSImporter = @"jss_importer_summary_result";
-NSString *const kReportProcessorPKGCopier = @"pkg_copier_summary_result";
-
-NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Helvetica Neue',Helvetica,sans-serif;font-size:11pt}a{color:#157463;text-decoration:underline}a:hover{color:#0d332a}h1{background-color:#eaf6f4;color:#157463;font-weight:700;font-size:14pt;margin:30px 0 0;padding:5px;text-transform:uppercase;text-align:center}ul{list-style-type:none;padding:0;margin:0;margin-left:1em}p{padding:5px}td,th{padding:5px 15px;text-align:left}th{background-color:#eaf6f4;color:#157463;font-weight:400;text-transform:uppercase}.status,.pkgname{font-weight:700}.footer{font-size:10pt;text-align:center;margin:30px 0 10px}</style>";
+static NSString *reportCSS()
+{
+    // The stylesheet doesn't change while AutoPkgr runs, so it's only read once.
+    static NSString *css;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        css = [NSString html_cssStringFromResourceNamed:@"report"
+                                                 bundle:[NSBundle bundleForClass:[LGAutoPkgReport class]]];
+        if (!css) {
+            // If there's a problem getting the bundle resource revert to the hard coded CSS string.
+            css = fallback_reportCSS;
+        }
+    });
+    return css;
+}
 
 #pragma mark - LGUpdatedApplication
 @implementation LGUpdatedApplication {
@@ -82,6 +80,7 @@ NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Hel
 
 @implementation LGAutoPkgReport {
     NSDictionary *_reportDictionary;
+    LGAutoPkgReportAnalyzer *_analyzer;
 }
 
 @synthesize updatedApplications = _updatedApplications;
@@ -89,7 +88,9 @@ NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Hel
 - (instancetype)initWithReportDictionary:(NSDictionary *)dictionary
 {
     if (self = [super init]) {
-        _reportDictionary = [self normalizedAutoPkgReport:dictionary];
+        // Recipe inputs and failure messages can carry credentials, mask them before anything is rendered.
+        _reportDictionary = [[LGRedactor sharedRedactor] redactObject:[self normalizedAutoPkgReport:dictionary]];
+        _analyzer = [[LGAutoPkgReportAnalyzer alloc] initWithReport:_reportDictionary];
         _autoPkgReport = dictionary;
         _reportedItemFlags = kLGReportItemsNone;
 
@@ -103,24 +104,26 @@ NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Hel
 
 - (void)setAutoPkgReport:(NSDictionary *)autoPkgReport
 {
-    _reportDictionary = [self normalizedAutoPkgReport:autoPkgReport];
+    _reportDictionary = [[LGRedactor sharedRedactor] redactObject:[self normalizedAutoPkgReport:autoPkgReport]];
+    _analyzer = [[LGAutoPkgReportAnalyzer alloc] initWithReport:_reportDictionary];
     _autoPkgReport = autoPkgReport;
+    _updatedApplications = nil;
 }
 
 - (BOOL)updatesToReport
 {
-    if (([_reportDictionary[kReportKeySummaryResults][kReportProcessorURLDownloader] count] > 0)) {
+    if ([_analyzer dataRowsForProcessor:kReportProcessorURLDownloader].count > 0) {
         return YES;
     }
-    return (([_reportDictionary[kReportKeyFailures] count] > 0) || _error ||
+    return ((_analyzer.failures.count > 0) || _error ||
             [self integrationsUpdateAvailable]);
 }
 
 - (NSString *)emailSubjectString
 {
-    if ([_reportDictionary[kReportKeySummaryResults] count] > 0) {
+    if (_analyzer.processors.count > 0) {
         return quick_formatString(NSLocalizedString(@"New software available for testing", nil));
-    } else if ([_reportDictionary[kReportKeyFailures] count] > 0) {
+    } else if (_analyzer.failures.count > 0) {
         return quick_formatString(NSLocalizedString(@"Failures occurred while running AutoPkg", nil));
     } else if (self.error) {
         return quick_formatString(NSLocalizedString(@"An error occurred while running AutoPkg", nil));
@@ -136,245 +139,228 @@ NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Hel
 
 - (NSString *)emailMessageString
 {
-    NSString *overviewString;
-    NSString *detailsString;
-
-    NSMutableString *message = [@"<html>\n<head>\n" mutableCopy];
-
-    NSString *cssString = [NSString html_cssStringFromResourceNamed:@"report"
-                                                             bundle:[NSBundle bundleForClass:[self class]]];
-
-    if (!cssString) {
-        // If there's a problem getting the bundle resource revert to the hard coded CSS string.
-        cssString = fallback_reportCSS;
-    }
-
-    [message appendString:cssString];
+    return [[LGReportTemplate templateNamed:@"report.html" escaping:kLGReportTemplateEscapingHTML] render:self.reportModel];
+}
 
-    [message appendString:@"</head>\n<body>"];
+- (NSString *)plainTextMessageString
+{
+    return [[LGReportTemplate templateNamed:@"report.txt" escaping:kLGReportTemplateEscapingNone] render:self.reportModel];
+}
 
-    if ((overviewString = [self overviewString])) {
-        [message appendString:overviewString];
-    }
+- (NSArray *)slackBlocks
+{
+    NSString *text = [[LGReportTemplate templateNamed:@"report_slack.txt" escaping:kLGReportTemplateEscapingSlack] render:self.reportModel];
+
+    // Slack limits the text of a section block to 3000 characters,
+    // so longer reports are split between lines over several blocks.
+    NSMutableArray *blocks = [[NSMutableArray alloc] init];
+    NSMutableString *section = [[NSMutableString alloc] init];
+
+    void (^addSection)() = ^{
+        if (section.length) {
+            [blocks addObject:@{ @"type" : @"section",
+                                 @"text" : @{ @"type" : @"mrkdwn",
+                                              @"text" : [section copy] } }];
+            [section setString:@""];
+        }
+    };
 
-    if ((detailsString = [self detailsString])) {
-        [message appendString:html_breakTwice];
-        [message appendString:detailsString];
+    for (NSString *line in [text componentsSeparatedByString:@"\n"]) {
+        if (section.length + line.length + 1 > kLGSlackSectionLength) {
+            addSection();
+        }
+        [section appendString:line.length > kLGSlackSectionLength ? [line substringToIndex:kLGSlackSectionLength - 1] : line];
+        [section appendString:@"\n"];
     }
+    addSection();
 
-    NSString *autoPkgrLink = quick_formatString(NSLocalizedString(@"This report was generated by %@", nil),
-                                                [@"AutoPkgr" html_link:@"https://github.com/lindegroup/autopkgr"]);
-
-    [message appendString:[autoPkgrLink html_H4]];
+    return [blocks copy];
+}
 
-    [message appendString:@"\n</body></html>"];
+- (NSData *)JSONData
+{
+    NSMutableDictionary *model = [self.reportModel mutableCopy];
+    [model removeObjectForKey:@"css"];
 
-    return [message copy];
+    return [NSJSONSerialization dataWithJSONObject:model options:NSJSONWritingPrettyPrinted error:nil];
 }
 
-#pragma mark - Private
-- (NSString *)overviewString
+#pragma mark - Model
+- (NSDictionary *)reportModel
 {
-    NSMutableString *overview = [[NSMutableString alloc] init];
-    NSInteger initialLength = overview.length;
+    NSMutableDictionary *model = [[NSMutableDictionary alloc] init];
 
-    NSString *newSoftware;
-    NSString *runFailures;
-    NSString *errorsString;
-    NSString *integrationString;
+    model[@"subject"] = self.emailSubjectString ?: @"";
+    model[@"css"] = reportCSS();
+    model[@"autopkgr_url"] = @"https://github.com/lindegroup/autopkgr";
 
-    if ((newSoftware = [self newSoftwareString])) {
-        [overview appendString:newSoftware];
+    // Each part is left out when there's nothing in it, so templates
+    // can render its heading in a {{#part}} section.
+    NSArray *newSoftware = [self newSoftwareModel];
+    if (newSoftware.count) {
+        model[@"new_software"] = @{ @"items" : newSoftware };
     }
 
-    if ((integrationString = [self integrationStatusString])) {
-        [overview appendString:integrationString];
+    NSArray *integrationUpdates = [self integrationUpdatesModel];
+    if (integrationUpdates.count) {
+        model[@"integration_updates"] = @{ @"items" : integrationUpdates };
     }
 
-    if ((runFailures = [self runFailuresString])) {
-        [overview appendString:runFailures];
+    NSArray *failures = [self failuresModel];
+    if (failures.count) {
+        model[@"failures"] = @{ @"items" : failures };
     }
 
-    if ((errorsString = [self errorString])) {
-        [overview appendString:errorsString];
+    NSArray *errors = [self errorsModel];
+    if (errors.count) {
+        model[@"errors"] = @{ @"items" : errors };
     }
 
-    if (initialLength == overview.length) {
-        [overview appendString:NSLocalizedString(@"Nothing new to report.", nil)];
+    NSArray *details = [self detailsModel];
+    if (details.count) {
+        model[@"details"] = @{ @"items" : details };
     }
 
-    return [overview copy];
+    model[@"nothing_to_report"] = @(!newSoftware.count && !integrationUpdates.count && !failures.count && !errors.count);
+
+    return [model copy];
 }
 
-- (NSString *)newSoftwareString
+- (NSArray *)newSoftwareModel
 {
-    NSMutableString *string = nil;
-
-    if (self.updatedApplications.count) {
-        NSMutableArray *dictArray = [NSMutableArray new];
-        string = [NSLocalizedString(@"New software available for testing:", nil).html_H3 mutableCopy];
+    NSMutableArray *applications = [[NSMutableArray alloc] initWithCapacity:self.updatedApplications.count];
+    for (LGUpdatedApplication *application in _updatedApplications) {
+        [applications addObject:@{ @"name" : application.name,
+                                   @"version" : application.version,
+                                   @"path" : application.path }];
+    }
+    return [applications copy];
+}
 
-        for (LGUpdatedApplication *application in _updatedApplications) {
-            [dictArray addObject:@{ @"name" : application.name,
-                                    @"version" : application.version
-            }];
+- (NSArray *)integrationUpdatesModel
+{
+    NSMutableArray *updates = [[NSMutableArray alloc] init];
+    for (LGIntegration *integration in _integrations) {
+        if ([[integration class] isInstalled] && integration.info.status == kLGIntegrationUpdateAvailable) {
+            [updates addObject:integration.info.statusString ?: integration.name];
         }
-
-        NSString *table = [dictArray html_tableWithHeaders:@[ @"name", @"version" ] cssClassForColumns:@{ @"name" : @"pkgname" }];
-        [string appendString:table];
     }
-    return [string copy];
+    return [updates copy];
 }
 
-- (NSString *)runFailuresString
+- (NSArray *)failuresModel
 {
-    NSArray *failures = [_reportDictionary[kReportKeyFailures] filtered_ByClass:[NSDictionary class]];
-    NSMutableString *string = nil;
-
-    if (failures.count) {
-        string = [NSLocalizedString(@"The following failures occurred:", nil).html_H3 mutableCopy];
-        [string appendString:[failures html_table]];
+    NSMutableArray *failures = [[NSMutableArray alloc] initWithCapacity:_analyzer.failures.count];
+    for (NSDictionary *failure in _analyzer.failures) {
+        NSMutableDictionary *item = [[NSMutableDictionary alloc] initWithCapacity:3];
+        for (NSString *key in @[ @"recipe", @"message", @"traceback" ]) {
+            id value = failure[key];
+            if (value) {
+                item[key] = [value isKindOfClass:[NSString class]] ? value : [value description];
+            }
+        }
+        [failures addObject:item];
     }
-    return [string copy];
+    return [failures copy];
 }
 
-- (NSString *)detailsString
+- (NSArray *)detailsModel
 {
-    NSMutableString *string = nil;
+    NSMutableArray *details = [[NSMutableArray alloc] init];
     NSArray *includedProcessors = [self includedProcessorSummaryResults];
 
-    NSDictionary *summaryResults = _reportDictionary[kReportKeySummaryResults];
-
     // The includedProcessorSummaryResults method returns nil when intended to show all.
     // It's this way to be future compatible with autopkg processors that do not
     // yet exist, or do not currently provide _summary_results
-    if ((!includedProcessors || includedProcessors.count) && summaryResults.count) {
-
-        string = [[NSMutableString alloc] init];
-        [summaryResults enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *summary, BOOL *stop) {
-          // If the included processor is nil show everything.
-          if (!includedProcessors || [includedProcessors containsObject:key]) {
-              NSArray *headers = summary[kReportKeyHeaders];
-              NSArray *data_rows = [summary[kReportKeyDataRows] filtered_ByClass:[NSDictionary class]];
-              if (data_rows.count) {
-                  [string appendString:[summary[kReportKeySummaryText] html_H3]];
-                  if (headers.count > 1) {
-                      [string appendString:[data_rows html_tableWithHeaders:headers]];
-                  } else {
-                      [string appendString:html_openListUL];
-                      for (NSDictionary *row in data_rows) {
-                          NSString *value = [[row allValues] firstObject];
-                          [string appendString:[[value stringByAbbreviatingWithTildeInPath] html_listItem]];
-                      }
-                      [string appendString:html_closeListUL];
-                  }
-              }
-          }
-        }];
-    }
-    return [string copy];
-}
-
-- (NSString *)errorString
-{
-    NSMutableString *string = nil;
-    if (_error) {
-
-        NSArray *recoverySuggestions = [_error.localizedRecoverySuggestion
-            componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]];
-
-        NSString *noValidRecipe = @"No valid recipe found for ";
-        NSPredicate *noValidRecipePredicate = [NSPredicate predicateWithFormat:@"SELF BEGINSWITH %@", noValidRecipe];
-
-        NSArray *failures = [_reportDictionary[kReportKeyFailures] filtered_ByClass:[NSDictionary class]];
-        NSMutableOrderedSet *set = [NSMutableOrderedSet new];
-
-        for (NSString *errString in recoverySuggestions.filtered_noEmptyStrings) {
-            NSPredicate *failurePredicate = [NSPredicate predicateWithFormat:@"message CONTAINS[cd] %@", errString];
-
-            // Look over the failures array, if the same string occurred there
-            // Don't bother reporting it a second time here.
-            if (![failures filteredArrayUsingPredicate:failurePredicate].count) {
-                if (!string) {
-                    string = [NSLocalizedString(@"The following errors occurred:", nil).html_H3 mutableCopy];
-                }
+    for (NSString *processor in _analyzer.processors) {
+        if (includedProcessors && ![includedProcessors containsObject:processor]) {
+            continue;
+        }
 
-                if ([noValidRecipePredicate evaluateWithObject:errString]) {
-                    // Remove Recipe from Recipe.txt
-                    [LGAutoPkgRecipe removeRecipeFromRecipeList:[[errString componentsSeparatedByString:noValidRecipe] lastObject]];
-                    [set addObject:[errString stringByAppendingString:NSLocalizedString(@". It has been automatically removed from your recipe list in order to prevent recurring errors.", nil)]];
-                } else {
-                    [set addObject:errString];
+        NSArray *headers = [_analyzer headersForProcessor:processor];
+        NSArray *dataRows = [_analyzer dataRowsForProcessor:processor];
+        NSMutableDictionary *summary = [@{ @"processor" : processor,
+                                           @"summary_text" : [_analyzer summaryTextForProcessor:processor] } mutableCopy];
+
+        if (headers.count > 1) {
+            NSMutableArray *rows = [[NSMutableArray alloc] initWithCapacity:dataRows.count];
+            for (NSDictionary *row in dataRows) {
+                NSMutableArray *cells = [[NSMutableArray alloc] initWithCapacity:headers.count];
+                for (NSString *header in headers) {
+                    id value = row[header];
+                    [cells addObject:value ? [value description] : @""];
                 }
+                [rows addObject:cells];
             }
+            summary[@"table"] = @YES;
+            summary[@"headers"] = headers;
+            summary[@"rows"] = rows;
+        } else {
+            NSMutableArray *values = [[NSMutableArray alloc] initWithCapacity:dataRows.count];
+            for (NSDictionary *row in dataRows) {
+                id value = [[row allValues] firstObject];
+                [values addObject:[value isKindOfClass:[NSString class]] ? [value stringByAbbreviatingWithTildeInPath] : [value description]];
+            }
+            summary[@"table"] = @NO;
+            summary[@"values"] = values;
         }
-
-        if (set.count) {
-            [string appendString:[set.array html_list_unordered]];
-        }
+        [details addObject:summary];
     }
-    return [string copy];
+    return [details copy];
 }
 
-- (NSString *)integrationStatusString
+- (NSArray *)errorsModel
 {
-    NSMutableString *string = nil;
+    if (!_error) {
+        return nil;
+    }
 
-    for (LGIntegration *integration in _integrations) {
-        if ([[integration class] isInstalled] && integration.info.status == kLGIntegrationUpdateAvailable) {
-            if (!string) {
-                string = [NSLocalizedString(@"Updates for integrated components:", nil).html_H3 mutableCopy];
-                [string appendString:html_openListUL];
+    NSArray *recoverySuggestions = [LGRedactedString(_error.localizedRecoverySuggestion)
+        componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+
+    NSString *noValidRecipe = @"No valid recipe found for ";
+    NSMutableOrderedSet *set = [NSMutableOrderedSet new];
+
+    for (NSString *errString in recoverySuggestions.filtered_noEmptyStrings) {
+        // Look over the failures array, if the same string occurred there
+        // Don't bother reporting it a second time here.
+        if (![_analyzer failuresContainMessage:errString]) {
+            if ([errString hasPrefix:noValidRecipe]) {
+                // Remove Recipe from Recipe.txt
+                [LGAutoPkgRecipe removeRecipeFromRecipeList:[[errString componentsSeparatedByString:noValidRecipe] lastObject]];
+                [set addObject:[errString stringByAppendingString:NSLocalizedString(@". It has been automatically removed from your recipe list in order to prevent recurring errors.", nil)]];
+            } else {
+                [set addObject:errString];
             }
-            [string appendString:integration.info.statusString.html_listItem];
         }
     }
-    if (string) {
-        [string appendString:html_closeListUL];
-    }
-
-    return [string copy];
+    return set.array;
 }
 
+#pragma mark - Private
 - (NSArray *)updatedApplications
 {
     if (!_updatedApplications) {
-        NSArray *detectedVersions = [_reportDictionary objectForKey:kReportKeyDetectedVersions] ?: @[];
-        NSMutableSet *downloadList = [[NSMutableSet alloc] init];
-
-        NSArray *array = _reportDictionary[kReportKeySummaryResults][kReportProcessorURLDownloader][kReportKeyDataRows];
-
-        for (NSDictionary *d in array) {
-            NSString *item = d[@"download_path"];
-            if (item) {
-                [downloadList addObject:[item lastPathComponent]];
-            }
+        NSMutableOrderedSet *downloadList = [[NSMutableOrderedSet alloc] init];
+        for (NSString *item in _analyzer.downloadPaths) {
+            [downloadList addObject:[item lastPathComponent]];
         }
 
-        NSMutableArray *dictArray = nil;
-        if (downloadList.count) {
-            dictArray = [NSMutableArray new];
-            for (NSString *appPath in downloadList) {
-                NSString *version = nil;
-                NSString *app = [[appPath lastPathComponent] stringByDeletingPathExtension];
-
-                NSPredicate *versionPredicate = [NSPredicate predicateWithFormat:@"pkg_path CONTAINS[cd] %@", [app stringByDeletingPathExtension]];
-                for (NSDictionary *d in detectedVersions) {
-                    if ([versionPredicate evaluateWithObject:d] && d[@"version"]) {
-                        version = d[@"version"];
-                    }
-                }
-                NSDictionary *d = @{ @"name" : app,
-                                     @"path" : appPath,
-                                     @"version" : version ?: @"Unknown version"
-                };
+        NSMutableArray *dictArray = [[NSMutableArray alloc] initWithCapacity:downloadList.count];
+        for (NSString *appPath in downloadList) {
+            NSString *app = [appPath stringByDeletingPathExtension];
+            NSString *version = [_analyzer versionForPackageBasename:[app stringByDeletingPathExtension]];
 
-                LGUpdatedApplication *updatedApp = [[LGUpdatedApplication alloc] initWithDictionary:d];
+            NSDictionary *d = @{ @"name" : app,
+                                 @"path" : appPath,
+                                 @"version" : version ?: @"Unknown version"
+            };
 
-                [dictArray addObject:updatedApp];
-            }
+            LGUpdatedApplication *updatedApp = [[LGUpdatedApplication alloc] initWithDictionary:d];
+
+            [dictArray addObject:updatedApp];
         }
-        _updatedApplications = [NSArray arrayWithArray:dictArray];
+        _updatedApplications = [dictArray copy];
     }
 
     return _updatedApplications;
@@ -383,7 +369,7 @@ NSString *const fallback_reportCSS = @"<style type='text/css'>*{font-family:'Hel
 - (NSError *)failureError
 {
     NSError *failureError = nil;
-    NSArray *failures = [_reportDictionary[kReportKeyFailures] filtered_ByClass:[NSDictionary class]];
+    NSArray *failures = _analyzer.failures;
 
     if (failures.count) {
         NSMutableString *string = [[NSMutableString alloc] init];
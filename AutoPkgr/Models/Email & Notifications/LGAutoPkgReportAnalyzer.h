@@ -0,0 +1,111 @@
+//
+//  LGAutoPkgReportAnalyzer.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+// Top level keys of a --report-plist dictionary
+extern NSString *const kReportKeySummaryResults;
+extern NSString *const kReportKeyReportVersion;
+extern NSString *const kReportKeyFailures;
+extern NSString *const kReportKeyDetectedVersions;
+
+// _summary_result level keys
+extern NSString *const kReportKeySummaryText;
+extern NSString *const kReportKeyDataRows;
+extern NSString *const kReportKeyHeaders;
+
+// _summary_result processor keys
+extern NSString *const kReportProcessorInstaller;
+extern NSString *const kReportProcessorURLDownloader;
+extern NSString *const kReportProcessorInstallFromDMG;
+extern NSString *const kReportProcessorMunkiImporter;
+extern NSString *const kReportProcessorPKGCreator;
+extern NSString *const kReportProcessorJSSImporter;
+extern NSString *const kReportProcessorPKGCopier;
+
+/*
+ * LGAutoPkgReportAnalyzer walks a normalized --report-plist dictionary
+ * once and keeps indexed views of it, so the email, Slack and HipChat
+ * formatters can ask about a recipe, a package or a processor without
+ * scanning the whole report again.
+ */
+@interface LGAutoPkgReportAnalyzer : NSObject
+
+/**
+ *  Analyze a report.
+ *
+ *  @param report normalized --report-plist dictionary.
+ */
+- (instancetype)initWithReport:(NSDictionary *)report;
+
+#pragma mark - Failures
+/**
+ *  Failure dictionaries of the report, in order.
+ */
+@property (copy, nonatomic, readonly) NSArray *failures;
+
+/**
+ *  Failure of a recipe, nil if it didn't fail.
+ */
+- (NSDictionary *)failureForRecipe:(NSString *)recipe;
+
+/**
+ *  Whether any failure message contains a string, ignoring case and diacritics.
+ */
+- (BOOL)failuresContainMessage:(NSString *)message;
+
+#pragma mark - Processors
+/**
+ *  Keys of the processors' summary results that have data rows, e.g. url_downloader_summary_result, sorted.
+ */
+@property (copy, nonatomic, readonly) NSArray *processors;
+
+/**
+ *  Dictionary data rows of a processor's summary result.
+ */
+- (NSArray *)dataRowsForProcessor:(NSString *)processor;
+
+/**
+ *  Column headers of a processor's summary result.
+ */
+- (NSArray *)headersForProcessor:(NSString *)processor;
+
+/**
+ *  Summary text of a processor's summary result.
+ */
+- (NSString *)summaryTextForProcessor:(NSString *)processor;
+
+#pragma mark - Downloads & Versions
+/**
+ *  Paths of the new downloads, without duplicates, in the order they were reported.
+ */
+@property (copy, nonatomic, readonly) NSArray *downloadPaths;
+
+/**
+ *  Version detected for a package.
+ *
+ *  @param basename name of the package or download without its path and extension.
+ *
+ *  @return the version of the package with exactly that name, with or without its version,
+ *          otherwise of the last package whose path contains it, ignoring case and diacritics.
+ *          nil if none was detected.
+ */
+- (NSString *)versionForPackageBasename:(NSString *)basename;
+
+@end
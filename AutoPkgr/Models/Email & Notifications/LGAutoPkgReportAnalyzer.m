@@ -0,0 +1,256 @@
+//
+//  LGAutoPkgReportAnalyzer.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import "LGAutoPkgReportAnalyzer.h"
+#import "NSArray+filtered.h"
+
+// Key for AutoPkg 0.4.3 report summary
+NSString *const kReportKeySummaryResults = @"summary_results";
+
+// Key used to check for AutoPkg version
+NSString *const kReportKeyReportVersion = @"report_version";
+
+// Other Top level keys
+NSString *const kReportKeyFailures = @"failures";
+NSString *const kReportKeyDetectedVersions = @"detected_versions";
+
+// _summary_result level keys for AutoPkg report
+NSString *const kReportKeySummaryText = @"summary_text";
+NSString *const kReportKeyDataRows = @"data_rows";
+NSString *const kReportKeyHeaders = @"header";
+
+// _summary_result processor keys
+NSString *const kReportProcessorInstaller = @"installer_summary_result";
+NSString *const kReportProcessorURLDownloader = @"url_downloader_summary_result";
+NSString *const kReportProcessorInstallFromDMG = @"install_from_dmg_summary_result";
+NSString *const kReportProcessorMunkiImporter = @"munki_importer_summary_result";
+NSString *const kReportProcessorPKGCreator = @"pkg_creator_summary_result";
+NSString *const kReportProcessorJSSImporter = @"jss_importer_summary_result";
+NSString *const kReportProcessorPKGCopier = @"pkg_copier_summary_result";
+
+static NSString *foldedString(NSString *string)
+{
+    return [string stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch locale:nil];
+}
+
+static BOOL containsString(NSString *string, NSString *substring)
+{
+    return [string rangeOfString:substring options:NSLiteralSearch].location != NSNotFound;
+}
+
+// Package name without a trailing version, e.g. firefox for firefox-45.0.
+static NSString *unversionedName(NSString *name)
+{
+    NSCharacterSet *separators = [NSCharacterSet characterSetWithCharactersInString:@"-_ "];
+    NSCharacterSet *digits = [NSCharacterSet decimalDigitCharacterSet];
+
+    for (NSUInteger idx = 1; idx + 1 < name.length; idx++) {
+        if ([separators characterIsMember:[name characterAtIndex:idx]] && [digits characterIsMember:[name characterAtIndex:idx + 1]]) {
+            return [name substringToIndex:idx];
+        }
+    }
+    return name;
+}
+
+static NSArray *arrayOfClass(id object, Class class)
+{
+    return [object isKindOfClass:[NSArray class]] ? [object filtered_ByClass:class] : @[];
+}
+
+@implementation LGAutoPkgReportAnalyzer {
+    NSDictionary *_failuresByRecipe;
+
+    // Failure messages folded and separated by newlines, which
+    // is what the error strings they're compared to are split on.
+    NSString *_foldedFailureMessages;
+
+    NSDictionary *_summariesByProcessor;
+
+    // Detected versions keyed by the folded name of their package, with
+    // and without its version, along with every folded package path and
+    // its version, in order.
+    NSDictionary *_versionsByBasename;
+    NSDictionary *_versionsByUnversionedName;
+    NSArray *_foldedPackagePaths;
+    NSArray *_packageVersions;
+}
+
+- (instancetype)init
+{
+    return [self initWithReport:nil];
+}
+
+- (instancetype)initWithReport:(NSDictionary *)report
+{
+    if (self = [super init]) {
+        if (![report isKindOfClass:[NSDictionary class]]) {
+            report = nil;
+        }
+        [self analyzeFailures:report[kReportKeyFailures]];
+        [self analyzeSummaryResults:report[kReportKeySummaryResults]];
+        [self analyzeDetectedVersions:report[kReportKeyDetectedVersions]];
+    }
+    return self;
+}
+
+#pragma mark - Analysis
+- (void)analyzeFailures:(id)failures
+{
+    _failures = arrayOfClass(failures, [NSDictionary class]);
+
+    NSMutableDictionary *failuresByRecipe = [[NSMutableDictionary alloc] initWithCapacity:_failures.count];
+    NSMutableArray *messages = [[NSMutableArray alloc] initWithCapacity:_failures.count];
+
+    for (NSDictionary *failure in _failures) {
+        id recipe = failure[@"recipe"];
+        if ([recipe isKindOfClass:[NSString class]] && !failuresByRecipe[recipe]) {
+            failuresByRecipe[recipe] = failure;
+        }
+
+        id message = failure[@"message"];
+        if ([message isKindOfClass:[NSString class]]) {
+            [messages addObject:message];
+        }
+    }
+
+    _failuresByRecipe = [failuresByRecipe copy];
+    _foldedFailureMessages = foldedString([messages componentsJoinedByString:@"\n"]);
+}
+
+- (void)analyzeSummaryResults:(id)summaryResults
+{
+    NSMutableDictionary *summariesByProcessor = [[NSMutableDictionary alloc] init];
+    NSMutableOrderedSet *downloadPaths = [[NSMutableOrderedSet alloc] init];
+
+    if ([summaryResults isKindOfClass:[NSDictionary class]]) {
+        [summaryResults enumerateKeysAndObjectsUsingBlock:^(NSString *processor, NSDictionary *summary, BOOL *stop) {
+            if (![summary isKindOfClass:[NSDictionary class]]) {
+                return;
+            }
+
+            NSArray *dataRows = arrayOfClass(summary[kReportKeyDataRows], [NSDictionary class]);
+            if (!dataRows.count) {
+                return;
+            }
+
+            id summaryText = summary[kReportKeySummaryText];
+            summariesByProcessor[processor] = @{ kReportKeyDataRows : dataRows,
+                                                 kReportKeyHeaders : arrayOfClass(summary[kReportKeyHeaders], [NSString class]),
+                                                 kReportKeySummaryText : [summaryText isKindOfClass:[NSString class]] ? summaryText : @"" };
+
+            if ([processor isEqualToString:kReportProcessorURLDownloader]) {
+                for (NSDictionary *row in dataRows) {
+                    id downloadPath = row[@"download_path"];
+                    if ([downloadPath isKindOfClass:[NSString class]]) {
+                        [downloadPaths addObject:downloadPath];
+                    }
+                }
+            }
+        }];
+    }
+
+    _summariesByProcessor = [summariesByProcessor copy];
+    _processors = [summariesByProcessor.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    _downloadPaths = downloadPaths.array;
+}
+
+- (void)analyzeDetectedVersions:(id)detectedVersions
+{
+    NSArray *versions = arrayOfClass(detectedVersions, [NSDictionary class]);
+
+    NSMutableDictionary *versionsByBasename = [[NSMutableDictionary alloc] initWithCapacity:versions.count];
+    NSMutableDictionary *versionsByUnversionedName = [[NSMutableDictionary alloc] initWithCapacity:versions.count];
+    NSMutableArray *foldedPackagePaths = [[NSMutableArray alloc] initWithCapacity:versions.count];
+    NSMutableArray *packageVersions = [[NSMutableArray alloc] initWithCapacity:versions.count];
+
+    for (NSDictionary *detected in versions) {
+        id path = detected[@"pkg_path"];
+        id version = detected[@"version"];
+        if (![path isKindOfClass:[NSString class]] || !version) {
+            continue;
+        }
+
+        NSString *foldedPath = foldedString(path);
+        NSString *basename = foldedPath.lastPathComponent.stringByDeletingPathExtension;
+        versionsByBasename[basename] = version;
+        versionsByUnversionedName[unversionedName(basename)] = version;
+        [foldedPackagePaths addObject:foldedPath];
+        [packageVersions addObject:version];
+    }
+
+    _versionsByBasename = [versionsByBasename copy];
+    _versionsByUnversionedName = [versionsByUnversionedName copy];
+    _foldedPackagePaths = [foldedPackagePaths copy];
+    _packageVersions = [packageVersions copy];
+}
+
+#pragma mark - Failures
+- (NSDictionary *)failureForRecipe:(NSString *)recipe
+{
+    return recipe ? _failuresByRecipe[recipe] : nil;
+}
+
+- (BOOL)failuresContainMessage:(NSString *)message
+{
+    return message.length && containsString(_foldedFailureMessages, foldedString(message));
+}
+
+#pragma mark - Processors
+- (NSArray *)dataRowsForProcessor:(NSString *)processor
+{
+    return processor ? _summariesByProcessor[processor][kReportKeyDataRows] : nil;
+}
+
+- (NSArray *)headersForProcessor:(NSString *)processor
+{
+    return processor ? _summariesByProcessor[processor][kReportKeyHeaders] : nil;
+}
+
+- (NSString *)summaryTextForProcessor:(NSString *)processor
+{
+    return processor ? _summariesByProcessor[processor][kReportKeySummaryText] : nil;
+}
+
+#pragma mark - Downloads & Versions
+- (NSString *)versionForPackageBasename:(NSString *)basename
+{
+    if (!basename.length) {
+        return nil;
+    }
+
+    NSString *folded = foldedString(basename);
+    NSString *version = _versionsByBasename[folded] ?: _versionsByUnversionedName[folded];
+    if (version) {
+        return version;
+    }
+
+    // Downloads can be named differently than the packages built from
+    // them, e.g. Firefox.dmg and Firefox-ESR-45.0.pkg, so fall back to a search.
+    __block NSString *match = nil;
+    [_foldedPackagePaths enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(NSString *path, NSUInteger idx, BOOL *stop) {
+        if (containsString(path, folded)) {
+            match = _packageVersions[idx];
+            *stop = YES;
+        }
+    }];
+    return match;
+}
+
+@end
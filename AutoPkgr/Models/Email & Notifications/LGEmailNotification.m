@@ -85,9 +85,10 @@
 
     NSString *subject = self.report.emailSubjectString;
     NSString *message = self.report.emailMessageString;
+    NSString *textMessage = self.report.plainTextMessageString;
 
     // Send the email.
-    [self sendEmailNotification:subject message:message test:NO];
+    [self sendEmailNotification:subject message:message textMessage:textMessage test:NO];
 }
 
 - (void)sendTest:(void (^)(NSError *))complete
@@ -100,7 +101,7 @@
     NSString *message = NSLocalizedString(@"This is a test notification from <strong>AutoPkgr</strong>.", @"html test email body");
 
     // Send the email/
-    [self sendEmailNotification:subject message:message test:YES];
+    [self sendEmailNotification:subject message:message textMessage:nil test:YES];
 }
 
 #pragma mark - Credentials
@@ -144,7 +145,7 @@
 }
 
 #pragma mark - Primary sending method
-- (void)sendEmailNotification:(NSString *)subject message:(NSString *)message test:(BOOL)test
+- (void)sendEmailNotification:(NSString *)subject message:(NSString *)message textMessage:(NSString *)textMessage test:(BOOL)test
 {
     NSString *fullSubject = quick_formatString(@"%@ on %@", subject, [NSHost currentHost].localizedName);
 
@@ -167,6 +168,9 @@
         builder.header.to = [self smtpTo];
         builder.header.subject = fullSubject;
         builder.htmlBody = message;
+        if (textMessage) {
+            builder.textBody = textMessage;
+        }
 
         /* Configure the session details */
         MCOSMTPSession *session = [[MCOSMTPSession alloc] init];
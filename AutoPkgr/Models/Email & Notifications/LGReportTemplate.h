@@ -0,0 +1,89 @@
+//
+//  LGReportTemplate.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, LGReportTemplateEscaping) {
+    // Values are inserted as they are, for plain text.
+    kLGReportTemplateEscapingNone = 0,
+    // &, <, >, " and ' are replaced with HTML entities.
+    kLGReportTemplateEscapingHTML,
+    // &, < and > are replaced the way Slack's message formatting expects.
+    kLGReportTemplateEscapingSlack,
+};
+
+/*
+ * LGReportTemplate renders a report model, made of dictionaries, arrays,
+ * strings and numbers, with a subset of the Mustache syntax:
+ *
+ *   {{key.path}}            the value, escaped
+ *   {{{key.path}}}          the value, not escaped, also {{& key.path}}
+ *   {{#key}} ... {{/key}}   rendered for each item of an array, or once for any other true value
+ *   {{^key}} ... {{/key}}   rendered when the value is missing, false or empty
+ *   {{.}}                   the current item
+ *   {{! comment }}
+ *
+ * A template is parsed once, rendering appends everything to a single
+ * buffer, so the time it takes grows linearly with the size of the report.
+ */
+@interface LGReportTemplate : NSObject
+
+/**
+ *  Template with a name, e.g. report.html. Templates in the user's templates
+ *  directory are used instead of the ones that come with AutoPkgr.
+ *
+ *  @param name     file name of the template.
+ *  @param escaping how values are escaped.
+ *
+ *  @return the parsed template, kept until its file is changed, or nil if it could not be parsed.
+ */
++ (instancetype)templateNamed:(NSString *)name escaping:(LGReportTemplateEscaping)escaping;
+
+/**
+ *  Directory where users can put their own templates, ~/Library/Application Support/AutoPkgr/Templates.
+ */
++ (NSString *)userTemplatesDirectory;
+
+/**
+ *  Parse a template.
+ *
+ *  @param string   template string.
+ *  @param escaping how values are escaped.
+ *  @param error    set when the template has an unclosed tag or a mismatched section.
+ */
+- (instancetype)initWithString:(NSString *)string escaping:(LGReportTemplateEscaping)escaping error:(NSError **)error;
+
+@property (assign, nonatomic, readonly) LGReportTemplateEscaping escaping;
+
+/**
+ *  Render a model.
+ *
+ *  @param model dictionary the template's keys are looked up in.
+ */
+- (NSString *)render:(NSDictionary *)model;
+
+/**
+ *  Render a model, appending the output to a string.
+ *
+ *  @param model  dictionary the template's keys are looked up in.
+ *  @param string string to append the output to.
+ */
+- (void)render:(NSDictionary *)model toString:(NSMutableString *)string;
+
+@end
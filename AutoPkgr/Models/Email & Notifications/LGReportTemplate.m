@@ -0,0 +1,425 @@
+//
+//  LGReportTemplate.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGReportTemplate.h"
+#import "LGAutoPkgr.h"
+
+typedef NS_ENUM(NSInteger, LGReportTemplateNodeType) {
+    kLGReportTemplateNodeText,
+    kLGReportTemplateNodeValue,
+    kLGReportTemplateNodeRawValue,
+    kLGReportTemplateNodeSection,
+    kLGReportTemplateNodeInvertedSection,
+};
+
+@interface LGReportTemplateNode : NSObject
+@property (assign, nonatomic) LGReportTemplateNodeType type;
+
+// The text of a text node, otherwise the name of the tag.
+@property (copy, nonatomic) NSString *text;
+
+// Key path of the value, empty for {{.}}
+@property (copy, nonatomic) NSArray *keys;
+@property (strong, nonatomic) NSMutableArray *children;
+@end
+
+@implementation LGReportTemplateNode
+@end
+
+#pragma mark - Helpers
+static BOOL isBlank(unichar c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static NSUInteger lineNumber(NSString *string, NSUInteger location)
+{
+    NSUInteger line = 1;
+    for (NSUInteger idx = 0; idx < location && idx < string.length; idx++) {
+        if ([string characterAtIndex:idx] == '\n') {
+            line++;
+        }
+    }
+    return line;
+}
+
+static id valueForKeys(NSArray *stack, NSArray *keys)
+{
+    if (!keys.count) {
+        return stack.lastObject;
+    }
+
+    // The first key is looked up from the innermost section out,
+    // so items can use values from the sections around them.
+    id value = nil;
+    NSString *key = keys.firstObject;
+    for (NSUInteger idx = stack.count; idx > 0 && !value; idx--) {
+        id context = stack[idx - 1];
+        if ([context isKindOfClass:[NSDictionary class]]) {
+            value = context[key];
+        }
+    }
+
+    for (NSUInteger idx = 1; idx < keys.count && value; idx++) {
+        value = [value isKindOfClass:[NSDictionary class]] ? value[keys[idx]] : nil;
+    }
+    return value;
+}
+
+static BOOL isTrue(id value)
+{
+    if (!value || value == [NSNull null]) {
+        return NO;
+    }
+    if ([value isKindOfClass:[NSNumber class]]) {
+        return [value boolValue];
+    }
+    if ([value isKindOfClass:[NSString class]]) {
+        return [value length] > 0;
+    }
+    if ([value isKindOfClass:[NSArray class]]) {
+        return [value count] > 0;
+    }
+    return YES;
+}
+
+static NSString *stringValue(id value)
+{
+    if (!value || value == [NSNull null]) {
+        return nil;
+    }
+    if ([value isKindOfClass:[NSString class]]) {
+        return value;
+    }
+    if ([value isKindOfClass:[NSNumber class]]) {
+        return [value stringValue];
+    }
+    return [value description];
+}
+
+static NSString *entityForCharacter(unichar c, LGReportTemplateEscaping escaping)
+{
+    switch (c) {
+        case '&':
+            return @"&amp;";
+        case '<':
+            return @"&lt;";
+        case '>':
+            return @"&gt;";
+        case '"':
+            return escaping == kLGReportTemplateEscapingHTML ? @"&quot;" : nil;
+        case '\'':
+            return escaping == kLGReportTemplateEscapingHTML ? @"&#39;" : nil;
+        default:
+            return nil;
+    }
+}
+
+static void appendEscaped(NSMutableString *string, NSString *value, LGReportTemplateEscaping escaping)
+{
+    // Copy the characters out in chunks, and append the runs between
+    // the characters that need escaping without making substrings.
+    unichar characters[256];
+    NSUInteger length = value.length;
+
+    for (NSUInteger location = 0; location < length; location += 256) {
+        NSUInteger count = MIN(256, length - location);
+        [value getCharacters:characters range:NSMakeRange(location, count)];
+
+        NSUInteger start = 0;
+        for (NSUInteger idx = 0; idx < count; idx++) {
+            NSString *entity = entityForCharacter(characters[idx], escaping);
+            if (entity) {
+                CFStringAppendCharacters((__bridge CFMutableStringRef)string, characters + start, idx - start);
+                [string appendString:entity];
+                start = idx + 1;
+            }
+        }
+        CFStringAppendCharacters((__bridge CFMutableStringRef)string, characters + start, count - start);
+    }
+}
+
+@implementation LGReportTemplate {
+    NSArray *_nodes;
+}
+
++ (instancetype)templateNamed:(NSString *)name escaping:(LGReportTemplateEscaping)escaping
+{
+    NSString *userPath = [[self userTemplatesDirectory] stringByAppendingPathComponent:name];
+    NSString *bundlePath = [[NSBundle bundleForClass:self] pathForResource:name ofType:nil];
+
+    LGReportTemplate *template = nil;
+    if ([[NSFileManager defaultManager] fileExistsAtPath:userPath]) {
+        template = [self templateAtPath:userPath escaping:escaping];
+    }
+
+    // Fall back to the template that comes with AutoPkgr when the user's can't be used.
+    if (!template && bundlePath) {
+        template = [self templateAtPath:bundlePath escaping:escaping];
+    }
+    return template;
+}
+
++ (instancetype)templateAtPath:(NSString *)path escaping:(LGReportTemplateEscaping)escaping
+{
+    static NSMutableDictionary *templates;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        templates = [[NSMutableDictionary alloc] init];
+    });
+
+    NSDate *modified = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil].fileModificationDate ?: [NSDate distantPast];
+    NSString *key = [NSString stringWithFormat:@"%ld:%@", (long)escaping, path];
+
+    @synchronized(templates)
+    {
+        NSArray *cached = templates[key];
+        if (cached && [cached[1] isEqualToDate:modified]) {
+            return cached[0];
+        }
+    }
+
+    NSError *error;
+    NSString *string = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:&error];
+    LGReportTemplate *template = string ? [[self alloc] initWithString:string escaping:escaping error:&error] : nil;
+
+    if (!template) {
+        NSLog(@"Could not use the report template %@. %@", path, error.localizedRecoverySuggestion ?: error.localizedDescription);
+        return nil;
+    }
+
+    @synchronized(templates)
+    {
+        templates[key] = @[ template, modified ];
+    }
+    return template;
+}
+
++ (NSString *)userTemplatesDirectory
+{
+    return [[LGHostInfo getAppSupportDirectory] stringByAppendingPathComponent:@"Templates"];
+}
+
+- (instancetype)init
+{
+    return [self initWithString:@"" escaping:kLGReportTemplateEscapingNone error:nil];
+}
+
+- (instancetype)initWithString:(NSString *)string escaping:(LGReportTemplateEscaping)escaping error:(NSError *__autoreleasing *)error
+{
+    if (self = [super init]) {
+        _escaping = escaping;
+        if (![self parse:string ?: @"" error:error]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+#pragma mark - Parsing
+- (BOOL)parse:(NSString *)string error:(NSError *__autoreleasing *)error
+{
+    LGReportTemplateNode *root = [[LGReportTemplateNode alloc] init];
+    root.children = [[NSMutableArray alloc] init];
+
+    NSMutableArray *sections = [NSMutableArray arrayWithObject:root];
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+    NSUInteger length = string.length;
+    NSUInteger location = 0;
+
+    while (location < length) {
+        NSRange open = [string rangeOfString:@"{{" options:NSLiteralSearch range:NSMakeRange(location, length - location)];
+        if (open.location == NSNotFound) {
+            [self addText:[string substringFromIndex:location] toSection:sections.lastObject];
+            break;
+        }
+
+        BOOL triple = NSMaxRange(open) < length && [string characterAtIndex:NSMaxRange(open)] == '{';
+        NSUInteger contentStart = NSMaxRange(open) + (triple ? 1 : 0);
+        NSRange close = [string rangeOfString:triple ? @"}}}" : @"}}"
+                                      options:NSLiteralSearch
+                                        range:NSMakeRange(contentStart, length - contentStart)];
+
+        if (close.location == NSNotFound) {
+            return [self parseError:error reason:@"Unclosed tag" string:string location:open.location];
+        }
+
+        NSString *content = [[string substringWithRange:NSMakeRange(contentStart, close.location - contentStart)] stringByTrimmingCharactersInSet:whitespace];
+        unichar sigil = (!triple && content.length) ? [content characterAtIndex:0] : 0;
+        if (sigil == '#' || sigil == '^' || sigil == '/' || sigil == '!' || sigil == '&') {
+            content = [[content substringFromIndex:1] stringByTrimmingCharactersInSet:whitespace];
+        } else {
+            sigil = 0;
+        }
+
+        if (!content.length && sigil != '!') {
+            return [self parseError:error reason:@"Empty tag" string:string location:open.location];
+        }
+
+        NSUInteger textEnd = open.location;
+        NSUInteger tagEnd = NSMaxRange(close);
+
+        // Section tags and comments on a line by themselves take the line with
+        // them, so they don't leave blank lines in the output.
+        if (sigil == '#' || sigil == '^' || sigil == '/' || sigil == '!') {
+            NSUInteger lineStart = open.location;
+            while (lineStart > location && isBlank([string characterAtIndex:lineStart - 1])) {
+                lineStart--;
+            }
+
+            NSUInteger lineEnd = tagEnd;
+            while (lineEnd < length && isBlank([string characterAtIndex:lineEnd])) {
+                lineEnd++;
+            }
+
+            BOOL startsLine = lineStart == 0 || [string characterAtIndex:lineStart - 1] == '\n';
+            BOOL endsLine = lineEnd == length || [string characterAtIndex:lineEnd] == '\n';
+            if (startsLine && endsLine) {
+                textEnd = lineStart;
+                tagEnd = MIN(lineEnd + 1, length);
+            }
+        }
+
+        if (textEnd > location) {
+            [self addText:[string substringWithRange:NSMakeRange(location, textEnd - location)] toSection:sections.lastObject];
+        }
+
+        if (sigil == '/') {
+            LGReportTemplateNode *section = sections.lastObject;
+            if (sections.count == 1 || ![section.text isEqualToString:content]) {
+                return [self parseError:error reason:quick_formatString(@"Unexpected {{/%@}}", content) string:string location:open.location];
+            }
+            [sections removeLastObject];
+        } else if (sigil != '!') {
+            LGReportTemplateNode *node = [[LGReportTemplateNode alloc] init];
+            node.text = content;
+            node.keys = [content isEqualToString:@"."] ? @[] : [content componentsSeparatedByString:@"."];
+
+            if (sigil == '#' || sigil == '^') {
+                node.type = (sigil == '#') ? kLGReportTemplateNodeSection : kLGReportTemplateNodeInvertedSection;
+                node.children = [[NSMutableArray alloc] init];
+            } else {
+                node.type = (triple || sigil == '&') ? kLGReportTemplateNodeRawValue : kLGReportTemplateNodeValue;
+            }
+
+            [[sections.lastObject children] addObject:node];
+            if (node.children) {
+                [sections addObject:node];
+            }
+        }
+
+        location = tagEnd;
+    }
+
+    if (sections.count > 1) {
+        NSString *reason = quick_formatString(@"Unclosed section {{#%@}}", [sections.lastObject text]);
+        return [self parseError:error reason:reason string:string location:length];
+    }
+
+    _nodes = [root.children copy];
+    return YES;
+}
+
+- (void)addText:(NSString *)text toSection:(LGReportTemplateNode *)section
+{
+    LGReportTemplateNode *node = [[LGReportTemplateNode alloc] init];
+    node.type = kLGReportTemplateNodeText;
+    node.text = text;
+    [section.children addObject:node];
+}
+
+- (BOOL)parseError:(NSError *__autoreleasing *)error reason:(NSString *)reason string:(NSString *)string location:(NSUInteger)location
+{
+    if (error) {
+        NSString *suggestion = quick_formatString(@"%@ on line %lu.", reason, (unsigned long)lineNumber(string, location));
+        *error = [NSError errorWithDomain:kLGApplicationName
+                                     code:-1
+                                 userInfo:@{ NSLocalizedDescriptionKey : NSLocalizedString(@"The report template could not be read.", nil),
+                                             NSLocalizedRecoverySuggestionErrorKey : suggestion }];
+    }
+    return NO;
+}
+
+#pragma mark - Rendering
+- (NSString *)render:(NSDictionary *)model
+{
+    NSMutableString *string = [[NSMutableString alloc] init];
+    [self render:model toString:string];
+    return [string copy];
+}
+
+- (void)render:(NSDictionary *)model toString:(NSMutableString *)string
+{
+    NSMutableArray *stack = [[NSMutableArray alloc] init];
+    if (model) {
+        [stack addObject:model];
+    }
+    [self renderNodes:_nodes stack:stack toString:string];
+}
+
+- (void)renderNodes:(NSArray *)nodes stack:(NSMutableArray *)stack toString:(NSMutableString *)string
+{
+    for (LGReportTemplateNode *node in nodes) {
+        switch (node.type) {
+            case kLGReportTemplateNodeText: {
+                [string appendString:node.text];
+                break;
+            }
+            case kLGReportTemplateNodeValue:
+            case kLGReportTemplateNodeRawValue: {
+                NSString *value = stringValue(valueForKeys(stack, node.keys));
+                if (node.type == kLGReportTemplateNodeRawValue || _escaping == kLGReportTemplateEscapingNone) {
+                    [string appendString:value ?: @""];
+                } else {
+                    appendEscaped(string, value, _escaping);
+                }
+                break;
+            }
+            case kLGReportTemplateNodeSection: {
+                id value = valueForKeys(stack, node.keys);
+                if (!isTrue(value)) {
+                    break;
+                }
+
+                if ([value isKindOfClass:[NSArray class]]) {
+                    for (id item in value) {
+                        [stack addObject:item];
+                        [self renderNodes:node.children stack:stack toString:string];
+                        [stack removeLastObject];
+                    }
+                } else if ([value isKindOfClass:[NSDictionary class]]) {
+                    [stack addObject:value];
+                    [self renderNodes:node.children stack:stack toString:string];
+                    [stack removeLastObject];
+                } else {
+                    [self renderNodes:node.children stack:stack toString:string];
+                }
+                break;
+            }
+            case kLGReportTemplateNodeInvertedSection: {
+                if (!isTrue(valueForKeys(stack, node.keys))) {
+                    [self renderNodes:node.children stack:stack toString:string];
+                }
+                break;
+            }
+        }
+    }
+}
+
+@end
@@ -63,14 +63,9 @@ static NSString *const SlacksNotificationsEnabledKey = @"SlackNotificationsEnabl
         self.notificatonComplete = complete;
     }
 
-    NSMutableString *str = self.report.emailSubjectString.mutableCopy;
-    [str appendString:@":\n"];
-
-    [self.report.updatedApplications enumerateObjectsUsingBlock:^(LGUpdatedApplication *app, NSUInteger idx, BOOL *stop) {
-        [str appendFormat:@" * %@ [%@]\n", app.name, app.version]; // Format howerver
-    }];
-
-    NSDictionary *slackParameters = @{ @"text" : str };
+    // The text is shown in notifications, and in place of the blocks where they aren't supported.
+    NSDictionary *slackParameters = @{ @"text" : self.report.emailSubjectString ?: @"",
+                                       @"blocks" : self.report.slackBlocks ?: @[] };
 
     [self sendMessageWithParameters:slackParameters];
 }
@@ -0,0 +1,69 @@
+//
+//  LGNotificationDispatcher.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LGAutoPkgReport;
+
+/*
+ * LGNotificationDispatcher sends a report with several notification
+ * services at once. Each service gets a deadline for every attempt, and
+ * a service that fails is tried again a few times, waiting twice as
+ * long before each new attempt, so one slow or unreachable server
+ * can't hold up the others, or the end of a background run.
+ */
+@interface LGNotificationDispatcher : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Initialize a dispatcher.
+ *
+ *  @param report   report to send.
+ *  @param services LGNotificationService subclasses to send it with.
+ */
+- (instancetype)initWithReport:(LGAutoPkgReport *)report services:(NSArray *)services;
+
+@property (strong, nonatomic, readonly) LGAutoPkgReport *report;
+@property (copy, nonatomic, readonly) NSArray *services;
+
+/**
+ *  How long a service has to send the report before the attempt fails, defaults to 30 seconds.
+ */
+@property (assign, nonatomic) NSTimeInterval timeout;
+
+/**
+ *  Number of times a service is tried before giving up, defaults to 3.
+ */
+@property (assign, nonatomic) NSUInteger maximumAttempts;
+
+/**
+ *  How long to wait before trying a service again, doubled after every attempt, defaults to 2 seconds.
+ */
+@property (assign, nonatomic) NSTimeInterval retryDelay;
+
+/**
+ *  Send the report with every service.
+ *
+ *  @param complete called once every service is done, with the last error of each service that could not send the report keyed by its class name.
+ *  @note complete is called on a background queue.
+ */
+- (void)dispatch:(void (^)(NSDictionary *errors))complete;
+
+@end
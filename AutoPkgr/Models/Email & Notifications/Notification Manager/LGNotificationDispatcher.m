@@ -0,0 +1,143 @@
+//
+//  LGNotificationDispatcher.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGNotificationDispatcher.h"
+#import "LGNotificationService.h"
+#import "LGAutoPkgr.h"
+
+@interface LGNotificationService ()<LGNotificationServiceProtocol>
+@end
+
+static NSError *timeoutError(Class serviceClass, NSTimeInterval timeout)
+{
+    NSString *description = quick_formatString(@"%@ did not respond within %.0f seconds.", [serviceClass serviceDescription], timeout);
+    return [NSError errorWithDomain:NSURLErrorDomain
+                               code:NSURLErrorTimedOut
+                           userInfo:@{ NSLocalizedDescriptionKey : description }];
+}
+
+@implementation LGNotificationDispatcher {
+    // Completions are only tracked on _queue.
+    dispatch_queue_t _queue;
+    NSMutableDictionary *_errors;
+    NSUInteger _remainingServices;
+    void (^_complete)(NSDictionary *);
+}
+
+- (instancetype)initWithReport:(LGAutoPkgReport *)report services:(NSArray *)services
+{
+    if (self = [super init]) {
+        _report = report;
+        _services = [services copy];
+        _timeout = 30;
+        _maximumAttempts = 3;
+        _retryDelay = 2;
+        _queue = dispatch_queue_create("com.lindegroup.autopkgr.notification.dispatcher.queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dispatch:(void (^)(NSDictionary *))complete
+{
+    dispatch_async(_queue, ^{
+        _errors = [[NSMutableDictionary alloc] init];
+        _remainingServices = _services.count;
+        _complete = [complete copy];
+
+        if (_remainingServices == 0) {
+            return [self finish];
+        }
+
+        for (Class serviceClass in _services) {
+            [self send:serviceClass attempt:1];
+        }
+    });
+}
+
+- (void)send:(Class)serviceClass attempt:(NSUInteger)attempt
+{
+    // Only called on _queue.
+    // Services only report the first completion they're given,
+    // so every attempt is made with a new one.
+    LGNotificationService *service = [[serviceClass alloc] initWithReport:_report];
+
+    // Whichever comes first, the service's reply or the deadline, ends the attempt.
+    __block BOOL finished = NO;
+    void (^attemptComplete)(NSError *) = ^(NSError *error) {
+        dispatch_async(_queue, ^{
+            if (finished) {
+                return;
+            }
+            finished = YES;
+            [self service:serviceClass attempt:attempt completedWithError:error];
+        });
+    };
+
+    NSTimeInterval timeout = _timeout;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)), _queue, ^{
+        if (!finished) {
+            DLog(@"%@ timed out.", [serviceClass serviceDescription]);
+            attemptComplete(timeoutError(serviceClass, timeout));
+        }
+    });
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [service send:attemptComplete];
+    });
+}
+
+- (void)service:(Class)serviceClass attempt:(NSUInteger)attempt completedWithError:(NSError *)error
+{
+    // Only called on _queue.
+    NSString *name = NSStringFromClass(serviceClass);
+
+    if (error && attempt < _maximumAttempts) {
+        NSTimeInterval delay = _retryDelay * pow(2, attempt - 1);
+        DLog(@"%@ failed, trying again in %.1f seconds. %@", [serviceClass serviceDescription], delay, error.localizedDescription);
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+            [self send:serviceClass attempt:attempt + 1];
+        });
+        return;
+    }
+
+    if (error) {
+        _errors[name] = error;
+    }
+
+    if (--_remainingServices == 0) {
+        [self finish];
+    }
+}
+
+- (void)finish
+{
+    // Only called on _queue.
+    void (^complete)(NSDictionary *) = _complete;
+    NSDictionary *errors = [_errors copy];
+    _complete = nil;
+
+    if (complete) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            complete(errors);
+        });
+    }
+}
+
+@end
@@ -23,9 +23,12 @@
 #import "LGEmailNotification.h"
 #import "LGSlackNotification.h"
 #import "LGHipChatNotification.h"
+#import "LGNotificationDispatcher.h"
+#import "LGNotificationOutbox.h"
 
 #import "LGPasswords.h"
 #import "LGIntegrationManager.h"
+#import "LGRedactor.h"
 
 @interface LGNotificationService ()<LGNotificationServiceProtocol>
 @end
@@ -45,7 +48,7 @@ static NSArray *serviceClasses()
 }
 
 @implementation LGNotificationManager {
-    NSMutableArray *_reportedErrors;
+    NSArray *_reportedErrors;
     NSError *_runError;
 }
 
@@ -60,81 +63,101 @@ static NSArray *serviceClasses()
 
 - (void)sendEnabledNotifications:(void (^)(NSError *))complete;
 {
-    dispatch_queue_t autopkgr_notification_manager_queue;
-    autopkgr_notification_manager_queue = dispatch_queue_create("com.lindegroup.autopkgr.notification.manager.queue", DISPATCH_QUEUE_CONCURRENT);
-
-    dispatch_async(autopkgr_notification_manager_queue, ^{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
         NSMutableArray *enabledServices = [NSMutableArray
                                            arrayWithCapacity:serviceClasses().count];
 
-        __block BOOL reportsIntegrations = NO;
-        LGAutoPkgReport *report = [[LGAutoPkgReport alloc] initWithReportDictionary:self.reportDictionary];
-        report.error = _runError;
-
-        [serviceClasses() enumerateObjectsUsingBlock:^(Class noteClass, NSUInteger idx, BOOL *stop) {
+        BOOL reportsIntegrations = NO;
+        for (Class noteClass in serviceClasses()) {
             if ([noteClass isEnabled]) {
-                LGNotificationService *service = [[noteClass alloc] initWithReport:report];
-                if (enabledServices != nil) {
-                    [enabledServices addObject:service];
-                    if ([[service class] reportsIntegrations]) {
-                        reportsIntegrations = YES;
-                    }
+                [enabledServices addObject:noteClass];
+                if ([noteClass reportsIntegrations]) {
+                    reportsIntegrations = YES;
                 }
             }
-        }];
-
-        NSInteger expectedServices = enabledServices.count;
-        __block NSInteger completedCounter = 0;
+        }
 
         /* If no services are enabled, send the
          * completion message now and return */
-        if (expectedServices == 0) {
+        if (enabledServices.count == 0) {
             return complete(nil);
         }
 
-        /* If any enabled service report integrations grab them now. */
+        LGAutoPkgReport *report = [[LGAutoPkgReport alloc] initWithReportDictionary:self.reportDictionary];
+        report.error = _runError;
+
+        /* If any enabled service report integrations grab them now.
+         * Only installed integrations can have updates, and their
+         * release info comes from the GitHub release cache, so this
+         * doesn't go to the network unless the cache has expired. */
         if (reportsIntegrations) {
             LGIntegrationManager *manager = [[LGIntegrationManager alloc] init];
-            report.integrations = manager.allIntegrations;
+            report.integrations = manager.installedIntegrations;
         }
 
-        /* Now that the integrations are set if needed,
-         * check the report for anything new to report
-         * and return  if the answer is NO. */
-        if (report.updatesToReport == NO) {
-            return complete(nil);
+        LGNotificationOutbox *outbox = [LGNotificationOutbox sharedOutbox];
+        dispatch_group_t group = dispatch_group_create();
+
+        /* Check the report for anything new to report,
+         * and only send it if there is. */
+        if (report.updatesToReport) {
+            dispatch_group_enter(group);
+            LGNotificationDispatcher *dispatcher = [[LGNotificationDispatcher alloc] initWithReport:report services:enabledServices];
+            [dispatcher dispatch:^(NSDictionary *errors) {
+                if (errors.count) {
+                    NSMutableArray *reportedErrors = [NSMutableArray arrayWithCapacity:errors.count];
+                    [errors enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSError *error, BOOL *stop) {
+                        [reportedErrors addObject:@{[NSClassFromString(name) serviceDescription] : error}];
+                    }];
+                    _reportedErrors = reportedErrors;
+
+                    /* Keep what could not be delivered for the next run. */
+                    [outbox addReport:self.reportDictionary runError:_runError services:errors.allKeys];
+                }
+                dispatch_group_leave(group);
+            }];
         }
 
-        /* Setup a completion callback block to keep track
-         * of the number of enabled services vs. the number
-         * of services that are done sending a message. Once
-         * everything has checked back in from their send
-         * operation call our `complete()` block. */
-        void (^completedService)() = ^(){
-            completedCounter ++;
-            if (completedCounter >= expectedServices) {
-                NSError *error = [self processedError];
-
-                /* We're all done sending notifications
-                 * so go ahead and re-lock the keychain */
-                [LGPasswords lockKeychain];
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    complete(error);
-                });
+        /* Try again to deliver notifications from earlier runs,
+         * with the services that are still enabled. */
+        for (NSDictionary *entry in [outbox entries]) {
+            NSMutableArray *services = [[NSMutableArray alloc] init];
+            for (NSString *name in entry[kLGNotificationOutboxServicesKey]) {
+                Class noteClass = NSClassFromString(name);
+                if (noteClass && [enabledServices containsObject:noteClass]) {
+                    [services addObject:noteClass];
+                }
+            }
+
+            if (!services.count) {
+                [outbox updateEntry:entry services:nil];
+                continue;
             }
-        };
-
-        for (LGNotificationService *service in enabledServices) {
-            [service send:^(NSError *error) {
-                if (error) {
-                    if (!_reportedErrors) {
-                        _reportedErrors = [NSMutableArray arrayWithCapacity:enabledServices.count];
-                    }
-                    [_reportedErrors addObject:@{[[service class] serviceDescription] : error}];
+
+            LGAutoPkgReport *earlierReport = [[LGAutoPkgReport alloc] initWithReportDictionary:entry[kLGNotificationOutboxReportKey]];
+            earlierReport.error = [outbox runErrorOfEntry:entry];
+
+            dispatch_group_enter(group);
+            LGNotificationDispatcher *dispatcher = [[LGNotificationDispatcher alloc] initWithReport:earlierReport services:services];
+            [dispatcher dispatch:^(NSDictionary *errors) {
+                if (errors.count) {
+                    NSLog(@"Could not deliver the notification from %@. It will be sent again next run.", entry[kLGNotificationOutboxCreatedKey]);
                 }
-                completedService();
+                [outbox updateEntry:entry services:errors.allKeys];
+                dispatch_group_leave(group);
             }];
         }
+
+        /* Once every service is done sending
+         * call our `complete()` block. */
+        dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+            NSError *error = [self processedError];
+
+            /* We're all done sending notifications
+             * so go ahead and re-lock the keychain */
+            [LGPasswords lockKeychain];
+            complete(error);
+        });
     });
 }
 
@@ -153,7 +176,7 @@ static NSArray *serviceClasses()
         }];
 
         NSDictionary *userInfo = @{ NSLocalizedDescriptionKey : NSLocalizedString(@"An error occurred while sending notifications.", nil),
-                                    NSLocalizedRecoverySuggestionErrorKey : errorDescription };
+                                    NSLocalizedRecoverySuggestionErrorKey : LGRedactedString(errorDescription) };
 
         error = [NSError errorWithDomain:kLGApplicationName code:1 userInfo:userInfo];
     }
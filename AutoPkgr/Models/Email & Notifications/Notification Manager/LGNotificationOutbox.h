@@ -0,0 +1,89 @@
+//
+//  LGNotificationOutbox.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+// Entry keys.
+extern NSString *const kLGNotificationOutboxReportKey;
+extern NSString *const kLGNotificationOutboxServicesKey;
+extern NSString *const kLGNotificationOutboxCreatedKey;
+
+/*
+ * LGNotificationOutbox keeps notifications that could not be delivered,
+ * so they can be sent again on the next run. Each entry is a plist in
+ * the outbox directory with the run's report, its error, and the
+ * services that still need to send it. Credentials are masked before
+ * anything is written.
+ */
+@interface LGNotificationOutbox : NSObject
+
+/**
+ *  Outbox in the Outbox directory in Application Support.
+ */
++ (instancetype)sharedOutbox;
+
+/**
+ *  Initialize an outbox.
+ *
+ *  @param directory directory the entries are kept in, it's created when the first one is added.
+ */
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+@property (copy, nonatomic, readonly) NSString *directory;
+
+/**
+ *  How long undelivered notifications are kept, defaults to 7 days.
+ */
+@property (assign, nonatomic) NSTimeInterval maximumAge;
+
+/**
+ *  Maximum number of entries, the oldest are removed past it, defaults to 20.
+ */
+@property (assign, nonatomic) NSUInteger maximumEntries;
+
+/**
+ *  Keep a notification that could not be delivered.
+ *
+ *  @param report   --report-plist dictionary of the run.
+ *  @param runError error of the run, if any.
+ *  @param services names of the notification service classes that could not send it.
+ *
+ *  @return the entry, or nil if it could not be written.
+ */
+- (NSDictionary *)addReport:(NSDictionary *)report runError:(NSError *)runError services:(NSArray *)services;
+
+/**
+ *  Entries still waiting to be delivered, oldest first. Expired entries are removed.
+ */
+- (NSArray *)entries;
+
+/**
+ *  The error of the run an entry was kept for.
+ */
+- (NSError *)runErrorOfEntry:(NSDictionary *)entry;
+
+/**
+ *  Update the services that still need to send an entry, the entry is removed when there are none left.
+ *
+ *  @param entry    entry from -entries.
+ *  @param services names of the notification service classes that still could not send it.
+ */
+- (void)updateEntry:(NSDictionary *)entry services:(NSArray *)services;
+
+@end
@@ -0,0 +1,184 @@
+//
+//  LGNotificationOutbox.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGNotificationOutbox.h"
+#import "LGAutoPkgr.h"
+#import "LGRedactor.h"
+
+NSString *const kLGNotificationOutboxReportKey = @"report";
+NSString *const kLGNotificationOutboxServicesKey = @"services";
+NSString *const kLGNotificationOutboxCreatedKey = @"created";
+
+static NSString *const kLGNotificationOutboxErrorKey = @"run_error";
+static NSString *const kLGNotificationOutboxFileKey = @"file";
+
+static BOOL writeEntry(NSDictionary *entry, NSString *file)
+{
+    // Binary plists keep the fractional seconds of the dates,
+    // so entries added within the same second stay in order.
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:entry
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:nil];
+    return [data writeToFile:file atomically:YES];
+}
+
+@implementation LGNotificationOutbox
+
++ (instancetype)sharedOutbox
+{
+    static LGNotificationOutbox *sharedOutbox;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedOutbox = [[self alloc] init];
+    });
+    return sharedOutbox;
+}
+
+- (instancetype)init
+{
+    return [self initWithDirectory:[[LGHostInfo getAppSupportDirectory] stringByAppendingPathComponent:@"Outbox"]];
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+    if (self = [super init]) {
+        _directory = [directory copy];
+        _maximumAge = 7 * 24 * 60 * 60;
+        _maximumEntries = 20;
+    }
+    return self;
+}
+
+#pragma mark - Entries
+- (NSDictionary *)addReport:(NSDictionary *)report runError:(NSError *)runError services:(NSArray *)services
+{
+    if (!services.count) {
+        return nil;
+    }
+
+    NSMutableDictionary *entry = [[NSMutableDictionary alloc] init];
+    entry[kLGNotificationOutboxReportKey] = [[LGRedactor sharedRedactor] redactObject:report ?: @{}];
+    entry[kLGNotificationOutboxServicesKey] = [services copy];
+    entry[kLGNotificationOutboxCreatedKey] = [NSDate date];
+
+    if (runError) {
+        entry[kLGNotificationOutboxErrorKey] = @{ @"domain" : runError.domain,
+                                                  @"code" : @(runError.code),
+                                                  NSLocalizedDescriptionKey : LGRedactedString(runError.localizedDescription) ?: @"",
+                                                  NSLocalizedRecoverySuggestionErrorKey : LGRedactedString(runError.localizedRecoverySuggestion) ?: @"" };
+    }
+
+    NSString *file = [_directory stringByAppendingPathComponent:[[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:@"plist"]];
+
+    @synchronized(self)
+    {
+        NSFileManager *manager = [NSFileManager defaultManager];
+        if (![manager createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil] ||
+            !writeEntry(entry, file)) {
+            NSLog(@"Could not keep the undelivered notification in %@.", _directory);
+            return nil;
+        }
+
+        NSArray *entries = [self entries];
+        if (entries.count > _maximumEntries) {
+            for (NSDictionary *oldEntry in [entries subarrayWithRange:NSMakeRange(0, entries.count - _maximumEntries)]) {
+                [manager removeItemAtPath:oldEntry[kLGNotificationOutboxFileKey] error:nil];
+            }
+        }
+    }
+
+    entry[kLGNotificationOutboxFileKey] = file;
+    return [entry copy];
+}
+
+- (NSArray *)entries
+{
+    NSMutableArray *entries = [[NSMutableArray alloc] init];
+
+    @synchronized(self)
+    {
+        NSFileManager *manager = [NSFileManager defaultManager];
+        NSDate *expired = [NSDate dateWithTimeIntervalSinceNow:-_maximumAge];
+
+        for (NSString *name in [manager contentsOfDirectoryAtPath:_directory error:nil]) {
+            if (![name.pathExtension isEqualToString:@"plist"]) {
+                continue;
+            }
+
+            NSString *file = [_directory stringByAppendingPathComponent:name];
+            NSMutableDictionary *entry = [[NSDictionary dictionaryWithContentsOfFile:file] mutableCopy];
+            NSDate *created = entry[kLGNotificationOutboxCreatedKey];
+
+            if (![created isKindOfClass:[NSDate class]] || [created compare:expired] == NSOrderedAscending ||
+                ![entry[kLGNotificationOutboxServicesKey] count]) {
+                [manager removeItemAtPath:file error:nil];
+                continue;
+            }
+
+            entry[kLGNotificationOutboxFileKey] = file;
+            [entries addObject:[entry copy]];
+        }
+    }
+
+    [entries sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:kLGNotificationOutboxCreatedKey ascending:YES] ]];
+    return [entries copy];
+}
+
+- (NSError *)runErrorOfEntry:(NSDictionary *)entry
+{
+    NSDictionary *runError = entry[kLGNotificationOutboxErrorKey];
+    if (![runError isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+
+    NSMutableDictionary *userInfo = [[NSMutableDictionary alloc] init];
+    for (NSString *key in @[ NSLocalizedDescriptionKey, NSLocalizedRecoverySuggestionErrorKey ]) {
+        if ([runError[key] length]) {
+            userInfo[key] = runError[key];
+        }
+    }
+
+    return [NSError errorWithDomain:runError[@"domain"] ?: kLGApplicationName
+                               code:[runError[@"code"] integerValue]
+                           userInfo:userInfo];
+}
+
+- (void)updateEntry:(NSDictionary *)entry services:(NSArray *)services
+{
+    NSString *file = entry[kLGNotificationOutboxFileKey];
+    if (!file) {
+        return;
+    }
+
+    @synchronized(self)
+    {
+        if (!services.count) {
+            [[NSFileManager defaultManager] removeItemAtPath:file error:nil];
+            return;
+        }
+
+        NSMutableDictionary *updatedEntry = [entry mutableCopy];
+        [updatedEntry removeObjectForKey:kLGNotificationOutboxFileKey];
+        updatedEntry[kLGNotificationOutboxServicesKey] = [services copy];
+        writeEntry(updatedEntry, file);
+    }
+}
+
+@end
@@ -19,6 +19,7 @@
 
 #import "LGPackageRemover.h"
 #import "LGConstants.h"
+#import "LGProgressChannel.h"
 
 #import "NSData+taskData.h"
 #import <syslog.h>
@@ -119,6 +120,9 @@ static dispatch_queue_t autopkgr_pkg_remover_queue()
         }
     }
 
+    // Removing a package can touch thousands of files, only show the latest one a few times a second.
+    LGProgressChannel *progressChannel = [LGProgressChannel channelWithHandler:progress];
+
     dispatch_async(autopkgr_pkg_remover_queue(), ^{
         NSMutableArray *files = [[NSMutableArray alloc] init];
         NSArray *valideIdentifiers = [[self bomForIdentifiers:validIdentifiers error:&error] array];
@@ -173,9 +177,7 @@ static dispatch_queue_t autopkgr_pkg_remover_queue()
                 [removed addObject:path];
             }
 
-            dispatch_async(dispatch_get_main_queue(), ^{
-                progress(progressMessage, p);
-            });
+            [progressChannel sendMessage:progressMessage progress:p];
         }
 
 
@@ -184,6 +186,7 @@ static dispatch_queue_t autopkgr_pkg_remover_queue()
         }
 
         dispatch_async(dispatch_get_main_queue(), ^{
+            [progressChannel flush];
             reply(removed, remain, error);
         });
     });
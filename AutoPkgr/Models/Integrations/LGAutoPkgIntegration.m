@@ -68,6 +68,14 @@
 }
 
 #pragma mark - Instance overrides
+- (void)customInstallActions:(void (^)(NSError *))reply
+{
+    // Probe the new release now, so the status refresh that follows the install finds it cached.
+    [LGAutoPkgTask refreshVersionInBackground:^(NSString *version) {
+        reply(nil);
+    }];
+}
+
 - (NSString *)installedVersion
 {
     return [LGAutoPkgTask version];
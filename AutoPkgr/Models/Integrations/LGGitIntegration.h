@@ -31,4 +31,34 @@ typedef NS_ENUM(NSInteger, kLGGitErrorCodes) {
                     repoPath:(NSString *)repoPath
                        reply:(void (^)(NSString *, NSError *))reply;
 
+/**
+ *  Read the SHA1 a local branch points to straight from the repo's .git directory, without spawning git.
+ *
+ *  @param branch   name of the branch.
+ *  @param repoPath path to the working copy.
+ *
+ *  @return SHA1 of the branch's head, or nil if it could not be found.
+ */
++ (NSString *)localSHA1ForBranch:(NSString *)branch repoPath:(NSString *)repoPath;
+
+/**
+ *  Read the SHA1 of the commit checked out in a repo straight from its .git directory, without spawning git.
+ *
+ *  @param repoPath path to the working copy.
+ *
+ *  @return SHA1 of HEAD, or nil if it could not be resolved.
+ */
++ (NSString *)localHeadSHA1OfRepoPath:(NSString *)repoPath;
+
+/**
+ *  Query a remote for the SHA1 of a branch using git ls-remote.
+ *  @note This blocks until git exits, don't call it on the main thread.
+ *
+ *  @param branch name of the branch.
+ *  @param remote URL of the remote repository.
+ *
+ *  @return SHA1 of the remote branch's head, or nil if the remote could not be reached.
+ */
++ (NSString *)remoteSHA1ForBranch:(NSString *)branch remote:(NSString *)remote;
+
 @end
@@ -22,6 +22,8 @@
 #import "LGDefaults.h"
 
 #import "NSData+taskData.h"
+#import "NSString+cleaned.h"
+#import "NSString+split.h"
 
 #import <AHProxySettings/NSTask+useSystemProxies.h>
 
@@ -180,6 +182,7 @@ static NSArray *knownGitPaths()
     NSString *binary = [self binary];
     if (access(binary.UTF8String, X_OK) != 0) {
         reply(nil, [self gitErrorWithMessage:@"Could not locate the git binary, or it was not executable" code:kLGGitErrorNotInstalled]);
+        return;
     }
 
     __block NSMutableData *outData = [[NSMutableData alloc] init];
@@ -245,6 +248,106 @@ static NSArray *knownGitPaths()
     [task launch];
 }
 
+/* The git directory of a working copy. In a linked work tree .git is
+ * a file pointing to the actual git directory. */
+static NSString *gitDirectoryOfRepo(NSString *repoPath)
+{
+    NSString *gitDir = [repoPath stringByAppendingPathComponent:@".git"];
+
+    BOOL isDir;
+    if (![[NSFileManager defaultManager] fileExistsAtPath:gitDir isDirectory:&isDir]) {
+        return nil;
+    } else if (!isDir) {
+        NSString *gitFile = [NSString stringWithContentsOfFile:gitDir encoding:NSUTF8StringEncoding error:nil].trimmed;
+        if (![gitFile hasPrefix:@"gitdir: "]) {
+            return nil;
+        }
+        gitDir = [gitFile substringFromIndex:@"gitdir: ".length];
+        if (!gitDir.isAbsolutePath) {
+            gitDir = [repoPath stringByAppendingPathComponent:gitDir];
+        }
+    }
+    return gitDir;
+}
+
+static NSString *SHA1OfRef(NSString *gitDir, NSString *ref)
+{
+    NSString *looseRef = [NSString stringWithContentsOfFile:[gitDir stringByAppendingPathComponent:ref] encoding:NSUTF8StringEncoding error:nil].trimmed;
+    if (looseRef.length == 40) {
+        return looseRef;
+    }
+
+    // Once git gc has run, the ref may only be listed in packed-refs.
+    NSString *packedRefs = [NSString stringWithContentsOfFile:[gitDir stringByAppendingPathComponent:@"packed-refs"] encoding:NSUTF8StringEncoding error:nil];
+    for (NSString *line in packedRefs.split_byLine) {
+        // Skip the header and peeled tag lines.
+        if ([line hasPrefix:@"#"] || [line hasPrefix:@"^"]) {
+            continue;
+        }
+
+        NSArray *components = line.split_bySpace;
+        if (components.count == 2 && [components[1] isEqualToString:ref] && [components[0] length] == 40) {
+            return components[0];
+        }
+    }
+    return nil;
+}
+
++ (NSString *)localSHA1ForBranch:(NSString *)branch repoPath:(NSString *)repoPath
+{
+    if (!branch.length || !repoPath.length) {
+        return nil;
+    }
+
+    NSString *gitDir = gitDirectoryOfRepo(repoPath);
+    return gitDir ? SHA1OfRef(gitDir, [@"refs/heads" stringByAppendingPathComponent:branch]) : nil;
+}
+
++ (NSString *)localHeadSHA1OfRepoPath:(NSString *)repoPath
+{
+    NSString *gitDir = repoPath.length ? gitDirectoryOfRepo(repoPath) : nil;
+    if (!gitDir) {
+        return nil;
+    }
+
+    NSString *head = [NSString stringWithContentsOfFile:[gitDir stringByAppendingPathComponent:@"HEAD"] encoding:NSUTF8StringEncoding error:nil].trimmed;
+    if ([head hasPrefix:@"ref: "]) {
+        return SHA1OfRef(gitDir, [head substringFromIndex:@"ref: ".length]);
+    }
+
+    // A detached HEAD holds the SHA1 itself.
+    return (head.length == 40) ? head : nil;
+}
+
++ (NSString *)remoteSHA1ForBranch:(NSString *)branch remote:(NSString *)remote
+{
+    NSString *binary = [self binary];
+    if (!branch.length || !remote.length || access(binary.UTF8String, X_OK) != 0) {
+        return nil;
+    }
+
+    NSTask *task = [[NSTask alloc] init];
+    task.launchPath = binary;
+    task.arguments = @[ @"ls-remote", @"--heads", remote, [@"refs/heads" stringByAppendingPathComponent:branch] ];
+    task.standardOutput = [NSPipe pipe];
+    task.standardError = [NSFileHandle fileHandleWithNullDevice];
+
+    NSURL *remoteURL = [NSURL URLWithString:remote];
+    [task useSystemProxiesForDestination:remoteURL.host ?: @"github.com"];
+
+    [task launch];
+    // ls-remote for a single head is a line, so it can't fill the pipe's buffer.
+    NSData *outData = [[task.standardOutput fileHandleForReading] readDataToEndOfFile];
+    [task waitUntilExit];
+
+    if (task.terminationStatus != 0) {
+        return nil;
+    }
+
+    NSString *remoteSHA1 = outData.taskData_string.split_bySpace.firstObject;
+    return (remoteSHA1.length == 40) ? remoteSHA1 : nil;
+}
+
 + (NSError *)gitErrorWithMessage:(NSString *)message code:(NSInteger)code {
     NSError *error = nil;
     if (code != 0) {
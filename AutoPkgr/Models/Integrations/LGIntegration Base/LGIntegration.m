@@ -26,6 +26,7 @@
 #import "LGUninstaller.h"
 #import "LGAutoPkgTask.h"
 #import "LGHostInfo.h"
+#import "LGProgressChannel.h"
 
 #ifndef LGINTEGRATION_SUBCLASS
 #define LGINTEGRATION_SUBCLASS
@@ -72,7 +73,7 @@ void subclassMustConformToProtocol(id className)
 }
 
 @implementation LGIntegration {
-    void (^_progressUpdateBlock)(NSString *, double);
+    LGProgressChannel *_progressChannel;
     void (^_replyErrorBlock)(NSError *);
     NSMutableDictionary *_infoUpdateBlocksDict;
     id<LGProgressDelegate> _origProgressDelegate;
@@ -129,7 +130,7 @@ void subclassMustConformToProtocol(id className)
     //    DevLog(@"Dealloc %@", self);
 
     // nil out the blocks to break retain cycles.
-    _progressUpdateBlock = nil;
+    _progressChannel = nil;
     _replyErrorBlock = nil;
 
     /* Repoint so we don't loose reference to the _infoUpdateBlockDict after dealloc */
@@ -415,7 +416,7 @@ void subclassMustConformToProtocol(id className)
         if (_progressDelegate) {
             _origProgressDelegate = _progressDelegate;
         }
-        _progressUpdateBlock = progress;
+        _progressChannel = [LGProgressChannel channelWithHandler:progress];
         _progressDelegate = self;
     }
 
@@ -515,7 +516,7 @@ void subclassMustConformToProtocol(id className)
         if (_progressDelegate) {
             _origProgressDelegate = _progressDelegate;
         }
-        _progressUpdateBlock = progress;
+        _progressChannel = [LGProgressChannel channelWithHandler:progress];
         _progressDelegate = self;
     }
 
@@ -597,6 +598,7 @@ void subclassMustConformToProtocol(id className)
 {
     if (_replyErrorBlock) {
         [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+          [_progressChannel flush];
           _replyErrorBlock(error);
         }];
     }
@@ -604,11 +606,7 @@ void subclassMustConformToProtocol(id className)
 
 - (void)updateProgress:(NSString *)message progress:(double)progress
 {
-    if (_progressUpdateBlock) {
-        [[NSOperationQueue mainQueue] addOperationWithBlock:^{
-          _progressUpdateBlock(message, progress);
-        }];
-    }
+    [_progressChannel sendMessage:message progress:progress];
 }
 
 - (void)startProgressWithMessage:(NSString *)message { /* Not implemented */}
@@ -0,0 +1,114 @@
+#!/usr/bin/python
+
+'''
+    Persistent autopkg worker used by AutoPkgr.
+
+    autopkg is loaded once, then each line read on stdin is a
+    JSON request:
+
+        {"arguments": ["repo-list"], "environment": {...}}
+
+    and each request gets a single line JSON response on stdout:
+
+        {"exit_code": 0, "stdout": "...", "stderr": "..."}
+
+    "environment" is optional, when present it replaces the
+    environment for the duration of the request.
+
+    usage: autopkg_worker.py /usr/local/bin/autopkg
+'''
+
+import imp
+import json
+import os
+import sys
+import traceback
+
+from StringIO import StringIO
+
+
+def decoded(string):
+    if isinstance(string, unicode):
+        return string
+    return string.decode('utf-8', 'replace')
+
+
+def load_autopkg(path):
+    # autopkg expects autopkglib next to it on sys.path.
+    sys.path.insert(0, os.path.dirname(os.path.realpath(path)))
+    return imp.load_source('autopkg', path)
+
+
+def run(autopkg, request):
+    arguments = [str(arg) for arg in request.get('arguments', [])]
+    environment = request.get('environment')
+
+    saved_environment = dict(os.environ)
+    saved_streams = sys.stdin, sys.stdout, sys.stderr
+
+    stdout = StringIO()
+    stderr = StringIO()
+    exit_code = 0
+
+    if environment:
+        os.environ.clear()
+        os.environ.update(environment)
+
+    # An empty stdin makes any prompt fail rather than read the next request.
+    sys.stdin, sys.stdout, sys.stderr = StringIO(), stdout, stderr
+    try:
+        exit_code = autopkg.main([autopkg.__file__] + arguments) or 0
+    except SystemExit as err:
+        if err.code is None:
+            exit_code = 0
+        elif isinstance(err.code, int):
+            exit_code = err.code
+        else:
+            stderr.write(str(err.code))
+            exit_code = 1
+    except Exception:
+        traceback.print_exc(file=stderr)
+        exit_code = 1
+    finally:
+        sys.stdin, sys.stdout, sys.stderr = saved_streams
+        if environment:
+            os.environ.clear()
+            os.environ.update(saved_environment)
+
+    return exit_code, stdout.getvalue(), stderr.getvalue()
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write('usage: %s /path/to/autopkg\n' % sys.argv[0])
+        return 1
+
+    # Responses go to the original stdout, anything autopkg
+    # prints is captured per request.
+    responses = os.fdopen(os.dup(sys.stdout.fileno()), 'w')
+    autopkg = load_autopkg(sys.argv[1])
+
+    while True:
+        line = sys.stdin.readline()
+        if not line:
+            break
+
+        line = line.strip()
+        if not line:
+            continue
+
+        try:
+            exit_code, stdout, stderr = run(autopkg, json.loads(line))
+        except ValueError as err:
+            exit_code, stdout, stderr = 1, '', 'Invalid request: %s' % err
+
+        responses.write(json.dumps({'exit_code': exit_code,
+                                    'stdout': decoded(stdout),
+                                    'stderr': decoded(stderr)}) + '\n')
+        responses.flush()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
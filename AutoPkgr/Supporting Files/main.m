@@ -25,16 +25,52 @@
 #import "LGAutoPkgr.h"
 #import "LGAutoPkgrHelperConnection.h"
 
+// Recipe identifiers passed as either an array, -enableRecipes '(a, b)', or a comma separated string.
+static NSArray *recipeIdentifiersArgument(NSUserDefaults *args, NSString *key)
+{
+    id value = [args objectForKey:key];
+    if ([value isKindOfClass:[NSString class]]) {
+        value = [value componentsSeparatedByString:@","];
+    }
+
+    if (![value isKindOfClass:[NSArray class]]) {
+        return nil;
+    }
+
+    NSMutableArray *identifiers = [[NSMutableArray alloc] init];
+    for (id identifier in value) {
+        if ([identifier isKindOfClass:[NSString class]] && [identifier trimmed].length) {
+            [identifiers addObject:[identifier trimmed]];
+        }
+    }
+    return [identifiers copy];
+}
+
 int main(int argc, const char *argv[])
 {
     NSUserDefaults *args = [NSUserDefaults standardUserDefaults];
 
-    if ([args boolForKey:@"runInBackground"]) {
+    NSArray *enableRecipes = recipeIdentifiersArgument(args, @"enableRecipes");
+    NSArray *disableRecipes = recipeIdentifiersArgument(args, @"disableRecipes");
+
+    if (enableRecipes.count || disableRecipes.count) {
+        NSLog(@"Enabling %lu and disabling %lu recipes...", (unsigned long)enableRecipes.count, (unsigned long)disableRecipes.count);
+
+        if (![LGAutoPkgRecipe enableRecipes:enableRecipes disableRecipes:disableRecipes]) {
+            NSLog(@"Could not update %@.", [LGAutoPkgRecipe defaultRecipeList]);
+            return 1;
+        }
+        return 0;
+
+    } else if ([args boolForKey:@"runInBackground"]) {
         NSLog(@"Running AutoPkgr in background...");
 
         __block BOOL completionMessageSent = NO;
         BOOL update = [args boolForKey:kLGCheckForRepoUpdatesAutomaticallyEnabled];
 
+        // Keep the results of a previous run that didn't get to finish.
+        [LGAutoPkgTaskManager recoverInterruptedRuns];
+
         LGAutoPkgTaskManager *manager = [[LGAutoPkgTaskManager alloc] init];
 
         LGAutoPkgrHelperConnection *helper = [LGAutoPkgrHelperConnection new];
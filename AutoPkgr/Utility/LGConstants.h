@@ -67,6 +67,9 @@ extern NSString *const kLGNotificationRunAutoPkgComplete;
 extern NSString *const kLGNotificationUpdateReposComplete;
 extern NSString *const kLGNotificationOverrideFileCreated;
 extern NSString *const kLGNotificationReposModified;
+extern NSString *const kLGNotificationRecipeListChanged;
+extern NSString *const kLGNotificationRecipeTimingsChanged;
+extern NSString *const kLGNotificationRecipeIndexRefreshed;
 
 #pragma mark-- Email
 extern NSString *const kLGNotificationEmailSent;
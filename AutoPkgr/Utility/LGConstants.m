@@ -71,6 +71,9 @@ NSString *const kLGNotificationRunAutoPkgComplete = @"com.lindegroup.autopkgr.no
 NSString *const kLGNotificationUpdateReposComplete = @"com.lindegroup.autopkgr.notification.updaterepos.complete";
 NSString *const kLGNotificationOverrideFileCreated = @"com.lindegroup.autopkgr.notification.override.file.addorremoved";
 NSString *const kLGNotificationReposModified = @"com.lindegroup.autopkgr.notification.repos.modified";
+NSString *const kLGNotificationRecipeListChanged = @"com.lindegroup.autopkgr.notification.recipelist.changed";
+NSString *const kLGNotificationRecipeTimingsChanged = @"com.lindegroup.autopkgr.notification.recipetimings.changed";
+NSString *const kLGNotificationRecipeIndexRefreshed = @"com.lindegroup.autopkgr.notification.recipeindex.refreshed";
 
 #pragma mark-- Email
 NSString *const kLGNotificationEmailSent = @"com.lindegroup.autopkgr.email.sent.notification";
@@ -79,6 +79,47 @@ typedef NS_OPTIONS(NSInteger, LGReportItems) {
 @property (copy, nonatomic, readonly) NSArray *autoPkgRecipeSearchDirs;
 @property (copy, nonatomic, readonly) NSDictionary *autoPkgRecipeRepos;
 
+#pragma mark - AutoPkgr Run Settings
+/**
+ *  Split the recipe list into shards and run them concurrently.
+ */
+@property (nonatomic) BOOL shardedAutoPkgRunEnabled;
+
+/**
+ *  Number of shards to use for a sharded run. Defaults to the number of active processor cores.
+ */
+@property (nonatomic) NSInteger autoPkgRunShardCount;
+
+/**
+ *  Update repos with a git pull of each repo side by side, instead of autopkg repo-update all.
+ */
+@property (nonatomic) BOOL parallelRepoUpdateEnabled;
+
+/**
+ *  Number of repos to pull at once during a parallel repo update. Defaults to 4.
+ */
+@property (nonatomic) NSInteger repoUpdateConcurrency;
+
+/**
+ *  Only run recipes whose repo commit, override or upstream download changed, or that haven't been checked for a while.
+ */
+@property (nonatomic) BOOL incrementalAutoPkgRunEnabled;
+
+/**
+ *  Number of seconds an unchanged recipe can go without being run during an incremental run. Defaults to 3 days.
+ */
+@property (nonatomic) NSTimeInterval incrementalAutoPkgRunFreshnessInterval;
+
+/**
+ *  Serve list-recipes, repo-list, search and the other read only verbs from a persistent autopkg worker process.
+ */
+@property (nonatomic) BOOL persistentAutoPkgWorkerEnabled;
+
+/**
+ *  Number of seconds GitHub release info of the integrations is used before it's checked again. Defaults to 6 hours.
+ */
+@property (nonatomic) NSTimeInterval integrationReleaseInfoLifespan;
+
 #pragma mark - Utility Settings
 @property (nonatomic) BOOL debug;
 
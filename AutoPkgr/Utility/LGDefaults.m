@@ -291,6 +291,91 @@
 {
     [self setAutoPkgDomainObject:gitPath forKey:@"GIT_PATH"];
 }
+#pragma mark - AutoPkgr Run Settings
+- (BOOL)shardedAutoPkgRunEnabled
+{
+    return [self boolForKey:NSStringFromSelector(@selector(shardedAutoPkgRunEnabled))];
+}
+
+- (void)setShardedAutoPkgRunEnabled:(BOOL)shardedAutoPkgRunEnabled
+{
+    [self setBool:shardedAutoPkgRunEnabled forKey:NSStringFromSelector(@selector(shardedAutoPkgRunEnabled))];
+}
+#pragma mark
+- (NSInteger)autoPkgRunShardCount
+{
+    NSInteger count = [self integerForKey:NSStringFromSelector(@selector(autoPkgRunShardCount))];
+    return (count > 0) ? count : [[NSProcessInfo processInfo] activeProcessorCount];
+}
+
+- (void)setAutoPkgRunShardCount:(NSInteger)autoPkgRunShardCount
+{
+    [self setInteger:autoPkgRunShardCount forKey:NSStringFromSelector(@selector(autoPkgRunShardCount))];
+}
+#pragma mark
+- (BOOL)parallelRepoUpdateEnabled
+{
+    return [self boolForKey:NSStringFromSelector(@selector(parallelRepoUpdateEnabled))];
+}
+
+- (void)setParallelRepoUpdateEnabled:(BOOL)parallelRepoUpdateEnabled
+{
+    [self setBool:parallelRepoUpdateEnabled forKey:NSStringFromSelector(@selector(parallelRepoUpdateEnabled))];
+}
+#pragma mark
+- (NSInteger)repoUpdateConcurrency
+{
+    NSInteger count = [self integerForKey:NSStringFromSelector(@selector(repoUpdateConcurrency))];
+    return (count > 0) ? count : 4;
+}
+
+- (void)setRepoUpdateConcurrency:(NSInteger)repoUpdateConcurrency
+{
+    [self setInteger:repoUpdateConcurrency forKey:NSStringFromSelector(@selector(repoUpdateConcurrency))];
+}
+#pragma mark
+- (BOOL)incrementalAutoPkgRunEnabled
+{
+    return [self boolForKey:NSStringFromSelector(@selector(incrementalAutoPkgRunEnabled))];
+}
+
+- (void)setIncrementalAutoPkgRunEnabled:(BOOL)incrementalAutoPkgRunEnabled
+{
+    [self setBool:incrementalAutoPkgRunEnabled forKey:NSStringFromSelector(@selector(incrementalAutoPkgRunEnabled))];
+}
+#pragma mark
+- (NSTimeInterval)incrementalAutoPkgRunFreshnessInterval
+{
+    NSTimeInterval interval = [self doubleForKey:NSStringFromSelector(@selector(incrementalAutoPkgRunFreshnessInterval))];
+    return (interval > 0) ? interval : 3 * 24 * 60 * 60;
+}
+
+- (void)setIncrementalAutoPkgRunFreshnessInterval:(NSTimeInterval)incrementalAutoPkgRunFreshnessInterval
+{
+    [self setDouble:incrementalAutoPkgRunFreshnessInterval forKey:NSStringFromSelector(@selector(incrementalAutoPkgRunFreshnessInterval))];
+}
+#pragma mark
+- (BOOL)persistentAutoPkgWorkerEnabled
+{
+    return [self boolForKey:NSStringFromSelector(@selector(persistentAutoPkgWorkerEnabled))];
+}
+
+- (void)setPersistentAutoPkgWorkerEnabled:(BOOL)persistentAutoPkgWorkerEnabled
+{
+    [self setBool:persistentAutoPkgWorkerEnabled forKey:NSStringFromSelector(@selector(persistentAutoPkgWorkerEnabled))];
+}
+#pragma mark
+- (NSTimeInterval)integrationReleaseInfoLifespan
+{
+    NSTimeInterval lifespan = [self doubleForKey:NSStringFromSelector(@selector(integrationReleaseInfoLifespan))];
+    return (lifespan > 0) ? lifespan : 6 * 60 * 60;
+}
+
+- (void)setIntegrationReleaseInfoLifespan:(NSTimeInterval)integrationReleaseInfoLifespan
+{
+    [self setDouble:integrationReleaseInfoLifespan forKey:NSStringFromSelector(@selector(integrationReleaseInfoLifespan))];
+}
+
 #pragma mark - Utility Settings
 - (BOOL)debug
 {
@@ -21,8 +21,7 @@
 #import "LGGitHubJSONLoader.h"
 #import "LGConstants.h"
 #import "LGAutoPkgr.h"
-
-#import <AFNetworking/AFNetworking.h>
+#import "LGGitHubReleaseCache.h"
 
 @interface LGGitHubReleaseInfo ()
 @property (copy, nonatomic) NSString *repoURL;
@@ -33,6 +32,8 @@
 @property (copy, nonatomic, readwrite) NSString *latestVersion;
 @property (copy, nonatomic, readwrite) NSString *latestReleaseDownload;
 @property (copy, nonatomic, readwrite) NSArray *latestReleaseDownloads;
+
+- (instancetype)initWithJSON:(NSArray *)json retrieved:(NSDate *)retrieved;
 @end
 
 @implementation LGGitHubReleaseInfo {
@@ -47,7 +48,7 @@
 - (instancetype)init_
 {
     if (self = [super init]) {
-        _lifespan = 600;
+        _lifespan = [LGGitHubReleaseCache sharedCache].lifespan;
     }
     return self;
 }
@@ -60,11 +61,11 @@
     return self;
 }
 
-- (instancetype)initWithJSON:(NSArray *)json
+- (instancetype)initWithJSON:(NSArray *)json retrieved:(NSDate *)retrieved
 {
     if (self = [self init_]) {
         _jsonObject = json;
-        _infoRetrievedDate = [NSDate date];
+        _infoRetrievedDate = retrieved ?: [NSDate date];
     }
     return self;
 }
@@ -78,9 +79,11 @@
 - (NSArray *)jsonObject
 {
     if (!_jsonObject && _repoURL) {
-        // this is a backup synchronous method to pull the information.
-        _jsonObject = [LGGitHubJSONLoader getJSONFromURL:_repoURL];
-        _infoRetrievedDate = [NSDate date];
+        // this is a backup synchronous method to pull the information,
+        // it only goes to the network when the cached releases have expired.
+        NSDate *retrieved = nil;
+        _jsonObject = [[LGGitHubReleaseCache sharedCache] releasesForURL:_repoURL apiToken:nil retrieved:&retrieved error:nil];
+        _infoRetrievedDate = retrieved ?: [NSDate date];
     }
     return _jsonObject;
 }
@@ -150,32 +153,19 @@
 
 - (void)getReleaseInfo:(void (^)(LGGitHubReleaseInfo *, NSError *error))complete
 {
+    NSString *gitHubURL = _gitHubURL;
+    NSString *apiToken = _apiToken;
 
-    NSURL *url = [NSURL URLWithString:_gitHubURL];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSDate *retrieved = nil;
+        NSError *error = nil;
+        NSArray *releases = [[LGGitHubReleaseCache sharedCache] releasesForURL:gitHubURL apiToken:apiToken retrieved:&retrieved error:&error];
 
-    NSMutableURLRequest *req = [NSMutableURLRequest requestWithURL:url
-                                         cachePolicy:NSURLRequestUseProtocolCachePolicy
-                                     timeoutInterval:15.0];
-    
-    if (_apiToken) {
-        [req setValue:[@"token " stringByAppendingString:_apiToken] forHTTPHeaderField:@"Authorization"];
-    };
-
-    AFHTTPRequestOperation *operation = [[AFHTTPRequestOperation alloc] initWithRequest:req];
-    operation.responseSerializer = [AFJSONResponseSerializer serializer];
-
-    [operation setCompletionBlockWithSuccess:^(AFHTTPRequestOperation *operation, NSArray *responseObject) {
-        LGGitHubReleaseInfo *info = [[LGGitHubReleaseInfo alloc] initWithJSON:responseObject];
-        complete(info, nil);
-//        DevLog(@"Remaining calls/hour to GitHub API: %@/%@ (used Cache = %@)",
-//               operation.response.allHeaderFields[@"X-RateLimit-Remaining"],
-//               operation.response.allHeaderFields[@"X-RateLimit-Limit"],
-//               [operation.response.allHeaderFields[@"Status"] isEqualToString:@"304 Not Modified"] ? @"YES": @"NO");
-    } failure:^(AFHTTPRequestOperation *operation, NSError *error) {
-        complete(nil, error);
-    }];
-
-    [operation start];
+        LGGitHubReleaseInfo *info = releases ? [[LGGitHubReleaseInfo alloc] initWithJSON:releases retrieved:retrieved] : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            complete(info, error);
+        });
+    });
 }
 
 + (NSArray *)getJSONFromURL:(NSString *)aUrl
@@ -0,0 +1,73 @@
+//
+//  LGGitHubReleaseCache.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/*
+ * LGGitHubReleaseCache keeps the GitHub releases API responses of the
+ * integrations on disk, in Application Support, so the app and
+ * background runs share them. Within its lifespan a response is used
+ * as is, after that it's revalidated with its ETag, and a 304 Not
+ * Modified reply (which doesn't count against the API rate limit)
+ * keeps it for another lifespan.
+ */
+@interface LGGitHubReleaseCache : NSObject
+
+/**
+ *  Cache in the GitHubReleases directory in Application Support.
+ */
++ (instancetype)sharedCache;
+
+/**
+ *  Initialize a cache.
+ *
+ *  @param directory directory the responses are kept in, it's created when the first one is saved.
+ */
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+@property (copy, nonatomic, readonly) NSString *directory;
+
+/**
+ *  How long a response is used before it's revalidated, defaults to the integrationReleaseInfoLifespan setting.
+ */
+@property (assign, nonatomic) NSTimeInterval lifespan;
+
+/**
+ *  Get the releases of a GitHub repo, only going to the network when the cached response is missing or expired.
+ *
+ *  @param url       GitHub releases API URL.
+ *  @param apiToken  GitHub API token, may be nil.
+ *  @param retrieved set to when the releases were last fetched or revalidated.
+ *  @param error     populated if the releases could not be fetched and nothing was cached.
+ *
+ *  @return the decoded JSON array of releases, when the API can't be reached an expired response is returned.
+ */
+- (NSArray *)releasesForURL:(NSString *)url apiToken:(NSString *)apiToken retrieved:(NSDate **)retrieved error:(NSError **)error;
+
+/**
+ *  Get the cached releases of a GitHub repo without going to the network.
+ *
+ *  @param url       GitHub releases API URL.
+ *  @param retrieved set to when the releases were last fetched or revalidated.
+ *
+ *  @return the decoded JSON array of releases, or nil if they were never fetched.
+ */
+- (NSArray *)cachedReleasesForURL:(NSString *)url retrieved:(NSDate **)retrieved;
+
+@end
@@ -0,0 +1,192 @@
+//
+//  LGGitHubReleaseCache.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGGitHubReleaseCache.h"
+#import "LGAutoPkgr.h"
+
+// Keys of a cached response.
+static NSString *const kLGReleaseCacheURLKey = @"url";
+static NSString *const kLGReleaseCacheETagKey = @"etag";
+static NSString *const kLGReleaseCacheRetrievedKey = @"retrieved";
+static NSString *const kLGReleaseCacheDataKey = @"data";
+
+static NSArray *releasesFromData(NSData *data)
+{
+    id json = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    return [json isKindOfClass:[NSArray class]] ? json : nil;
+}
+
+@implementation LGGitHubReleaseCache
+
++ (instancetype)sharedCache
+{
+    static LGGitHubReleaseCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[self alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init
+{
+    return [self initWithDirectory:[[LGHostInfo getAppSupportDirectory] stringByAppendingPathComponent:@"GitHubReleases"]];
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+    if (self = [super init]) {
+        _directory = [directory copy];
+        _lifespan = [[LGDefaults standardUserDefaults] integrationReleaseInfoLifespan];
+    }
+    return self;
+}
+
+#pragma mark - Releases
+- (NSArray *)releasesForURL:(NSString *)url apiToken:(NSString *)apiToken retrieved:(NSDate *__autoreleasing *)retrieved error:(NSError *__autoreleasing *)error
+{
+    if (!url.length) {
+        return nil;
+    }
+
+    NSDictionary *entry = [self entryForURL:url];
+    NSArray *releases = releasesFromData(entry[kLGReleaseCacheDataKey]);
+    NSDate *entryRetrieved = entry[kLGReleaseCacheRetrievedKey];
+
+    if (releases && entryRetrieved && -entryRetrieved.timeIntervalSinceNow < _lifespan) {
+        if (retrieved) {
+            *retrieved = entryRetrieved;
+        }
+        return releases;
+    }
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:url]
+                                                           cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                       timeoutInterval:15.0];
+    if (apiToken.length) {
+        [request setValue:[@"token " stringByAppendingString:apiToken] forHTTPHeaderField:@"Authorization"];
+    }
+    if (releases && [entry[kLGReleaseCacheETagKey] length]) {
+        [request setValue:entry[kLGReleaseCacheETagKey] forHTTPHeaderField:@"If-None-Match"];
+    }
+
+    NSURLResponse *urlResponse = nil;
+    NSError *requestError = nil;
+    NSData *data = [NSURLConnection sendSynchronousRequest:request returningResponse:&urlResponse error:&requestError];
+
+    NSHTTPURLResponse *response = [urlResponse isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)urlResponse : nil;
+    NSInteger status = response.statusCode;
+    NSArray *fetchedReleases = (status == 200) ? releasesFromData(data) : nil;
+
+    if (status == 304 && releases) {
+        DevLog(@"GitHub releases at %@ are unchanged.", url);
+        data = entry[kLGReleaseCacheDataKey];
+        fetchedReleases = releases;
+    }
+
+    if (fetchedReleases) {
+        NSDate *now = [NSDate date];
+        NSString *etag = response.allHeaderFields[@"ETag"];
+        [self saveEntry:@{ kLGReleaseCacheURLKey : url,
+                           kLGReleaseCacheETagKey : etag ?: @"",
+                           kLGReleaseCacheRetrievedKey : now,
+                           kLGReleaseCacheDataKey : data }];
+        if (retrieved) {
+            *retrieved = now;
+        }
+        return fetchedReleases;
+    }
+
+    if (!requestError) {
+        NSString *description = quick_formatString(@"GitHub responded with %ld when getting %@.", (long)status, url);
+        requestError = [NSError errorWithDomain:kLGApplicationName code:-1 userInfo:@{ NSLocalizedDescriptionKey : description }];
+    }
+
+    /* Releases that couldn't be revalidated are better than none. */
+    if (releases) {
+        NSLog(@"Using the cached GitHub releases of %@. %@", url, requestError.localizedDescription);
+        if (retrieved) {
+            *retrieved = entryRetrieved;
+        }
+        return releases;
+    }
+
+    if (error) {
+        *error = requestError;
+    }
+    return nil;
+}
+
+- (NSArray *)cachedReleasesForURL:(NSString *)url retrieved:(NSDate *__autoreleasing *)retrieved
+{
+    NSDictionary *entry = [self entryForURL:url];
+    NSArray *releases = releasesFromData(entry[kLGReleaseCacheDataKey]);
+    if (releases && retrieved) {
+        *retrieved = entry[kLGReleaseCacheRetrievedKey];
+    }
+    return releases;
+}
+
+#pragma mark - Entries
+- (NSString *)fileForURL:(NSString *)url
+{
+    NSCharacterSet *separators = [[NSCharacterSet alphanumericCharacterSet] invertedSet];
+    NSString *name = [[url componentsSeparatedByCharactersInSet:separators] componentsJoinedByString:@"_"];
+    return [_directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"plist"]];
+}
+
+- (NSDictionary *)entryForURL:(NSString *)url
+{
+    if (!url.length) {
+        return nil;
+    }
+
+    NSDictionary *entry = nil;
+    @synchronized(self)
+    {
+        entry = [NSDictionary dictionaryWithContentsOfFile:[self fileForURL:url]];
+    }
+
+    // Names are only sanitized URLs, so make sure the entry is the right one.
+    if (![entry[kLGReleaseCacheURLKey] isEqualToString:url] ||
+        ![entry[kLGReleaseCacheRetrievedKey] isKindOfClass:[NSDate class]]) {
+        return nil;
+    }
+    return entry;
+}
+
+- (void)saveEntry:(NSDictionary *)entry
+{
+    // Binary plists keep the fractional seconds of the retrieved date.
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:entry
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:nil];
+
+    @synchronized(self)
+    {
+        // Written atomically, so the app and a background run can share the directory.
+        if (![[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil] ||
+            ![data writeToFile:[self fileForURL:entry[kLGReleaseCacheURLKey]] atomically:YES]) {
+            NSLog(@"Could not cache the GitHub releases of %@.", entry[kLGReleaseCacheURLKey]);
+        }
+    }
+}
+
+@end
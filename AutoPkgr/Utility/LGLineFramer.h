@@ -0,0 +1,82 @@
+//
+//  LGLineFramer.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Block called for each line.
+ *
+ *  @param bytes  Start of the line, without the line break. Only valid for the duration of the call.
+ *  @param length Number of bytes in the line.
+ */
+typedef void (^LGLineFramerLineBlock)(const char *bytes, NSUInteger length);
+
+/*
+ * LGLineFramer splits a stream of NSData chunks (such as the output of
+ * an NSPipe's readabilityHandler) into lines. It scans the raw bytes
+ * for line breaks and hands out pointers into the chunk, so no string
+ * is created unless the line handler needs one. A line split across
+ * chunks is held until its line break arrives.
+ */
+@interface LGLineFramer : NSObject
+
+- (instancetype)initWithLineHandler:(LGLineFramerLineBlock)lineHandler;
+
+/**
+ *  Called after each chunk with the bytes of a line that hasn't been terminated yet, if any.
+ *  @note Useful to detect prompts, which don't end with a line break.
+ */
+@property (copy) LGLineFramerLineBlock partialLineHandler;
+
+/**
+ *  Scan a chunk of data, calling the line handler for each completed line.
+ *
+ *  @param data chunk of data.
+ */
+- (void)appendData:(NSData *)data;
+
+/**
+ *  Call the line handler with any remaining unterminated line.
+ */
+- (void)flush;
+
+@end
+
+#pragma mark - Matchers
+/* Byte level matchers for use in the line handler. */
+
+/**
+ *  Whether the line starts with a C string.
+ */
+BOOL LGLineHasPrefix(const char *bytes, NSUInteger length, const char *prefix);
+
+/**
+ *  Whether the line ends with a C string, ignoring trailing whitespace and case.
+ */
+BOOL LGLineHasSuffix(const char *bytes, NSUInteger length, const char *suffix);
+
+/**
+ *  Whether the line contains a C string, ignoring case.
+ */
+BOOL LGLineContains(const char *bytes, NSUInteger length, const char *needle);
+
+/**
+ *  Create a string from a line, decoded as UTF-8 or as Latin-1 when it is not valid UTF-8.
+ */
+NSString *LGLineString(const char *bytes, NSUInteger length);
@@ -0,0 +1,147 @@
+//
+//  LGLineFramer.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGLineFramer.h"
+
+#import <ctype.h>
+#import <string.h>
+
+@implementation LGLineFramer {
+    LGLineFramerLineBlock _lineHandler;
+
+    // Bytes of a line that continues into the next chunk.
+    NSMutableData *_pending;
+}
+
+- (instancetype)initWithLineHandler:(LGLineFramerLineBlock)lineHandler
+{
+    if (self = [super init]) {
+        _lineHandler = [lineHandler copy];
+        _pending = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data
+{
+    @synchronized(self)
+    {
+        [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+            [self scanBytes:bytes length:byteRange.length];
+        }];
+
+        if (_pending.length && _partialLineHandler) {
+            _partialLineHandler(_pending.bytes, _pending.length);
+        }
+    }
+}
+
+- (void)flush
+{
+    @synchronized(self)
+    {
+        if (_pending.length) {
+            [self dispatchLine:_pending.bytes length:_pending.length];
+            _pending.length = 0;
+        }
+    }
+}
+
+#pragma mark - Private
+- (void)scanBytes:(const char *)bytes length:(NSUInteger)length
+{
+    const char *cursor = bytes;
+    const char *end = bytes + length;
+    const char *newline;
+
+    while (cursor < end && (newline = memchr(cursor, '\n', end - cursor))) {
+        if (_pending.length) {
+            // Only a line split across chunks gets copied.
+            [_pending appendBytes:cursor length:newline - cursor];
+            [self dispatchLine:_pending.bytes length:_pending.length];
+            _pending.length = 0;
+        } else {
+            [self dispatchLine:cursor length:newline - cursor];
+        }
+        cursor = newline + 1;
+    }
+
+    if (cursor < end) {
+        [_pending appendBytes:cursor length:end - cursor];
+    }
+}
+
+- (void)dispatchLine:(const char *)bytes length:(NSUInteger)length
+{
+    if (length && bytes[length - 1] == '\r') {
+        length--;
+    }
+    _lineHandler(bytes, length);
+}
+
+@end
+
+#pragma mark - Matchers
+static NSUInteger trimmedLength(const char *bytes, NSUInteger length)
+{
+    while (length && isspace((unsigned char)bytes[length - 1])) {
+        length--;
+    }
+    return length;
+}
+
+BOOL LGLineHasPrefix(const char *bytes, NSUInteger length, const char *prefix)
+{
+    size_t prefixLength = strlen(prefix);
+    return (length >= prefixLength) && (memcmp(bytes, prefix, prefixLength) == 0);
+}
+
+BOOL LGLineHasSuffix(const char *bytes, NSUInteger length, const char *suffix)
+{
+    size_t suffixLength = strlen(suffix);
+    length = trimmedLength(bytes, length);
+
+    return (length >= suffixLength) && (strncasecmp(bytes + length - suffixLength, suffix, suffixLength) == 0);
+}
+
+BOOL LGLineContains(const char *bytes, NSUInteger length, const char *needle)
+{
+    size_t needleLength = strlen(needle);
+    if (!needleLength) {
+        return YES;
+    } else if (length < needleLength) {
+        return NO;
+    }
+
+    int first = tolower((unsigned char)needle[0]);
+    const char *last = bytes + length - needleLength;
+
+    for (const char *cursor = bytes; cursor <= last; cursor++) {
+        if (tolower((unsigned char)*cursor) == first && strncasecmp(cursor, needle, needleLength) == 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+NSString *LGLineString(const char *bytes, NSUInteger length)
+{
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding]
+               ?: [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+}
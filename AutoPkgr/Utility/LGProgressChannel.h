@@ -0,0 +1,63 @@
+//
+//  LGProgressChannel.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Block called with the latest progress.
+ */
+typedef void (^LGProgressChannelHandler)(NSString *message, double progress);
+
+/*
+ * LGProgressChannel coalesces progress updates sent from any thread,
+ * so the handler runs at most once per interval with the latest message,
+ * no matter how fast updates arrive. The last update is never dropped,
+ * it's delivered once the interval has passed, or right away by flush.
+ */
+@interface LGProgressChannel : NSObject
+
+/**
+ *  Channel that calls the handler on the main queue, at most 10 times a second.
+ */
++ (instancetype)channelWithHandler:(LGProgressChannelHandler)handler;
+
+/**
+ *  Initialize a channel.
+ *
+ *  @param interval minimum time between two calls of the handler.
+ *  @param queue    queue the handler is called on.
+ *  @param handler  block called with the latest progress.
+ */
+- (instancetype)initWithInterval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue handler:(LGProgressChannelHandler)handler;
+
+@property (assign, nonatomic, readonly) NSTimeInterval interval;
+
+/**
+ *  Send a progress update, replacing any that hasn't been delivered yet.
+ */
+- (void)sendMessage:(NSString *)message progress:(double)progress;
+
+/**
+ *  Deliver the update that's waiting, if any, without waiting for the interval.
+ *  @note When called on the channel's queue the handler runs before this returns,
+ *        so the final progress is always seen before a completion handler that calls this first.
+ */
+- (void)flush;
+
+@end
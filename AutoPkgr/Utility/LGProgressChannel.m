@@ -0,0 +1,142 @@
+//
+//  LGProgressChannel.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGProgressChannel.h"
+
+// Default of 10 updates a second is more than the UI can show.
+static NSTimeInterval const kLGProgressChannelDefaultInterval = 0.1;
+
+@implementation LGProgressChannel {
+    LGProgressChannelHandler _handler;
+    dispatch_queue_t _queue;
+
+    NSString *_pendingMessage;
+    double _pendingProgress;
+    BOOL _hasPending;
+    BOOL _deliveryScheduled;
+    CFAbsoluteTime _lastDelivery;
+}
+
++ (instancetype)channelWithHandler:(LGProgressChannelHandler)handler
+{
+    return [[self alloc] initWithInterval:kLGProgressChannelDefaultInterval queue:dispatch_get_main_queue() handler:handler];
+}
+
+- (void)dealloc
+{
+    if (_queue != dispatch_get_main_queue()) {
+        dispatch_queue_set_specific(_queue, (__bridge void *)self, NULL, NULL);
+    }
+}
+
+- (instancetype)init
+{
+    return [self initWithInterval:kLGProgressChannelDefaultInterval queue:dispatch_get_main_queue() handler:nil];
+}
+
+- (instancetype)initWithInterval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue handler:(LGProgressChannelHandler)handler
+{
+    if (self = [super init]) {
+        _interval = MAX(interval, 0);
+        _queue = queue ?: dispatch_get_main_queue();
+        _handler = [handler copy];
+
+        // Tag the queue so flush can tell when it's already on it.
+        if (_queue != dispatch_get_main_queue()) {
+            dispatch_queue_set_specific(_queue, (__bridge void *)self, (__bridge void *)self, NULL);
+        }
+    }
+    return self;
+}
+
+#pragma mark - Sending
+- (void)sendMessage:(NSString *)message progress:(double)progress
+{
+    if (!_handler) {
+        return;
+    }
+
+    NSTimeInterval delay = 0;
+    BOOL scheduleDelivery = NO;
+    @synchronized(self)
+    {
+        _pendingMessage = [message copy];
+        _pendingProgress = progress;
+        _hasPending = YES;
+
+        // One delivery is scheduled at a time, later updates just replace what it will deliver.
+        if (!_deliveryScheduled) {
+            _deliveryScheduled = scheduleDelivery = YES;
+            delay = MAX(_lastDelivery + _interval - CFAbsoluteTimeGetCurrent(), 0);
+        }
+    }
+
+    if (scheduleDelivery) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+            [self deliverPendingUpdate:YES];
+        });
+    }
+}
+
+- (void)flush
+{
+    if ([self isOnQueue]) {
+        [self deliverPendingUpdate:NO];
+    } else {
+        dispatch_async(_queue, ^{
+            [self deliverPendingUpdate:NO];
+        });
+    }
+}
+
+#pragma mark - Delivery
+- (void)deliverPendingUpdate:(BOOL)scheduled
+{
+    // Only called on _queue.
+    NSString *message = nil;
+    double progress = 0;
+    @synchronized(self)
+    {
+        if (scheduled) {
+            _deliveryScheduled = NO;
+        }
+
+        if (!_hasPending) {
+            return;
+        }
+
+        message = _pendingMessage;
+        progress = _pendingProgress;
+        _pendingMessage = nil;
+        _hasPending = NO;
+        _lastDelivery = CFAbsoluteTimeGetCurrent();
+    }
+
+    _handler(message, progress);
+}
+
+- (BOOL)isOnQueue
+{
+    if (_queue == dispatch_get_main_queue()) {
+        return [NSThread isMainThread];
+    }
+    return dispatch_get_specific((__bridge void *)self) == (__bridge void *)self;
+}
+
+@end
@@ -0,0 +1,77 @@
+//
+//  LGRedactor.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  String credentials are replaced with.
+ */
+extern NSString *const kLGRedactorMask;
+
+/*
+ * LGRedactor masks credentials in text that leaves the app or ends up
+ * in the logs: passwords in URLs, input keys such as JSS_PASS, API and
+ * GitHub tokens, and authorization headers.
+ *
+ * All the patterns are compiled once into a single expression, so a
+ * string is masked in one pass no matter how many credentials it has.
+ */
+@interface LGRedactor : NSObject
+
+/**
+ *  Redactor with the default patterns, along with any secrets added to it.
+ */
++ (instancetype)sharedRedactor;
+
+/**
+ *  Initialize a redactor.
+ *
+ *  @param patterns regular expressions, each with exactly one capture group around the part to mask.
+ */
+- (instancetype)initWithPatterns:(NSArray *)patterns;
+
+/**
+ *  Also mask every occurrence of a known secret, such as a stored API token.
+ *
+ *  @param secret string to mask, secrets shorter than 4 characters are ignored.
+ */
+- (void)addSecret:(NSString *)secret;
+
+/**
+ *  Mask the credentials in a string.
+ *
+ *  @param string string to mask.
+ *
+ *  @return the masked string, or the string itself when there was nothing to mask.
+ */
+- (NSString *)redactString:(NSString *)string;
+
+/**
+ *  Mask the credentials in every string of a property list object, such as a report dictionary.
+ *
+ *  @param object string, array or dictionary.
+ */
+- (id)redactObject:(id)object;
+
+@end
+
+/**
+ *  Mask the credentials in a string with the shared redactor.
+ */
+NSString *LGRedactedString(NSString *string);
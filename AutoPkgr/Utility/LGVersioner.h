@@ -25,6 +25,32 @@ extern NSString *const kLGVersionerVersionKey;
 
 @interface LGVersioner : NSObject
 
+/**
+ *  Initialize a versioner with the default processors and path extensions.
+ */
+- (instancetype)init;
+
+/**
+ *  Initialize a versioner.
+ *
+ *  @param processors     Names of processors whose output lines contain the downloaded file.
+ *  @param pathExtensions Path extensions (without the dot) of downloaded files.
+ */
+- (instancetype)initWithProcessors:(NSArray *)processors pathExtensions:(NSArray *)pathExtensions;
+
+/**
+ *  Processors considered by default, URLDownloader.
+ */
++ (NSArray *)defaultProcessors;
+
+/**
+ *  Path extensions considered by default, dmg, zip, tar and gz.
+ */
++ (NSArray *)defaultPathExtensions;
+
+@property (copy, nonatomic, readonly) NSArray *processors;
+@property (copy, nonatomic, readonly) NSArray *pathExtensions;
+
 /**
  *  Array of dictionaries. Each dictionary has two keys
  *  kLGVersionerAppKey representing the Application Name
@@ -39,4 +65,11 @@ extern NSString *const kLGVersionerVersionKey;
  */
 - (void)parseString:(NSString *)string;
 
+/**
+ *  Same as parseString: for a single line, without splitting it first.
+ *
+ *  @param line line to parse
+ */
+- (void)parseLine:(NSString *)line;
+
 @end
@@ -24,6 +24,24 @@
 NSString *const kLGVersionerAppKey = @"pkg_path";
 NSString *const kLGVersionerVersionKey = @"version";
 
+// Matches 1.2, 1.2.3, 1.2.3.4 with an optional -alpha/-beta/-rc suffix.
+static NSRegularExpression *versionExpression()
+{
+    static NSRegularExpression *expression;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *pattern = @"((\\d+)\\.(\\d+)(\\.(\\d+))?(\\.(\\d+))?)(?:(?:-(alpha\\d*|beta\\d*|rc\\d*))?)";
+        expression = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:nil];
+    });
+    return expression;
+}
+
+// Same comparison as CONTAINS[cd].
+static BOOL stringContains(NSString *string, NSString *substring)
+{
+    return [string rangeOfString:substring options:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch].location != NSNotFound;
+}
+
 @interface LGVersioner ()
 @property (strong, nonatomic) NSMutableSet *workingSet;
 
@@ -33,29 +51,67 @@ NSString *const kLGVersionerVersionKey = @"version";
 
 @implementation LGVersioner {
     BOOL isNew;
+
+    // Extensions prefixed with a dot, for matching the line.
+    NSArray *_dottedPathExtensions;
 }
 
-- (void)parseString:(NSString *)rawString
++ (NSArray *)defaultProcessors
 {
-    for (NSString *string in rawString.split_byLine) {
-        // if string begins with "Processing" we've started a new app, so
-        // reset the current values
+    return @[ @"URLDownloader" ];
+}
 
-        NSPredicate *predicate = [NSPredicate
-            predicateWithFormat:@"SELF BEGINSWITH 'Processing'"];
++ (NSArray *)defaultPathExtensions
+{
+    return @[ @"dmg", @"zip", @"tar", @"gz" ];
+}
 
-        if ([predicate evaluateWithObject:string]) {
-            _currentVersion = nil;
-            _currentApplication = nil;
-            isNew = YES;
+- (instancetype)init
+{
+    return [self initWithProcessors:[[self class] defaultProcessors]
+                     pathExtensions:[[self class] defaultPathExtensions]];
+}
+
+- (instancetype)initWithProcessors:(NSArray *)processors pathExtensions:(NSArray *)pathExtensions
+{
+    if (self = [super init]) {
+        _processors = [processors copy];
+        _pathExtensions = [pathExtensions copy];
+
+        NSMutableArray *dottedPathExtensions = [[NSMutableArray alloc] initWithCapacity:pathExtensions.count];
+        for (NSString *extension in pathExtensions) {
+            [dottedPathExtensions addObject:[@"." stringByAppendingString:extension]];
         }
+        _dottedPathExtensions = [dottedPathExtensions copy];
+    }
+    return self;
+}
+
+- (void)parseString:(NSString *)rawString
+{
+    for (NSString *string in rawString.split_byLine) {
+        [self parseLine:string];
+    }
+}
+
+- (void)parseLine:(NSString *)string
+{
+    // if string begins with "Processing" we've started a new app, so
+    // reset the current values
+    if ([string hasPrefix:@"Processing"]) {
+        _currentVersion = nil;
+        _currentApplication = nil;
+        isNew = YES;
+    }
 
-        if (isNew) {
-            [self evaluateApplication:string];
-            [self evaluateVersion:string];
-            // If there is a new application detected, check if we've successfully
-            // found a version string, and write it to our working array.
-            if (_currentVersion && _currentApplication) {
+    if (isNew) {
+        [self evaluateApplication:string];
+        [self evaluateVersion:string];
+        // If there is a new application detected, check if we've successfully
+        // found a version string, and write it to our working array.
+        if (_currentVersion && _currentApplication) {
+            @synchronized(self)
+            {
                 if (!_workingSet) {
                     _workingSet = [[NSMutableSet alloc] init];
                 }
@@ -63,65 +119,53 @@ NSString *const kLGVersionerVersionKey = @"version";
                 DLog(@"Found app and version: %@:%@", _currentApplication, _currentVersion);
                 [_workingSet addObject:@{ kLGVersionerAppKey : _currentApplication,
                                           kLGVersionerVersionKey : _currentVersion }];
-                isNew = NO;
             }
+            isNew = NO;
         }
     }
 }
 
 - (void)evaluateVersion:(NSString *)rawString
 {
-    NSError *error;
-    NSString *pattern = @"((\\d+)\\.(\\d+)(\\.(\\d+))?(\\.(\\d+))?)(?:(?:-(alpha\\d*|beta\\d*|rc\\d*))?)";
-
-    NSString *string = CFBridgingRelease(CFURLCreateStringByReplacingPercentEscapesUsingEncoding(NULL, (__bridge CFStringRef)rawString, CFSTR(""), kCFStringEncodingUTF8));
+    NSString *string = rawString;
 
-    NSRegularExpression *exp = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:&error];
+    // Only lines with a percent sign can have escapes to replace.
+    if ([rawString rangeOfString:@"%"].location != NSNotFound) {
+        string = CFBridgingRelease(CFURLCreateStringByReplacingPercentEscapesUsingEncoding(NULL, (__bridge CFStringRef)rawString, CFSTR(""), kCFStringEncodingUTF8));
+    }
 
-    if (string && !error) {
-        NSRange range = NSMakeRange(0, string.length);
-        NSArray *matches = [exp matchesInString:string options:0 range:range];
-        for (NSTextCheckingResult *match in matches) {
+    if (string) {
+        NSTextCheckingResult *match = [versionExpression() firstMatchInString:string options:0 range:NSMakeRange(0, string.length)];
+        if (match) {
             _currentVersion = [string substringWithRange:match.range];
-            break;
         }
     }
 }
 
 - (void)evaluateApplication:(NSString *)rawString
 {
-
-    NSArray *validPathExtensions = @[ @"dmg", @"zip", @"tar", @"gz" ];
-    NSArray *possibleProcessors = @[ @"URLDownloader" ];
-
-    // Construct a predicate string from the above values.
-    // This will make it easy to adjust in the future, as more processors are
-    // used to retrieved apps
-    NSMutableString *predicateString = [[NSMutableString alloc] initWithString:@"("];
-    for (int i = 0; i < validPathExtensions.count; i++) {
-        [predicateString appendFormat:@"SELF CONTAINS[CD] '.%@' ", validPathExtensions[i]];
-        if (i < validPathExtensions.count - 1) {
-            [predicateString appendString:@" OR "];
+    // The line must mention one of the processors, and one of the path extensions.
+    BOOL found = NO;
+    for (NSString *processor in _processors) {
+        if ((found = stringContains(rawString, processor))) {
+            break;
         }
     }
-    [predicateString appendString:@") AND ("];
 
-    for (int i = 0; i < possibleProcessors.count; i++) {
-        [predicateString appendFormat:@"SELF CONTAINS[CD] '%@' ", possibleProcessors[i]];
-        if (i < possibleProcessors.count - 1) {
-            [predicateString appendString:@" OR "];
+    if (found) {
+        found = NO;
+        for (NSString *extension in _dottedPathExtensions) {
+            if ((found = stringContains(rawString, extension))) {
+                break;
+            }
         }
     }
-    [predicateString appendString:@")"];
 
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:[predicateString copy]];
-
-    // Look for .dmg or .zip or,
-    if ([predicate evaluateWithObject:rawString]) {
+    if (found) {
         // split by "/", filter array by .dmg, remove file extension
         NSArray *splitArray = [rawString componentsSeparatedByString:@"/"];
         for (NSString *cmp in splitArray) {
-            if ([validPathExtensions containsObject:cmp.pathExtension]) {
+            if ([_pathExtensions containsObject:cmp.pathExtension]) {
                 _currentApplication = [[cmp stringByDeletingPathExtension] trimmed];
             }
         }
@@ -130,7 +174,10 @@ NSString *const kLGVersionerVersionKey = @"version";
 
 - (NSArray *)currentResults
 {
-    return _workingSet.count ? [_workingSet allObjects] : @[];
+    @synchronized(self)
+    {
+        return _workingSet.count ? [_workingSet allObjects] : @[];
+    }
 }
 
 @end
@@ -106,6 +106,10 @@
         [[NSApplication sharedApplication] terminate:self];
     }
 
+    // Keep the results of a run that was interrupted when AutoPkgr last quit,
+    // this has to happen before a new run can start writing its journal.
+    [LGAutoPkgTaskManager recoverInterruptedRuns];
+
     // Setup User Notification Delegate
     _notificationDelegate = [[LGUserNotificationsDelegate alloc] initAsDefaultCenterDelegate];
 
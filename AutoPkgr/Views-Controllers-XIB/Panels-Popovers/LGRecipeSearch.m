@@ -22,6 +22,7 @@
 #import "LGAutoPkgr.h"
 #import "LGAutoPkgTask.h"
 #import "LGAutoPkgRecipe.h"
+#import "LGAutoPkgRecipeSearchIndex.h"
 #import "LGRecipeTableViewController.h"
 #import "NSTextField+animatedString.h"
 
@@ -82,19 +83,19 @@
         [_progressIndicator setHidden:NO];
         [_progressIndicator startAnimation:nil];
 
-        [LGAutoPkgTask search:searchString
-                        reply:^(NSArray *results, NSError *error) {
-                            [_progressIndicator stopAnimation:nil];
-                            [_progressIndicator setHidden:YES];
-                            if (error) {
-                                _limitMessage.hidden = NO;
-                                NSLog(@"%@",error);
-                            } else {
-                                _limitMessage.hidden = YES;
-                                _searchResults = results;
-                                [_searchTable reloadData];
-                            }
-                        }];
+        [[LGAutoPkgRecipeSearchIndex sharedIndex] search:searchString
+                                                   reply:^(NSArray *results, NSError *error) {
+                                                       [_progressIndicator stopAnimation:nil];
+                                                       [_progressIndicator setHidden:YES];
+                                                       if (error) {
+                                                           _limitMessage.hidden = NO;
+                                                           NSLog(@"%@",error);
+                                                       } else {
+                                                           _limitMessage.hidden = YES;
+                                                           _searchResults = results;
+                                                           [_searchTable reloadData];
+                                                       }
+                                                   }];
     }
 }
 
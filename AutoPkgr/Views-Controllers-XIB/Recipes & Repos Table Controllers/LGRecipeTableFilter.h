@@ -0,0 +1,81 @@
+//
+//  LGRecipeTableFilter.h
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/*
+ * LGRecipeTableFilter filters the rows of a table as the user types.
+ *
+ * The case and diacritic folded search key of each object is built once,
+ * and kept for as long as the object is part of the table. When the query
+ * extends the previous one, only the previous matches are searched again.
+ * Filtering happens on a background queue, a query that's superseded
+ * before it's finished is dropped.
+ */
+@interface LGRecipeTableFilter : NSObject
+
+/**
+ *  Initialize a filter.
+ *
+ *  @param keys keys of the objects to search, an object matches if any of them contains the query.
+ */
+- (instancetype)initWithKeys:(NSArray *)keys;
+
+/**
+ *  Objects to filter, in the order they're displayed.
+ *  @note Setting this cancels any query in progress.
+ */
+@property (copy, nonatomic) NSArray *objects;
+
+/**
+ *  How long to wait for more keystrokes before filtering, defaults to 0.1 seconds.
+ */
+@property (assign, nonatomic) NSTimeInterval delay;
+
+/**
+ *  Filter the objects.
+ *
+ *  @param query string to look for, an empty query matches everything.
+ *
+ *  @return indexes of the matching objects.
+ */
+- (NSIndexSet *)filter:(NSString *)query;
+
+/**
+ *  Filter the objects on a background queue, after the delay.
+ *
+ *  @param query string to look for, an empty query matches everything and is done without delay.
+ *  @param reply block called on the main queue with the objects searched and the indexes of the ones that matched. It isn't called if another query is made, or the objects are changed, before this one is finished.
+ */
+- (void)filter:(NSString *)query reply:(void (^)(NSArray *objects, NSIndexSet *matches))reply;
+
+/**
+ *  Work out the table rows to remove and insert to go from one set of matches to another.
+ *
+ *  @param oldMatches indexes of the objects currently displayed.
+ *  @param newMatches indexes of the objects to display.
+ *  @param removed    rows to remove, indexes into the current rows.
+ *  @param inserted   rows to insert once the removed ones are gone, indexes into the new rows.
+ */
++ (void)rowChangesFromMatches:(NSIndexSet *)oldMatches
+                    toMatches:(NSIndexSet *)newMatches
+                      removed:(NSIndexSet **)removed
+                     inserted:(NSIndexSet **)inserted;
+
+@end
@@ -0,0 +1,253 @@
+//
+//  LGRecipeTableFilter.m
+//  AutoPkgr
+//
+//  Copyright 2015 The Linde Group, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "LGRecipeTableFilter.h"
+
+// Number of objects searched between checks for a newer query.
+static NSUInteger const kLGRecipeTableFilterBatchSize = 256;
+
+static NSString *foldedString(NSString *string)
+{
+    return [string stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch locale:nil];
+}
+
+static BOOL containsString(NSString *string, NSString *substring)
+{
+    return [string rangeOfString:substring options:NSLiteralSearch].location != NSNotFound;
+}
+
+@implementation LGRecipeTableFilter {
+    NSArray *_keys;
+    dispatch_queue_t _queue;
+
+    // Incremented by every query and change of objects,
+    // work for an older generation is abandoned.
+    uint64_t _generation;
+
+    // Only accessed on _queue.
+    NSArray *_searchedObjects;
+    NSArray *_searchKeys;
+    NSMapTable *_searchKeysByObject;
+    NSString *_lastQuery;
+    NSIndexSet *_lastMatches;
+}
+
+- (instancetype)init
+{
+    return [self initWithKeys:nil];
+}
+
+- (instancetype)initWithKeys:(NSArray *)keys
+{
+    if (self = [super init]) {
+        _keys = [keys copy];
+        _delay = 0.1;
+        _queue = dispatch_queue_create("com.lindegroup.autopkgr.recipe.filter", DISPATCH_QUEUE_SERIAL);
+        _searchedObjects = @[];
+        _searchKeys = @[];
+        _searchKeysByObject = [NSMapTable strongToStrongObjectsMapTable];
+    }
+    return self;
+}
+
+#pragma mark - Objects
+- (void)setObjects:(NSArray *)objects
+{
+    NSArray *snapshot = [objects copy] ?: @[];
+    _objects = snapshot;
+    [self nextGeneration];
+
+    dispatch_async(_queue, ^{
+        [self updateSearchedObjects:snapshot];
+    });
+}
+
+- (void)updateSearchedObjects:(NSArray *)objects
+{
+    // Reuse the search keys of objects that were already in the table,
+    // re-sorting or reloading only builds keys for the new objects.
+    NSMapTable *searchKeysByObject = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                               valueOptions:NSPointerFunctionsStrongMemory
+                                                                   capacity:objects.count];
+
+    NSMutableArray *searchKeys = [[NSMutableArray alloc] initWithCapacity:objects.count];
+    for (id object in objects) {
+        NSString *searchKey = [_searchKeysByObject objectForKey:object] ?: [self searchKeyForObject:object];
+        [searchKeysByObject setObject:searchKey forKey:object];
+        [searchKeys addObject:searchKey];
+    }
+
+    _searchedObjects = objects;
+    _searchKeys = [searchKeys copy];
+    _searchKeysByObject = searchKeysByObject;
+    _lastQuery = nil;
+    _lastMatches = nil;
+}
+
+- (NSString *)searchKeyForObject:(id)object
+{
+    NSMutableArray *values = [[NSMutableArray alloc] initWithCapacity:_keys.count];
+    for (NSString *key in _keys) {
+        id value = [object valueForKey:key];
+        if ([value isKindOfClass:[NSString class]]) {
+            [values addObject:value];
+        }
+    }
+    // Separate the values so a query can't match across them.
+    return foldedString([values componentsJoinedByString:@"\n"]);
+}
+
+#pragma mark - Filtering
+- (NSIndexSet *)filter:(NSString *)query
+{
+    uint64_t generation = [self nextGeneration];
+
+    __block NSIndexSet *matches = nil;
+    dispatch_sync(_queue, ^{
+        matches = [self matchesForQuery:query generation:generation];
+    });
+    return matches;
+}
+
+- (void)filter:(NSString *)query reply:(void (^)(NSArray *, NSIndexSet *))reply
+{
+    uint64_t generation = [self nextGeneration];
+
+    void (^filterBlock)() = ^{
+        if (![self isCurrentGeneration:generation]) {
+            return;
+        }
+
+        NSArray *objects = _searchedObjects;
+        NSIndexSet *matches = [self matchesForQuery:query generation:generation];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (matches && [self isCurrentGeneration:generation]) {
+                reply(objects, matches);
+            }
+        });
+    };
+
+    if (query.length && _delay > 0) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_delay * NSEC_PER_SEC)), _queue, filterBlock);
+    } else {
+        dispatch_async(_queue, filterBlock);
+    }
+}
+
+- (NSIndexSet *)matchesForQuery:(NSString *)query generation:(uint64_t)generation
+{
+    NSString *folded = foldedString(query ?: @"");
+    NSRange allObjects = NSMakeRange(0, _searchKeys.count);
+
+    if (folded.length == 0) {
+        return [NSIndexSet indexSetWithIndexesInRange:allObjects];
+    }
+
+    // Anything matching the new query also matched one it extends, so only
+    // those need searching. When the query is shortened, everything that
+    // matched before still does.
+    NSIndexSet *candidates = nil;
+    NSMutableIndexSet *matches = [[NSMutableIndexSet alloc] init];
+
+    if (_lastQuery && containsString(folded, _lastQuery)) {
+        candidates = _lastMatches;
+    } else if (_lastQuery && containsString(_lastQuery, folded)) {
+        [matches addIndexes:_lastMatches];
+        NSMutableIndexSet *remaining = [NSMutableIndexSet indexSetWithIndexesInRange:allObjects];
+        [remaining removeIndexes:_lastMatches];
+        candidates = remaining;
+    } else {
+        candidates = [NSIndexSet indexSetWithIndexesInRange:allObjects];
+    }
+
+    __block NSUInteger searched = 0;
+    __block BOOL cancelled = NO;
+    [candidates enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if (++searched % kLGRecipeTableFilterBatchSize == 0 && ![self isCurrentGeneration:generation]) {
+            cancelled = *stop = YES;
+            return;
+        }
+        if (containsString(_searchKeys[idx], folded)) {
+            [matches addIndex:idx];
+        }
+    }];
+
+    if (cancelled) {
+        return nil;
+    }
+
+    _lastQuery = folded;
+    _lastMatches = [matches copy];
+    return _lastMatches;
+}
+
+#pragma mark - Generations
+- (uint64_t)nextGeneration
+{
+    @synchronized(self)
+    {
+        return ++_generation;
+    }
+}
+
+- (BOOL)isCurrentGeneration:(uint64_t)generation
+{
+    @synchronized(self)
+    {
+        return generation == _generation;
+    }
+}
+
+#pragma mark - Row Changes
++ (void)rowChangesFromMatches:(NSIndexSet *)oldMatches
+                    toMatches:(NSIndexSet *)newMatches
+                      removed:(NSIndexSet **)removed
+                     inserted:(NSIndexSet **)inserted
+{
+    NSMutableIndexSet *removedRows = [[NSMutableIndexSet alloc] init];
+    NSMutableIndexSet *insertedRows = [[NSMutableIndexSet alloc] init];
+
+    // Both sets index the same ordered objects, so the rows that stay
+    // keep their relative order and only removals and insertions are needed.
+    __block NSUInteger row = 0;
+    [oldMatches enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if (![newMatches containsIndex:idx]) {
+            [removedRows addIndex:row];
+        }
+        row++;
+    }];
+
+    row = 0;
+    [newMatches enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if (![oldMatches containsIndex:idx]) {
+            [insertedRows addIndex:row];
+        }
+        row++;
+    }];
+
+    if (removed) {
+        *removed = [removedRows copy];
+    }
+    if (inserted) {
+        *inserted = [insertedRows copy];
+    }
+}
+
+@end
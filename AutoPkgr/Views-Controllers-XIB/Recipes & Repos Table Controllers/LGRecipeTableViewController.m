@@ -23,14 +23,17 @@
 #import "LGRecipeInfoView.h"
 #import "LGAutoPkgr.h"
 #import "LGAutoPkgRecipe.h"
+#import "LGAutoPkgRecipeIndex.h"
 #import "LGAutoPkgTask.h"
 #import "LGRecipeOverrides.h"
 #import "LGAutoPkgReport.h"
+#import "LGRecipeTableFilter.h"
 
 @interface LGRecipeTableViewController () <NSWindowDelegate, NSPopoverDelegate>
 
 @property (copy, nonatomic) NSMutableArray *recipes;
 @property (copy, nonatomic) NSMutableArray *searchedRecipes;
+@property (strong, nonatomic, readonly) LGRecipeTableFilter *recipeFilter;
 
 @property (weak) IBOutlet LGTableView *recipeTableView;
 @property (weak) IBOutlet NSSearchField *recipeSearchField;
@@ -41,11 +44,30 @@
     NSMutableDictionary *_runTaskDictionary;
     NSString *_currentRunningRecipe;
     BOOL _isAwake;
+
+    // Recipes the filter last searched, and which of them are displayed.
+    NSArray *_filteredRecipes;
+    NSIndexSet *_searchedIndexes;
 }
 
 static NSString *const kLGAutoPkgRecipeIsEnabledKey = @"isEnabled";
 static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
 
+static NSString *formattedDuration(NSNumber *duration)
+{
+    if (!duration) {
+        return @"";
+    }
+
+    NSInteger seconds = (NSInteger)round(duration.doubleValue);
+    if (seconds < 60) {
+        return quick_formatString(@"%lds", (long)MAX(seconds, 1));
+    } else if (seconds < 3600) {
+        return quick_formatString(@"%ldm %02lds", (long)(seconds / 60), (long)(seconds % 60));
+    }
+    return quick_formatString(@"%ldh %02ldm", (long)(seconds / 3600), (long)((seconds % 3600) / 60));
+}
+
 - (void)awakeFromNib
 {
     if (!_isAwake) {
@@ -59,6 +81,12 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
 
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(reload) name:kLGNotificationReposModified object:nil];
 
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(reload) name:kLGNotificationRecipeIndexRefreshed object:nil];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(recipeListChanged:) name:kLGNotificationRecipeListChanged object:nil];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(recipeTimingsChanged:) name:kLGNotificationRecipeTimingsChanged object:nil];
+
         _searchedRecipes = self.recipes;
     }
 }
@@ -105,6 +133,9 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
         statusCell.enabledCheckBox.target = recipe;
         statusCell.enabledCheckBox.action = @selector(enableRecipe:);
 
+    } else if ([tableColumn.identifier isEqualToString:NSStringFromSelector(@selector(lastRunDuration))]) {
+        statusCell.textField.stringValue = formattedDuration(recipe.lastRunDuration);
+
     } else {
         statusCell.textField.stringValue = [recipe valueForKey:tableColumn.identifier];
     }
@@ -116,28 +147,51 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
 {
     [_searchedRecipes sortUsingDescriptors:tableView.sortDescriptors];
     [tableView reloadData];
+
+    // Keep the filter in the same order as the table.
+    [self.recipes sortUsingDescriptors:tableView.sortDescriptors];
+    self.recipeFilter.objects = _recipes;
+    _filteredRecipes = nil;
 }
 
 #pragma mark - Filtering
 - (void)executeAppSearch:(id)sender
 {
-    [_recipeTableView beginUpdates];
-    [_recipeTableView removeRowsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _searchedRecipes.count)] withAnimation:NSTableViewAnimationEffectNone];
+    // Building the recipes hands them to the filter.
+    [self recipes];
 
-    if (_recipeSearchField.stringValue.length == 0) {
-        _searchedRecipes = self.recipes;
-    } else {
-        NSString *searchString = _recipeSearchField.stringValue;
+    [self.recipeFilter filter:_recipeSearchField.stringValue reply:^(NSArray *recipes, NSIndexSet *matches) {
+        [self displayRecipes:recipes matching:matches];
+    }];
+}
 
-        // Execute search both on Name and Identifier keys
-        NSPredicate *recipeSearchPredicate = [NSPredicate predicateWithFormat:@"%K CONTAINS[cd] %@ OR %K CONTAINS[CD] %@", kLGAutoPkgRecipeNameKey, searchString, kLGAutoPkgRecipeIdentifierKey, searchString];
+- (void)displayRecipes:(NSArray *)recipes matching:(NSIndexSet *)matches
+{
+    NSIndexSet *previousIndexes = _searchedIndexes;
+    BOOL sameRecipes = (recipes == _filteredRecipes);
 
-        _searchedRecipes = [[self.recipes filteredArrayUsingPredicate:recipeSearchPredicate] mutableCopy];
-    }
+    _searchedRecipes = [[recipes objectsAtIndexes:matches] mutableCopy];
+    _filteredRecipes = recipes;
+    _searchedIndexes = matches;
 
-    [_recipeTableView insertRowsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _searchedRecipes.count)] withAnimation:NSTableViewAnimationEffectNone];
+    if (!sameRecipes) {
+        [_recipeTableView reloadData];
+        return;
+    }
 
-    [_recipeTableView endUpdates];
+    // Only move the rows that were filtered in or out.
+    NSIndexSet *removedRows, *insertedRows;
+    [LGRecipeTableFilter rowChangesFromMatches:previousIndexes
+                                     toMatches:matches
+                                       removed:&removedRows
+                                      inserted:&insertedRows];
+
+    if (removedRows.count || insertedRows.count) {
+        [_recipeTableView beginUpdates];
+        [_recipeTableView removeRowsAtIndexes:removedRows withAnimation:NSTableViewAnimationEffectNone];
+        [_recipeTableView insertRowsAtIndexes:insertedRows withAnimation:NSTableViewAnimationEffectNone];
+        [_recipeTableView endUpdates];
+    }
 }
 
 #pragma mark - Accessors
@@ -146,11 +200,20 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
     if (!_recipes) {
         _recipes = [[LGAutoPkgRecipe allRecipes] mutableCopy];
         [_recipes sortUsingDescriptors:_recipeTableView.sortDescriptors];
+        self.recipeFilter.objects = _recipes;
     }
 
     return _recipes;
 }
 
+- (LGRecipeTableFilter *)recipeFilter
+{
+    if (!_recipeFilter) {
+        _recipeFilter = [[LGRecipeTableFilter alloc] initWithKeys:@[ kLGAutoPkgRecipeNameKey, kLGAutoPkgRecipeIdentifierKey ]];
+    }
+    return _recipeFilter;
+}
+
 #pragma mark - Run Task Menu Actions
 - (void)runRecipeFromMenu:(NSMenuItem *)item
 {
@@ -240,6 +303,19 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
     infoPopover = nil;
 }
 
+#pragma mark - Bulk Enable Menu Actions
+- (void)enableRecipesFromMenu:(NSMenuItem *)item
+{
+    NSArray *identifiers = [item.representedObject valueForKey:kLGAutoPkgRecipeIdentifierKey];
+    [LGAutoPkgRecipe enableRecipes:identifiers disableRecipes:nil];
+}
+
+- (void)disableRecipesFromMenu:(NSMenuItem *)item
+{
+    NSArray *identifiers = [item.representedObject valueForKey:kLGAutoPkgRecipeIdentifierKey];
+    [LGAutoPkgRecipe enableRecipes:nil disableRecipes:identifiers];
+}
+
 #pragma mark - Contextual Menu
 - (NSMenu *)contextualMenuForRow:(NSInteger)row
 {
@@ -251,6 +327,24 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
     infoItem.target = self;
     [menu addItem:infoItem];
 
+    // When several rows are selected, offer to change all of them at once.
+    NSIndexSet *selectedRows = _recipeTableView.selectedRowIndexes;
+    if (selectedRows.count > 1 && [selectedRows containsIndex:row]) {
+        NSArray *selectedRecipes = [_searchedRecipes objectsAtIndexes:selectedRows];
+
+        NSMenuItem *enableItem = [[NSMenuItem alloc] initWithTitle:quick_formatString(@"Enable %lu Selected Recipes", (unsigned long)selectedRecipes.count) action:@selector(enableRecipesFromMenu:) keyEquivalent:@""];
+        enableItem.representedObject = selectedRecipes;
+        enableItem.target = self;
+        [menu addItem:enableItem];
+
+        NSMenuItem *disableItem = [[NSMenuItem alloc] initWithTitle:quick_formatString(@"Disable %lu Selected Recipes", (unsigned long)selectedRecipes.count) action:@selector(disableRecipesFromMenu:) keyEquivalent:@""];
+        disableItem.representedObject = selectedRecipes;
+        disableItem.target = self;
+        [menu addItem:disableItem];
+
+        [menu addItem:[NSMenuItem separatorItem]];
+    }
+
     NSMenuItem *runMenuItem;
     if (_runTaskDictionary[recipe.Name]) {
         runMenuItem = [[NSMenuItem alloc] initWithTitle:@"Cancel Run" action:@selector(cancel) keyEquivalent:@""];
@@ -328,6 +422,7 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
 #pragma mark - Notifications
 - (void)didCreateOverride:(NSNotification *)aNotification
 {
+    [[LGAutoPkgRecipeIndex sharedIndex] invalidate];
     [[NSOperationQueue mainQueue] addOperationWithBlock:^{
         [self reload];
     }];
@@ -335,9 +430,30 @@ static NSString *const kLGAutoPkgRecipeCurrentStatusKey = @"currentStatus";
 
 - (void)didDeleteOverride:(NSNotification *)aNotification
 {
+    [[LGAutoPkgRecipeIndex sharedIndex] invalidate];
     [[NSOperationQueue mainQueue] addOperationWithBlock:^{
         [self reload];
     }];
 }
 
+- (void)recipeListChanged:(NSNotification *)aNotification
+{
+    // Only the enabled check boxes need to be updated.
+    [self reloadColumnWithIdentifier:NSStringFromSelector(@selector(isEnabled))];
+}
+
+- (void)recipeTimingsChanged:(NSNotification *)aNotification
+{
+    [self reloadColumnWithIdentifier:NSStringFromSelector(@selector(lastRunDuration))];
+}
+
+- (void)reloadColumnWithIdentifier:(NSString *)identifier
+{
+    NSInteger column = [_recipeTableView columnWithIdentifier:identifier];
+    if (column >= 0 && _searchedRecipes.count) {
+        [_recipeTableView reloadDataForRowIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _searchedRecipes.count)]
+                                    columnIndexes:[NSIndexSet indexSetWithIndex:column]];
+    }
+}
+
 @end
@@ -75,6 +75,12 @@
 
             _repos = [repos sortedArrayUsingDescriptors:sortDescriptors];
             _fetchingRepoData = NO;
+
+            // Check all the repos in one go, and redraw the table once they're done.
+            [LGAutoPkgRepo checkStatusOfRepos:_repos force:NO reply:^(NSArray *changedRepos) {
+                [_popularRepositoriesTableView reloadData];
+            }];
+
             [self executeRepoSearch:nil];
         }];
     }
@@ -143,12 +149,11 @@
             [statusCell.progressIndicator stopAnimation:self];
         };
 
-        if (repo.isInstalled) {
+        if (repo.isInstalled && repo.isCheckingStatus) {
             [statusCell.progressIndicator startAnimation:self];
-            statusCell.imageView.image = [NSImage LGStatusUpdateAvailable];
+        } else {
+            repo.statusChangeBlock(repo.status);
         }
-        // Calling checkRepoStatus will execute the repo.statusChangeBlock.
-        [repo checkRepoStatus:nil];
     }
     return statusCell;
 }
@@ -23,6 +23,7 @@
 #import "LGRepoTableViewController.h"
 #import "LGAutoPkgTask.h"
 #import "LGAutoPkgRecipe.h"
+#import "LGAutoPkgRecipeSearchIndex.h"
 #import "LGRecipeSearch.h"
 #import "LGNotificationManager.h"
 
@@ -172,7 +173,7 @@
     [_searchProgressIndicator startAnimation:self];
     [_searchProgressIndicator setDoubleValue:25.0];
 
-    [LGAutoPkgTask search:_recipeSearchTF.stringValue reply:^(NSArray *results, NSError *error) {
+    [[LGAutoPkgRecipeSearchIndex sharedIndex] search:_recipeSearchTF.stringValue reply:^(NSArray *results, NSError *error) {
         sender.enabled = YES;
         sender.title = origTitle;
         [_searchProgressIndicator setDoubleValue:100.0];
@@ -0,0 +1,43 @@
+#!/usr/bin/python
+
+'''
+    Stand-in for autopkg_worker.py used by the tests, it speaks the
+    same protocol without loading autopkg.
+
+    The "crash" verb exits the process, "env" answers with the value
+    of the LG_WORKER_TEST environment variable, everything else
+    answers with its arguments.
+'''
+
+import json
+import os
+import sys
+
+
+def main():
+    while True:
+        line = sys.stdin.readline()
+        if not line:
+            break
+
+        request = json.loads(line)
+        arguments = request.get('arguments', [])
+        environment = request.get('environment') or os.environ
+
+        if arguments[:1] == ['crash']:
+            return 1
+        elif arguments[:1] == ['env']:
+            stdout = environment.get('LG_WORKER_TEST', '')
+        else:
+            stdout = ' '.join(arguments)
+
+        sys.stdout.write(json.dumps({'exit_code': 0,
+                                     'stdout': stdout + '\n',
+                                     'stderr': ''}) + '\n')
+        sys.stdout.flush()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -23,6 +23,7 @@
 #import "LGAutoPkgrProtocol.h"
 #import "LGProgressDelegate.h"
 #import "LGPackageRemover.h"
+#import "LGProgressChannel.h"
 
 #import "SNTCodesignChecker.h"
 
@@ -365,6 +366,11 @@ helper_reply:
 
     __block double progress = 75.00;
 
+    // installer -verbose is chatty, relay only the latest line a few times a second.
+    LGProgressChannel *progressChannel = [LGProgressChannel channelWithHandler:^(NSString *message, double installProgress) {
+        [self.connection.remoteObjectProxy updateProgress:message progress:installProgress];
+    }];
+
     NSTask *task = [NSTask new];
     task.launchPath = @"/usr/sbin/installer";
     task.arguments = @[ @"-verbose", @"-pkg", path, @"-target", @"/" ];
@@ -378,8 +384,8 @@ helper_reply:
             progress ++;
             NSString *message = data.taskData_splitLines.firstObject;
             if (message.length && ![message isEqualToString:@"#"]) {
-                [self.connection.remoteObjectProxy updateProgress:[message stringByReplacingOccurrencesOfString:@"installer: " withString:@""]
-                                                         progress:progress];
+                [progressChannel sendMessage:[message stringByReplacingOccurrencesOfString:@"installer: " withString:@""]
+                                    progress:progress];
             }
 
         }
@@ -387,7 +393,10 @@ helper_reply:
 
     [task setTerminationHandler:^(NSTask *endTask) {
         NSError *error = [LGError errorFromTask:endTask];
-        reply(error);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [progressChannel flush];
+            reply(error);
+        });
     }];
 
     [task launch];